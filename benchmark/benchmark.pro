@@ -0,0 +1,47 @@
+# Copyright (C) Kreogist Dev Team
+#
+# You can redistribute this software and/or modify it under the
+# terms of the HARERU Software License; either version 1 of the
+# License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# license file for more details.
+
+# The highlighter benchmark runs without any window, it highlights generated
+# documents with all the compiled syntax definitions and prints the results as
+# JSON.
+TEMPLATE = app
+TARGET = highlightbench
+
+QT = \
+    core \
+    gui
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+# Compile the same syntax definitions as memo.
+include(../src/syntax.pri)
+
+INCLUDEPATH += \
+    ../src/sdk
+
+HEADERS += \
+    ../src/sdk/kncodesyntaxhighlighter.h \
+    ../src/sdk/knframeprofiler.h \
+    ../src/sdk/knhighlightcache.h \
+    ../src/sdk/knlanguagemodel.h \
+    ../src/sdk/knsyntaxdefinition.h \
+    ../src/sdk/knsyntaxhighlighter.h \
+    ../src/sdk/kntextblockdata.h
+
+SOURCES += \
+    main.cpp \
+    ../src/sdk/kncodesyntaxhighlighter.cpp \
+    ../src/sdk/knframeprofiler.cpp \
+    ../src/sdk/knhighlightcache.cpp \
+    ../src/sdk/knlanguagemodel.cpp \
+    ../src/sdk/knsyntaxdefinition.cpp \
+    ../src/sdk/knsyntaxhighlighter.cpp
@@ -0,0 +1,299 @@
+/*
+ * Copyright (C) Kreogist Dev Team
+ *
+ * You can redistribute this software and/or modify it under the
+ * terms of the HARERU Software License; either version 1 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * license file for more details.
+ */
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QGuiApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextBlock>
+#include <QTextDocument>
+
+#include "kncodesyntaxhighlighter.h"
+#include "knlanguagemodel.h"
+#include "kntextblockdata.h"
+
+//The number of lines treated as the first visible screen.
+#define SCREEN_LINES    (60)
+#define DEFAULT_LINES   ("10000,100000,1000000")
+
+static std::atomic<quint64> allocationCount(0), allocationBytes(0);
+
+static inline void countAllocation(size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocationBytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+#ifdef __GLIBC__
+//The Qt containers allocate their data with malloc(), replace the allocation
+//functions of the C library to count them. The operator new of the C++
+//library also goes through malloc().
+extern "C"
+{
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *pointer, size_t size);
+void __libc_free(void *pointer);
+
+void *malloc(size_t size) __THROW
+{
+    countAllocation(size);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) __THROW
+{
+    countAllocation(count * size);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *pointer, size_t size) __THROW
+{
+    countAllocation(size);
+    return __libc_realloc(pointer, size);
+}
+
+void free(void *pointer) __THROW
+{
+    __libc_free(pointer);
+}
+}
+#else
+//Only the C++ allocations could be counted portably.
+void *operator new(std::size_t size)
+{
+    countAllocation(size);
+    void *pointer = std::malloc(size ? size : 1);
+    if(!pointer)
+    {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void operator delete(void *pointer) noexcept
+{
+    std::free(pointer);
+}
+#endif
+
+static QString generateCorpus(int lines)
+{
+    //The corpus is made of C family functions. The statements of the function
+    //bodies are picked by a fixed random sequence, so every run highlights the
+    //same text.
+    static const char *statements[] =
+    {
+        "    int value%1 = compute(index, \"item %1\");",
+        "    //Check the index before using it.",
+        "    if(index > %1 && name != nullptr)",
+        "    {",
+        "        return index * 0x%1 + strlen(name);",
+        "    }",
+        "    for(int i=0; i<%1; ++i) { total += values[i] / 2.5f; }",
+        "    std::string text = \"escaped \\\"quote\\\" %1\\n\";",
+        "    /* block comment %1 */ total -= 'c';",
+        "    switch(index) { case %1: break; default: return -1; }",
+        "#if defined(ENABLE_ITEM_%1)",
+        "    total <<= 1; // trailing comment",
+        "#endif"
+    };
+    const int statementCount =
+            static_cast<int>(sizeof(statements) / sizeof(statements[0]));
+    quint32 seed = 2463534242U;
+    QStringList corpus;
+    corpus.reserve(lines);
+    for(int unit=0; corpus.size() < lines; ++unit)
+    {
+        corpus << "/*!"
+               << QString(" * \\brief Compute the item %1.").arg(unit)
+               << " * \\param index The index of the item."
+               << " */"
+               << QString("static int compute%1(int index, const char *name)")
+                  .arg(unit)
+               << "{";
+        //Xorshift for the body statements.
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        int bodyLines = 3 + static_cast<int>(seed % 8);
+        for(int i=0; i<bodyLines; ++i)
+        {
+            seed ^= seed << 13;
+            seed ^= seed >> 17;
+            seed ^= seed << 5;
+            corpus << QString(statements[seed % statementCount]).arg(seed % 1000);
+        }
+        corpus << "    return total;" << "}" << QString();
+    }
+    corpus.erase(corpus.begin() + lines, corpus.end());
+    return corpus.join('\n');
+}
+
+static bool isHighlighted(const QTextBlock &block)
+{
+    auto data = static_cast<KNTextBlockData *>(block.userData());
+    return data && data->highlightStamp != 0;
+}
+
+static QJsonObject runBenchmark(const QString &language, const QString &corpus,
+                                int lines)
+{
+    QTextDocument document;
+    document.setPlainText(corpus);
+    //Keep the definition loaded, only the highlighting is measured.
+    QSharedPointer<const KNSyntaxDefinition> definition;
+    KNSyntaxHighlighter *highlighter = nullptr;
+    if(language.isEmpty())
+    {
+        highlighter = new KNSyntaxHighlighter();
+    }
+    else
+    {
+        definition = knLanguage->definition(language);
+        highlighter = new KNCodeSyntaxHighlighter(language);
+    }
+    QTextBlock screenBlock = document.findBlockByNumber(
+                qMin(SCREEN_LINES, document.blockCount()) - 1);
+    quint64 startCount = allocationCount.load(),
+            startBytes = allocationBytes.load();
+    QElapsedTimer clock;
+    clock.start();
+    //Highlight the document as the editor does, the rest blocks are
+    //highlighted by the idle slices.
+    highlighter->setDocument(&document);
+    highlighter->rehighlightInBackground();
+    while(!isHighlighted(screenBlock) && highlighter->isHighlighting())
+    {
+        QCoreApplication::processEvents();
+    }
+    qint64 firstScreen = clock.nsecsElapsed();
+    do
+    {
+        QCoreApplication::processEvents();
+    }
+    while(highlighter->isHighlighting());
+    qint64 duration = clock.nsecsElapsed();
+    quint64 allocations = allocationCount.load() - startCount,
+            allocatedBytes = allocationBytes.load() - startBytes;
+    delete highlighter;
+    //Generate the result.
+    QJsonObject result;
+    double seconds = duration / 1e9;
+    result.insert("language", language.isEmpty() ? QString("None") : language);
+    result.insert("lines", lines);
+    result.insert("characters", corpus.size());
+    result.insert("seconds", seconds);
+    result.insert("linesPerSecond", seconds > 0.0 ? lines / seconds : 0.0);
+    result.insert("firstScreenMs", firstScreen / 1e6);
+    result.insert("allocations", static_cast<double>(allocations));
+    result.insert("allocatedBytes", static_cast<double>(allocatedBytes));
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    //Run without any display.
+    if(qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+    {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QGuiApplication app(argc, argv);
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+                "Measure the throughput of the syntax highlighters.");
+    parser.addHelpOption();
+    QCommandLineOption linesOption(
+                "lines", "Comma separated line counts of the corpora.",
+                "counts", DEFAULT_LINES);
+    QCommandLineOption languageOption(
+                "language", "Only run the language, could be repeated.",
+                "name");
+    QCommandLineOption outputOption(
+                "output", "Write the JSON result to the file instead of stdout.",
+                "file");
+    parser.addOption(linesOption);
+    parser.addOption(languageOption);
+    parser.addOption(outputOption);
+    parser.process(app);
+    //Find all the compiled languages.
+    KNLanguageModel::initial(&app);
+    QStringList languages = parser.values(languageOption);
+    if(languages.isEmpty())
+    {
+        const auto binaries = KNSyntaxDefinition::binaries();
+        for(const auto &data : binaries)
+        {
+            QString name;
+            QStringList extensions;
+            int priority;
+            if(KNSyntaxDefinition::readHeader(data, name, extensions, priority))
+            {
+                languages.append(name);
+            }
+        }
+        languages.sort();
+        //The default highlighter shows the cost of the slices.
+        languages.prepend(QString());
+    }
+    QVector<int> lineCounts;
+    const auto countTexts = parser.value(linesOption).split(',');
+    for(const auto &countText : countTexts)
+    {
+        int lines = countText.trimmed().toInt();
+        if(lines > 0)
+        {
+            lineCounts.append(lines);
+        }
+    }
+    //Run the benchmarks.
+    QJsonArray results;
+    for(int lines : lineCounts)
+    {
+        QString corpus = generateCorpus(lines);
+        for(const auto &language : languages)
+        {
+            fprintf(stderr, "Highlighting %d lines with %s...\n", lines,
+                    language.isEmpty() ? "None" : qPrintable(language));
+            results.append(runBenchmark(language, corpus, lines));
+        }
+    }
+    QJsonObject report;
+    report.insert("benchmark", QString("highlighter"));
+    report.insert("qtVersion", QString(qVersion()));
+    report.insert("screenLines", SCREEN_LINES);
+    report.insert("results", results);
+    QByteArray output = QJsonDocument(report).toJson(QJsonDocument::Indented);
+    if(!parser.isSet(outputOption))
+    {
+        fwrite(output.constData(), 1, static_cast<size_t>(output.size()),
+               stdout);
+        return 0;
+    }
+    QFile outputFile(parser.value(outputOption));
+    if(!outputFile.open(QIODevice::WriteOnly | QIODevice::Truncate) ||
+            outputFile.write(output) != output.size())
+    {
+        fprintf(stderr, "highlightbench: failed to write %s\n",
+                qPrintable(parser.value(outputOption)));
+        return 1;
+    }
+    return 0;
+}
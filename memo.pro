@@ -12,5 +12,13 @@
 # This is only a management project file.
 TEMPLATE = subdirs
 
-# Add subdirs projects.
-SUBDIRS = src
+# Add subdirs projects, the syntax compiler is used when building memo and the
+# highlighter benchmark.
+SUBDIRS = \
+    syntaxcompiler \
+    src \
+    benchmark
+
+syntaxcompiler.subdir = tools/syntaxcompiler
+src.depends = syntaxcompiler
+benchmark.depends = syntaxcompiler
@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) Kreogist Dev Team
+ *
+ * You can redistribute this software and/or modify it under the
+ * terms of the HARERU Software License; either version 1 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * license file for more details.
+ */
+#include <cstdlib>
+#include <cstring>
+
+#include "kntexteditor.h"
+
+#include "kncaseconverter.h"
+
+//Repeat a 16-bit value in the four lanes of a 64-bit word.
+#define LANES(x)            (0x0001000100010001ULL * (x))
+#define NON_ASCII_MASK      LANES(0xFF80)
+
+static inline quint64 rangeMask(quint64 word, quint64 first, quint64 last)
+{
+    //All the lanes are ASCII, so adding a value below 0x80 never carries to
+    //the next lane. The 0x80 bit is set when the lane reaches the boundary,
+    //which is only different between the two sums inside the range.
+    quint64 fromFirst = word + LANES(0x80 - first),
+            fromLast = word + LANES(0x80 - last - 1);
+    //Move the difference bit to the case bit 0x20.
+    return ((fromFirst ^ fromLast) & LANES(0x80)) >> 2;
+}
+
+static inline quint64 caseMask(quint64 word, int letterCase)
+{
+    switch(letterCase)
+    {
+    case KNTextEditor::Upper:
+        return rangeMask(word, 'a', 'z');
+    case KNTextEditor::Lower:
+        return rangeMask(word, 'A', 'Z');
+    default:
+        return rangeMask(word, 'a', 'z') | rangeMask(word, 'A', 'Z');
+    }
+}
+
+static qsizetype convertAscii(const QChar *source, QChar *target,
+                              qsizetype length, int letterCase)
+{
+    //Convert 16 characters at a time until a non-ASCII character is found.
+    qsizetype i = 0;
+    for(; i + 16 <= length; i += 16)
+    {
+        quint64 words[4];
+        std::memcpy(words, source + i, sizeof(words));
+        if((words[0] | words[1] | words[2] | words[3]) & NON_ASCII_MASK)
+        {
+            break;
+        }
+        words[0] ^= caseMask(words[0], letterCase);
+        words[1] ^= caseMask(words[1], letterCase);
+        words[2] ^= caseMask(words[2], letterCase);
+        words[3] ^= caseMask(words[3], letterCase);
+        std::memcpy(target + i, words, sizeof(words));
+    }
+    //Convert the rest ASCII characters one by one.
+    for(; i < length && source[i].unicode() < 0x80; ++i)
+    {
+        quint64 code = source[i].unicode();
+        target[i] = QChar(static_cast<ushort>(code ^ caseMask(code, letterCase)));
+    }
+    return i;
+}
+
+static inline void appendUcs4(QString &text, uint ucs4)
+{
+    if(QChar::requiresSurrogates(ucs4))
+    {
+        text.append(QChar(QChar::highSurrogate(ucs4)));
+        text.append(QChar(QChar::lowSurrogate(ucs4)));
+        return;
+    }
+    text.append(QChar(ucs4));
+}
+
+static QString convertUnicode(QStringView text, int letterCase)
+{
+    switch(letterCase)
+    {
+    case KNTextEditor::Upper:
+        return text.toString().toUpper();
+    case KNTextEditor::Lower:
+        return text.toString().toLower();
+    default:
+        break;
+    }
+    //Reverse the case of each code point.
+    QString result;
+    result.reserve(static_cast<int>(text.size()));
+    for(qsizetype i=0; i<text.size(); ++i)
+    {
+        uint ucs4 = text.at(i).unicode();
+        if(QChar::isHighSurrogate(ucs4) && i + 1 < text.size() &&
+                text.at(i + 1).isLowSurrogate())
+        {
+            ucs4 = QChar::surrogateToUcs4(text.at(i), text.at(i + 1));
+            ++i;
+        }
+        if(QChar::isUpper(ucs4))
+        {
+            ucs4 = QChar::toLower(ucs4);
+        }
+        else if(QChar::isLower(ucs4))
+        {
+            ucs4 = QChar::toUpper(ucs4);
+        }
+        appendUcs4(result, ucs4);
+    }
+    return result;
+}
+
+QString KNCaseConverter::convert(QStringView text, int letterCase)
+{
+    switch(letterCase)
+    {
+    case KNTextEditor::Proper:
+    {
+        //Convert to lower case, then capitalize the first letter of the words.
+        QString result = convert(text, KNTextEditor::Lower);
+        QChar *data = result.data();
+        bool wordStart = true;
+        for(int i=0; i<result.size(); ++i)
+        {
+            if(wordStart && data[i] != ' ')
+            {
+                if(data[i].isHighSurrogate() && i + 1 < result.size() &&
+                        data[i + 1].isLowSurrogate())
+                {
+                    uint ucs4 = QChar::toUpper(
+                                QChar::surrogateToUcs4(data[i], data[i + 1]));
+                    if(QChar::requiresSurrogates(ucs4))
+                    {
+                        data[i] = QChar(QChar::highSurrogate(ucs4));
+                        data[i + 1] = QChar(QChar::lowSurrogate(ucs4));
+                    }
+                }
+                else
+                {
+                    data[i] = data[i].toUpper();
+                }
+            }
+            wordStart = (data[i] == ' ');
+        }
+        return result;
+    }
+    case KNTextEditor::Random:
+    {
+        QString result;
+        result.reserve(static_cast<int>(text.size()));
+        for(qsizetype i=0; i<text.size(); ++i)
+        {
+            result.append((std::rand() & 1) ?
+                              text.at(i).toLower() : text.at(i).toUpper());
+        }
+        return result;
+    }
+    default:
+        break;
+    }
+    //Convert the ASCII characters in words, and the non-ASCII runs between
+    //them with the Unicode mapping. The mapping could change the length.
+    const QChar *source = text.data();
+    qsizetype size = text.size(), i = 0, written = 0;
+    QString result(static_cast<int>(size), Qt::Uninitialized);
+    while(i < size)
+    {
+        qsizetype converted = convertAscii(source + i, result.data() + written,
+                                           size - i, letterCase);
+        i += converted;
+        written += converted;
+        if(i == size)
+        {
+            break;
+        }
+        qsizetype runEnd = i + 1;
+        while(runEnd < size && source[runEnd].unicode() >= 0x80)
+        {
+            ++runEnd;
+        }
+        QString run = convertUnicode(QStringView(source + i, runEnd - i),
+                                     letterCase);
+        if(run.size() != runEnd - i)
+        {
+            result.resize(static_cast<int>(result.size() + run.size() -
+                                           (runEnd - i)));
+        }
+        std::memcpy(result.data() + written, run.constData(),
+                    run.size() * sizeof(QChar));
+        written += run.size();
+        i = runEnd;
+    }
+    return result;
+}
@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) Kreogist Dev Team
+ *
+ * You can redistribute this software and/or modify it under the
+ * terms of the HARERU Software License; either version 1 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * license file for more details.
+ */
+#ifndef KNCASECONVERTER_H
+#define KNCASECONVERTER_H
+
+#include <QString>
+
+/*!
+ * \brief The KNCaseConverter class converts the letter case of a text. The
+ * ASCII characters are converted 16 characters at a time by the bit operations
+ * on 64-bit words, only the runs of the non-ASCII characters are converted
+ * with the Unicode case mapping.
+ */
+class KNCaseConverter
+{
+public:
+    /*!
+     * \brief Convert the letter case of a text.\n
+     * For Proper, the first character of the text and the characters after a
+     * space are converted to upper case, the others are converted to lower
+     * case. For Random, the caller should seed std::rand() before converting.
+     * \param text The text to be converted.
+     * \param letterCase It should be an instance of KNTextEditor::LetterCase.
+     * \return The converted text.
+     */
+    static QString convert(QStringView text, int letterCase);
+};
+
+#endif // KNCASECONVERTER_H
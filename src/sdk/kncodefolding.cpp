@@ -0,0 +1,231 @@
+/*
+ * Copyright (C) Kreogist Dev Team
+ *
+ * You can redistribute this software and/or modify it under the
+ * terms of the HARERU Software License; either version 1 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * license file for more details.
+ */
+#include <algorithm>
+
+#include <QHash>
+#include <QTextBlock>
+#include <QTextDocument>
+
+#include "kntextblockdata.h"
+
+#include "kncodefolding.h"
+
+KNCodeFolding::KNCodeFolding()
+{
+}
+
+void KNCodeFolding::rebuild(QTextDocument *document, int firstBlock)
+{
+    //Match the markers with a stack for each region. The regions open at the
+    //first block are restored from the last result. The unclosed regions are
+    //at the bottom of the stacks, the ranges are sorted by the start.
+    QHash<int, QVector<int>> openBlocks;
+    QVector<Range> ranges;
+    int levelBlock = firstBlock;
+    for(const Range &range : qAsConst(m_unclosed))
+    {
+        if(range.start < firstBlock)
+        {
+            openBlocks[range.region].append(range.start);
+            levelBlock = qMin(levelBlock, range.start);
+        }
+    }
+    for(const Range &range : qAsConst(m_ranges))
+    {
+        if(range.end < firstBlock)
+        {
+            ranges.append(range);
+        }
+        else if(range.start < firstBlock)
+        {
+            openBlocks[range.region].append(range.start);
+            levelBlock = qMin(levelBlock, range.start);
+        }
+    }
+    m_ranges = ranges;
+    for(QTextBlock block = document->findBlockByNumber(firstBlock);
+        block.isValid(); block = block.next())
+    {
+        auto data = static_cast<KNTextBlockData *>(block.userData());
+        if(!data)
+        {
+            continue;
+        }
+        int blockNumber = block.blockNumber();
+        for(int mark : qAsConst(data->regionMarks))
+        {
+            if(mark > 0)
+            {
+                openBlocks[mark].append(blockNumber);
+                continue;
+            }
+            //The unpaired end markers are ignored.
+            QVector<int> &starts = openBlocks[-mark];
+            if(starts.isEmpty())
+            {
+                continue;
+            }
+            int start = starts.takeLast();
+            //A region inside one block could not be folded.
+            if(start < blockNumber)
+            {
+                m_ranges.append({start, blockNumber, -mark});
+            }
+        }
+    }
+    m_unclosed.clear();
+    for(auto i=openBlocks.constBegin(); i!=openBlocks.constEnd(); ++i)
+    {
+        for(int start : i.value())
+        {
+            m_unclosed.append({start, -1, i.key()});
+        }
+    }
+    std::sort(m_unclosed.begin(), m_unclosed.end(),
+              [](const Range &left, const Range &right)
+    {
+        return left.start < right.start;
+    });
+    //Sort the ranges by the start, the outer range goes first.
+    std::sort(m_ranges.begin(), m_ranges.end(),
+              [](const Range &left, const Range &right)
+    {
+        return left.start == right.start ?
+                    left.end > right.end : left.start < right.start;
+    });
+    m_maxEnds.resize(m_ranges.size());
+    buildTree(0, m_ranges.size());
+    //Count the ranges contain each block as the level with a difference array.
+    //Only the blocks from the first changed range are updated.
+    QVector<int> levelDiffs(document->blockCount() + 1, 0);
+    for(const Range &range : qAsConst(m_ranges))
+    {
+        ++levelDiffs[range.start + 1];
+        --levelDiffs[range.end + 1];
+    }
+    int level = 0, rangeIndex = lowerBound(levelBlock);
+    for(int i=0; i<levelBlock && i<levelDiffs.size(); ++i)
+    {
+        level += levelDiffs.at(i);
+    }
+    for(QTextBlock block = document->findBlockByNumber(levelBlock);
+        block.isValid(); block = block.next())
+    {
+        int blockNumber = block.blockNumber();
+        level += levelDiffs.at(blockNumber);
+        bool isStart = rangeIndex < m_ranges.size() &&
+                m_ranges.at(rangeIndex).start == blockNumber;
+        while(rangeIndex < m_ranges.size() &&
+              m_ranges.at(rangeIndex).start == blockNumber)
+        {
+            ++rangeIndex;
+        }
+        auto data = static_cast<KNTextBlockData *>(block.userData());
+        if(!data)
+        {
+            continue;
+        }
+        data->level = level;
+        data->levelMargin = isStart ? 1 : 0;
+        //The fold state only stays on the start of a range.
+        data->isFold = data->isFold && isStart;
+    }
+}
+
+void KNCodeFolding::clear()
+{
+    m_ranges.clear();
+    m_unclosed.clear();
+    m_maxEnds.clear();
+}
+
+int KNCodeFolding::count() const
+{
+    return m_ranges.size();
+}
+
+bool KNCodeFolding::isEmpty() const
+{
+    return m_ranges.isEmpty() && m_unclosed.isEmpty();
+}
+
+int KNCodeFolding::lowerBound(int blockNumber) const
+{
+    return std::lower_bound(m_ranges.begin(), m_ranges.end(), blockNumber,
+                            [](const Range &range, int value)
+    {
+        return range.start < value;
+    }) - m_ranges.begin();
+}
+
+int KNCodeFolding::rangeAt(int blockNumber) const
+{
+    int index = lowerBound(blockNumber);
+    return (index < m_ranges.size() &&
+            m_ranges.at(index).start == blockNumber) ? index : -1;
+}
+
+QVector<int> KNCodeFolding::rangesContaining(int blockNumber) const
+{
+    QVector<int> indexes;
+    findContaining(0, m_ranges.size(), blockNumber, indexes);
+    return indexes;
+}
+
+int KNCodeFolding::innermostRange(int blockNumber) const
+{
+    //The ranges are nested, the last one in start order is the innermost.
+    QVector<int> indexes = rangesContaining(blockNumber);
+    return indexes.isEmpty() ? -1 : indexes.last();
+}
+
+int KNCodeFolding::buildTree(int begin, int end)
+{
+    //The middle range of the slice is the root of the subtree.
+    if(begin >= end)
+    {
+        return -1;
+    }
+    int middle = (begin + end) >> 1,
+            maxEnd = m_ranges.at(middle).end;
+    maxEnd = qMax(maxEnd, buildTree(begin, middle));
+    maxEnd = qMax(maxEnd, buildTree(middle + 1, end));
+    m_maxEnds[middle] = maxEnd;
+    return maxEnd;
+}
+
+void KNCodeFolding::findContaining(int begin, int end, int blockNumber,
+                                   QVector<int> &indexes) const
+{
+    if(begin >= end)
+    {
+        return;
+    }
+    int middle = (begin + end) >> 1;
+    //No range in the subtree reaches the block.
+    if(m_maxEnds.at(middle) < blockNumber)
+    {
+        return;
+    }
+    findContaining(begin, middle, blockNumber, indexes);
+    //The ranges after the middle start after the block.
+    if(m_ranges.at(middle).start > blockNumber)
+    {
+        return;
+    }
+    if(m_ranges.at(middle).end >= blockNumber)
+    {
+        indexes.append(middle);
+    }
+    findContaining(middle + 1, end, blockNumber, indexes);
+}
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) Kreogist Dev Team
+ *
+ * You can redistribute this software and/or modify it under the
+ * terms of the HARERU Software License; either version 1 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * license file for more details.
+ */
+#ifndef KNCODEFOLDING_H
+#define KNCODEFOLDING_H
+
+#include <QVector>
+
+class QTextDocument;
+/*!
+ * \brief The KNCodeFolding class keeps the folding ranges of a document. The
+ * ranges are matched from the region markers saved in the block data by the
+ * highlighter. They are sorted by the start block and saved as an implicit
+ * interval tree, each node of the tree keeps the maximum end block of its
+ * subtree, so the ranges containing a block are found without scanning all the
+ * ranges.\n
+ * A range starts at the block which opens the region, and ends at the block
+ * which closes it. Folding a range hides all the blocks after the start block.
+ * When the markers are changed, only the ranges which end after the first
+ * changed block are matched again.
+ */
+class KNCodeFolding
+{
+public:
+    struct Range
+    {
+        int start;
+        int end;
+        int region;
+    };
+
+    /*!
+     * \brief Construct an empty KNCodeFolding object.
+     */
+    KNCodeFolding();
+
+    /*!
+     * \brief Match the ranges from the region markers of the document. The
+     * level and the level margin of the block data are updated as well.
+     * \param document The text document.
+     * \param firstBlock The first block whose markers are changed, the ranges
+     * end before it are kept.
+     */
+    void rebuild(QTextDocument *document, int firstBlock = 0);
+
+    /*!
+     * \brief Remove all the ranges.
+     */
+    void clear();
+
+    /*!
+     * \brief Get the number of the ranges.
+     * \return The range count.
+     */
+    int count() const;
+
+    /*!
+     * \brief Check whether no range and no unclosed region is matched.
+     * \return If the folding is empty, return true.
+     */
+    bool isEmpty() const;
+
+    /*!
+     * \brief Get the range at the index, the ranges are sorted by the start
+     * block.
+     * \param index The range index.
+     * \return The range reference.
+     */
+    const Range &range(int index) const
+    {
+        return m_ranges.at(index);
+    }
+
+    /*!
+     * \brief Find the first range which starts at or after a block.
+     * \param blockNumber The block number.
+     * \return The range index. If there is no such range, return count().
+     */
+    int lowerBound(int blockNumber) const;
+
+    /*!
+     * \brief Find the range starts at a block.
+     * \param blockNumber The block number.
+     * \return The outermost range index. If no range starts at the block,
+     * return -1.
+     */
+    int rangeAt(int blockNumber) const;
+
+    /*!
+     * \brief Find all the ranges which contain a block.
+     * \param blockNumber The block number.
+     * \return The range indexes, sorted by the start block.
+     */
+    QVector<int> rangesContaining(int blockNumber) const;
+
+    /*!
+     * \brief Find the innermost range which contains a block.
+     * \param blockNumber The block number.
+     * \return The range index. If no range contains the block, return -1.
+     */
+    int innermostRange(int blockNumber) const;
+
+private:
+    int buildTree(int begin, int end);
+    void findContaining(int begin, int end, int blockNumber,
+                        QVector<int> &indexes) const;
+    QVector<Range> m_ranges;
+    //The regions which are never closed, their ends are -1.
+    QVector<Range> m_unclosed;
+    QVector<int> m_maxEnds;
+};
+
+#endif // KNCODEFOLDING_H
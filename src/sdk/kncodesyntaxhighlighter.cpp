@@ -10,21 +10,33 @@
  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
  * license file for more details.
  */
-#include <QDir>
-#include <QFileInfo>
-#include <QDomDocument>
 #include <QTextDocument>
-#include <QXmlStreamReader>
+
+#include "kntextblockdata.h"
+#include "knlanguagemodel.h"
 
 #include "kncodesyntaxhighlighter.h"
 
-bool KNCodeSyntaxHighlighter::syntaxLoaded = false;
-QHash<QString, QString> KNCodeSyntaxHighlighter::extMap = QHash<QString, QString>();
-QHash<QString, QString> KNCodeSyntaxHighlighter::namePathMap = QHash<QString, QString>();
+#if QT_VERSION_MAJOR > 5
+#define ANCHORED_MATCH  (QRegularExpression::AnchorAtOffsetMatchOption)
+#else
+#define ANCHORED_MATCH  (QRegularExpression::AnchoredMatchOption)
+#endif
+
+//The maximum times of switching context without consuming any character.
+#define MAX_STALLS      (64)
+//The maximum depth of the context stack.
+#define MAX_STACK_DEPTH (128)
+//The maximum number of the compiled dynamic expressions kept.
+#define MAX_DYNAMIC_REGEXPS (256)
 
 KNCodeSyntaxHighlighter::KNCodeSyntaxHighlighter(const QString &syntaxName,
                                                  QObject *parent) :
-    KNSyntaxHighlighter(parent)
+    KNSyntaxHighlighter(parent),
+    m_runStart(0),
+    m_runEnd(0),
+    m_runAttribute(-1),
+    m_recordRuns(false)
 {
     //Load the syntax rule of the syntax name.
     loadRules(syntaxName);
@@ -32,224 +44,547 @@ KNCodeSyntaxHighlighter::KNCodeSyntaxHighlighter(const QString &syntaxName,
 
 KNSyntaxHighlighter *KNCodeSyntaxHighlighter::get(const QString &filePath)
 {
-    //Check whether the global syntax is loaded.
-    if(!syntaxLoaded)
-    {
-        QHash<QString, int> syntaxPriority;
-        //Load the information from the rows.
-        loadDir(":/syntax/", syntaxPriority);
-        //Load the syntax.
-        syntaxLoaded = true;
-    }
-    //Extract the suffix of the file path.
-    const QString &&suffix = QFileInfo(filePath).suffix();
-    // Find the suffix in the global rules.
-    if(extMap.contains(suffix))
+    //Find the language of the file suffix.
+    QString syntaxName = knLanguage->languageOf(filePath);
+    if(!syntaxName.isEmpty())
     {
-        return new KNCodeSyntaxHighlighter(extMap.value(suffix));
+        return new KNCodeSyntaxHighlighter(syntaxName);
     }
     //Or else, we have to use a default syntax highlighter, which does nothing.
     return new KNSyntaxHighlighter();
 }
 
-#include <QDebug>
-
 void KNCodeSyntaxHighlighter::loadRules(const QString &syntaxName)
 {
-    //Open the rule file.
-    QFile ruleFile(namePathMap.value(syntaxName));
-    if(!ruleFile.open(QIODevice::ReadOnly))
+    //The compiled definition is shared by all the highlighters of the syntax,
+    //the highlighter only keeps the states of its document.
+    m_definition = knLanguage->definition(syntaxName);
+    resetStates();
+}
+
+bool KNCodeSyntaxHighlighter::hasCodeLevel() const
+{
+    return true;
+}
+
+bool KNCodeSyntaxHighlighter::loadCache(const QString &filePath)
+{
+    //Record the format runs when the file would be cached.
+    m_recordRuns = KNHighlightCache::isCacheable(filePath);
+    if(!m_recordRuns || !m_definition ||
+            !m_cache.load(filePath, m_definition->hash()))
+    {
+        return false;
+    }
+    //The cached states are interned by the previous highlighter, continue
+    //interning with its state table.
+    m_states.swap(m_cache.states);
+    m_captures.swap(m_cache.captures);
+    m_cache.states.clear();
+    m_cache.captures.clear();
+    m_stateIds.clear();
+    for(int i=0; i<m_states.size(); ++i)
+    {
+        m_stateIds.insert(m_states.at(i), i);
+    }
+    m_captureIds.clear();
+    for(int i=0; i<m_captures.size(); ++i)
+    {
+        m_captureIds.insert(m_captures.at(i), i);
+    }
+    return true;
+}
+
+void KNCodeSyntaxHighlighter::saveCache(const QString &filePath)
+{
+    if(!m_recordRuns || !m_definition || !document())
     {
         return;
     }
-    QHash<QString, QString> entity;
+    KNHighlightCache cache;
+    cache.states = m_states;
+    cache.captures = m_captures;
+    cache.blocks.reserve(document()->blockCount());
+    for(QTextBlock block = document()->begin(); block.isValid();
+        block = block.next())
     {
-        QXmlStreamReader reader(&ruleFile);
-        reader.readNext();
-        do
+        //The blocks not highlighted are saved as invalid.
+        KNHighlightCache::Block cacheBlock;
+        auto data = static_cast<KNTextBlockData *>(block.userData());
+        if(data && isHighlighted(block))
         {
-            int type = reader.tokenType();
-            switch(type)
-            {
-            case QXmlStreamReader::DTD:
+            QTextBlock previousBlock = block.previous();
+            cacheBlock.formatRuns = data->formatRuns;
+            cacheBlock.regionMarks = data->regionMarks;
+            cacheBlock.textHash = KNHighlightCache::textHash(block.text());
+            cacheBlock.previousState = previousBlock.isValid() ?
+                        previousBlock.userState() : -1;
+            cacheBlock.state = block.userState();
+            cacheBlock.isValid = true;
+        }
+        cache.blocks.append(cacheBlock);
+    }
+    cache.save(filePath, m_definition->hash());
+}
+
+void KNCodeSyntaxHighlighter::syntaxProcess(const QString &text,
+                                            KNTextBlockData *data)
+{
+    if(!m_definition || !m_definition->isValid())
+    {
+        return;
+    }
+    //Use the cached formats when the block is not changed. The cache is freed
+    //when the last block is highlighted.
+    bool cached = applyCache(text, data);
+    if(!m_cache.blocks.isEmpty() && !currentBlock().next().isValid())
+    {
+        m_cache.blocks = QVector<KNHighlightCache::Block>();
+    }
+    if(cached)
+    {
+        return;
+    }
+    //Restore the context stack at the end of the previous block.
+    int previousState = previousBlockState();
+    QVector<int> stack = m_states.value(previousState, m_states.at(0));
+    m_regionMarks.clear();
+    m_formatRuns.clear();
+    highlightLine(text, stack);
+    //Save the context stack as the block state.
+    setCurrentBlockState(stateId(stack));
+    setRegionMarks(data, m_regionMarks);
+    if(m_recordRuns)
+    {
+        data->formatRuns.swap(m_formatRuns);
+    }
+}
+
+bool KNCodeSyntaxHighlighter::applyCache(const QString &text,
+                                         KNTextBlockData *data)
+{
+    int blockNumber = currentBlock().blockNumber();
+    if(blockNumber >= m_cache.blocks.size())
+    {
+        return false;
+    }
+    //The block is validated when it is highlighted, the cached block is only
+    //used when the text and the previous state are the same as saved.
+    KNHighlightCache::Block &cacheBlock = m_cache.blocks[blockNumber];
+    if(!cacheBlock.isValid || cacheBlock.previousState != previousBlockState()
+            || cacheBlock.state >= m_states.size()
+            || cacheBlock.textHash != KNHighlightCache::textHash(text))
+    {
+        return false;
+    }
+    const QVector<int> &runs = cacheBlock.formatRuns;
+    for(int i=0; i + 2<runs.size(); i+=3)
+    {
+        setFormat(runs.at(i), runs.at(i + 1),
+                  m_definition->format(runs.at(i + 2)));
+    }
+    setCurrentBlockState(cacheBlock.state);
+    setRegionMarks(data, cacheBlock.regionMarks);
+    //Move the runs to the block, the cached block is not used again.
+    if(m_recordRuns)
+    {
+        data->formatRuns.swap(cacheBlock.formatRuns);
+    }
+    cacheBlock = KNHighlightCache::Block();
+    return true;
+}
+
+void KNCodeSyntaxHighlighter::resetStates()
+{
+    //The first state is the initial context without any captures.
+    m_captures = QVector<QStringList>(1);
+    m_captureIds.clear();
+    m_captureIds.insert(QStringList(), 0);
+    m_states = QVector<QVector<int>>(1, QVector<int>(2, 0));
+    m_stateIds.clear();
+    m_stateIds.insert(m_states.at(0), 0);
+    m_regExpNext.resize(m_definition ? m_definition->regExpCount() : 0);
+    m_dynamicRegExps.clear();
+}
+
+static inline bool matchAt(const QString &text, int pos, const QString &target,
+                           bool insensitive)
+{
+    if(target.isEmpty() || pos + target.size() > text.size())
+    {
+        return false;
+    }
+    const QChar *data = text.constData() + pos;
+    for(int i=0; i<target.size(); ++i)
+    {
+        if(data[i] != target.at(i) &&
+                (!insensitive || data[i].toLower() != target.at(i).toLower()))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static QString replaceCaptures(const QString &pattern,
+                               const QStringList &captures, bool escape)
+{
+    //Replace the %1 to %9 with the captured texts.
+    QString result;
+    result.reserve(pattern.size());
+    for(int i=0; i<pattern.size(); ++i)
+    {
+        int index = (i + 1 < pattern.size() && pattern.at(i) == '%') ?
+                    pattern.at(i + 1).digitValue() : -1;
+        if(index < 0)
+        {
+            result.append(pattern.at(i));
+            continue;
+        }
+        QString capture = captures.value(index);
+        result.append(escape ? QRegularExpression::escape(capture) : capture);
+        ++i;
+    }
+    return result;
+}
+
+void KNCodeSyntaxHighlighter::highlightLine(const QString &text,
+                                            QVector<int> &stack)
+{
+    const int length = text.size();
+    int firstNonSpace = 0;
+    while(firstNonSpace < length && text.at(firstNonSpace).isSpace())
+    {
+        ++firstNonSpace;
+    }
+    //Reset the regular expression caches of the line.
+    m_regExpNext.fill(-1);
+    m_runAttribute = -1;
+    m_runStart = 0;
+    m_runEnd = 0;
+    int pos = 0, stalls = 0;
+    bool lineContinue = false;
+    QStringList matchCaptures;
+    while(pos < length)
+    {
+        const auto &context = m_definition->context(stack.at(stack.size() - 2));
+        const KNSyntaxDefinition::Rule *matched = nullptr;
+        int end = -1;
+        //Find the first rule matches the current position.
+        for(const auto &rule : context.rules)
+        {
+            if(rule.firstNonSpace && pos != firstNonSpace)
             {
-                //Build the internal entity.
-                auto ent = reader.entityDeclarations();
-                QTextDocument doc;
-                for(auto i=0; i<ent.size(); ++i)
-                {
-                    doc.setHtml(ent.at(i).value().toString());
-                    entity.insert(ent.at(i).name().toString(),
-                                  doc.toPlainText());
-                }
-                break;
+                continue;
             }
-            default:
+            end = matchRule(rule, text, pos, m_captures.at(stack.last()),
+                            matchCaptures);
+            //The look ahead expressions could match nothing, e.g. "(?=a)".
+            if(end > pos ||
+                    (end == pos && rule.lookAhead && stalls < MAX_STALLS &&
+                     rule.type == KNSyntaxDefinition::RegExpr))
+            {
+                matched = &rule;
                 break;
             }
-            if(!entity.isEmpty())
+        }
+        if(!matched)
+        {
+            if(context.hasFallthrough && stalls < MAX_STALLS)
             {
-                break;
+                //Switch the context without consuming the character.
+                switchContext(stack, context.fallthrough, QStringList());
+                ++stalls;
+                continue;
             }
-            //Skip to next element.
-            reader.readNext();
+            addFormat(pos, pos + 1, context.attribute);
+            ++pos;
+            stalls = 0;
+            lineContinue = false;
+            continue;
+        }
+        switchContext(stack, matched->target, matchCaptures);
+        //Close the region before opening the next one, e.g. "} else {".
+        if(matched->endRegion > -1)
+        {
+            m_regionMarks.append(-(matched->endRegion + 1));
+        }
+        if(matched->beginRegion > -1)
+        {
+            m_regionMarks.append(matched->beginRegion + 1);
         }
-        while(reader.tokenType() > QXmlStreamReader::Invalid);
+        //The look ahead rules only switch the context.
+        if(matched->lookAhead && stalls < MAX_STALLS)
+        {
+            ++stalls;
+            continue;
+        }
+        //Rules without attribute use the attribute of the new context.
+        addFormat(pos, end, matched->attribute == -1 ?
+                      m_definition->context(stack.at(stack.size() - 2)).attribute :
+                      matched->attribute);
+        lineContinue = (matched->type == KNSyntaxDefinition::LineContinue);
+        pos = end;
+        stalls = 0;
     }
-    //Now reset the file position.
-    ruleFile.seek(0);
-    //Construct the dom document.
-    QDomDocument syntaxDoc;
-    if(!syntaxDoc.setContent(&ruleFile))
+    flushFormat();
+    //The line continue keeps the context to the next line.
+    if(lineContinue)
     {
-        ruleFile.close();
         return;
     }
-    ruleFile.close();
-    //Parse the syntax file.
-    auto nodes = syntaxDoc.childNodes();
-    for(int i=0; i<nodes.size(); ++i)
+    //Apply the line end context switches until the context stays.
+    for(int i=0; i<MAX_STALLS; ++i)
     {
-        //Check the name of the nodes.
-        if("language" == nodes.item(i).nodeName())
+        int topContext = stack.at(stack.size() - 2);
+        const auto &lineEnd = m_definition->context(topContext).lineEnd;
+        if(lineEnd.isStay())
+        {
+            break;
+        }
+        switchContext(stack, lineEnd, QStringList());
+        if(stack.at(stack.size() - 2) == topContext)
         {
-            //Parse the language node.
-            parseLanguageNode(nodes.item(i).toElement());
             break;
         }
     }
 }
 
-bool KNCodeSyntaxHighlighter::hasCodeLevel() const
-{
-    return true;
-}
-
-void KNCodeSyntaxHighlighter::parseLanguageNode(const QDomElement &lan)
+int KNCodeSyntaxHighlighter::matchRule(const KNSyntaxDefinition::Rule &rule,
+                                       const QString &text, int pos,
+                                       const QStringList &captures,
+                                       QStringList &matchCaptures)
 {
-    //Parse the internal nodes.
-    auto categoryList = lan.childNodes();
-    for(int i=0; i<categoryList.size(); ++i)
+    const int length = text.size();
+    const QChar c = text.at(pos);
+    switch(rule.type)
+    {
+    case KNSyntaxDefinition::DetectChar:
     {
-        //Now check each element.
-        auto node = categoryList.at(i);
-        auto nodeName = node.nodeName();
-        if(nodeName == "highlighting")
+        if(rule.dynamic)
         {
-            //Update the highlighting rules.
-            parseHighlight(node.toElement());
+            QString capture = captures.value(rule.char0.digitValue());
+            return (!capture.isEmpty() && c == capture.at(0)) ? pos + 1 : -1;
         }
-        else if(nodeName == "general")
+        return c == rule.char0 ? pos + 1 : -1;
+    }
+    case KNSyntaxDefinition::Detect2Chars:
+        return (c == rule.char0 && pos + 1 < length &&
+                text.at(pos + 1) == rule.char1) ? pos + 2 : -1;
+    case KNSyntaxDefinition::AnyChar:
+        return rule.string.contains(c) ? pos + 1 : -1;
+    case KNSyntaxDefinition::StringDetect:
+    {
+        if(rule.dynamic)
         {
-            //Update the general rules.
-            ;
+            QString target = replaceCaptures(rule.string, captures, false);
+            return matchAt(text, pos, target, rule.insensitive) ?
+                        pos + target.size() : -1;
         }
+        return matchAt(text, pos, rule.string, rule.insensitive) ?
+                    pos + rule.string.size() : -1;
     }
-}
-
-void KNCodeSyntaxHighlighter::parseHighlight(const QDomElement &highlights)
-{
-    //Check for all the highlight info.
-    auto parts = highlights.childNodes();
-    QHash<QString, QString> lists;
-    for(int i=0; i<parts.size(); ++i)
+    case KNSyntaxDefinition::WordDetect:
+    {
+        int end = pos + rule.string.size();
+        if((pos > 0 &&
+            !m_definition->isDeliminator(rule.language, text.at(pos - 1))) ||
+                !matchAt(text, pos, rule.string, rule.insensitive) ||
+                (end < length &&
+                 !m_definition->isDeliminator(rule.language, text.at(end))))
+        {
+            return -1;
+        }
+        return end;
+    }
+    case KNSyntaxDefinition::RegExpr:
     {
-        //Check the part type.
-        auto node = parts.at(i);
-        auto nodeName = node.nodeName();
-        if(nodeName == "list")
+        QRegularExpressionMatch match;
+        if(rule.dynamic)
+        {
+            //Compile the expression once for each substituted pattern.
+            int options = rule.regExp.patternOptions();
+            QString pattern = replaceCaptures(rule.string, captures, true),
+                    key = QString::number(options) + ':' + pattern;
+            auto iter = m_dynamicRegExps.constFind(key);
+            if(iter == m_dynamicRegExps.constEnd())
+            {
+                if(m_dynamicRegExps.size() >= MAX_DYNAMIC_REGEXPS)
+                {
+                    m_dynamicRegExps.clear();
+                }
+                QRegularExpression regExp(pattern,
+                                          rule.regExp.patternOptions());
+                regExp.optimize();
+                iter = m_dynamicRegExps.insert(key, regExp);
+            }
+            match = iter->match(text, pos, QRegularExpression::NormalMatch,
+                                ANCHORED_MATCH);
+        }
+        else
         {
-            auto element = node.toElement();
-            //Parse the list.
-            QString listName = element.attribute("name");
-            //Parse the internal items.
-            auto listItems = element.childNodes();
-            QStringList listContents;
-            listContents.reserve(listItems.size());
-            for(int j=0; j<listItems.size(); ++j)
+            //Search once for the next match of the line, the expression
+            //could not match before that position.
+            int &next = m_regExpNext[rule.regExpIndex];
+            if(pos < next)
+            {
+                return -1;
+            }
+            if(pos == next)
+            {
+                match = rule.regExp.match(text, pos,
+                                          QRegularExpression::NormalMatch,
+                                          ANCHORED_MATCH);
+            }
+            else
             {
-                //Append the internal data.
-                if(QDomNode::ElementNode == listItems.at(j).nodeType())
+                match = rule.regExp.match(text, pos);
+                next = match.hasMatch() ? match.capturedStart() : length;
+                if(next != pos)
                 {
-                    //Extract its internal content.
-                    listContents.append(listItems.at(j).toElement().text());
+                    return -1;
                 }
             }
-            //Insert the list data to lists.
-            lists.insert(listName,
-                         QString("\\b(%1)\\b").arg(listContents.join('|')));
         }
-        else if(nodeName == "contexts")
+        if(!match.hasMatch())
+        {
+            return -1;
+        }
+        //Save the captures for the dynamic context.
+        if(rule.target.push != -1 &&
+                m_definition->context(rule.target.push).dynamic)
+        {
+            matchCaptures = match.capturedTexts();
+        }
+        return match.capturedEnd();
+    }
+    case KNSyntaxDefinition::Keyword:
+    {
+        //The keyword must be a whole word.
+        if((pos > 0 &&
+            !m_definition->isDeliminator(rule.language, text.at(pos - 1))) ||
+                m_definition->isDeliminator(rule.language, c))
+        {
+            return -1;
+        }
+        int end = pos + 1;
+        while(end < length &&
+              !m_definition->isDeliminator(rule.language, text.at(end)))
+        {
+            ++end;
+        }
+        //Check the word without copying the text.
+        return m_definition->isKeyword(rule.keywordList, text.constData() + pos,
+                                       end - pos, rule.insensitive) ? end : -1;
+    }
+    case KNSyntaxDefinition::DetectSpaces:
+    {
+        int end = pos;
+        while(end < length && text.at(end).isSpace())
+        {
+            ++end;
+        }
+        return end;
+    }
+    case KNSyntaxDefinition::DetectIdentifier:
+    {
+        if(!c.isLetter() && c != '_')
         {
-            //Parse the contexts.
-            ;
+            return -1;
         }
-        else if(nodeName == "itemDatas")
+        int end = pos + 1;
+        while(end < length &&
+              (text.at(end).isLetterOrNumber() || text.at(end) == '_'))
+        {
+            ++end;
+        }
+        return end;
+    }
+    case KNSyntaxDefinition::RangeDetect:
+    {
+        if(c != rule.char0)
         {
-            //Parse the item datas.
-            ;
+            return -1;
         }
+        int close = text.indexOf(rule.char1, pos + 1);
+        return close == -1 ? -1 : close + 1;
+    }
+    case KNSyntaxDefinition::LineContinue:
+        return (pos == length - 1 && c == rule.char0) ? length : -1;
+    default:
+        return -1;
     }
 }
 
-void KNCodeSyntaxHighlighter::loadDir(const QString &dirPath, QHash<QString, int> &priorityMap)
+void KNCodeSyntaxHighlighter::switchContext(
+        QVector<int> &stack,
+        const KNSyntaxDefinition::ContextSwitch &contextSwitch,
+        const QStringList &captures)
 {
-    //List the dir information.
-    QDir syntaxDir(dirPath);
-    QStringList syntaxType;
-    syntaxType << "*.xml";
-    auto fileList = syntaxDir.entryList(syntaxType);
-    for(auto fileName : fileList)
+    //The initial context is never popped.
+    int pops = qMin(contextSwitch.pops, (stack.size() >> 1) - 1);
+    stack.resize(stack.size() - (pops << 1));
+    if(contextSwitch.push != -1 && stack.size() < (MAX_STACK_DEPTH << 1))
     {
-        //Load the xml information.
-        loadXml(syntaxDir.filePath(fileName), priorityMap);
+        stack.append(contextSwitch.push);
+        stack.append(m_definition->context(contextSwitch.push).dynamic ?
+                         captureId(captures) : 0);
     }
 }
 
-void KNCodeSyntaxHighlighter::loadXml(const QString &xmlPath, QHash<QString, int> &priorityMap)
+int KNCodeSyntaxHighlighter::stateId(const QVector<int> &stack)
 {
-    //Load the XML file and only record its header.
-    QFile xmlFile(xmlPath);
-    if(!xmlFile.open(QIODevice::ReadOnly))
+    auto stateIter = m_stateIds.constFind(stack);
+    if(stateIter != m_stateIds.constEnd())
     {
-        return;
+        return stateIter.value();
+    }
+    //Intern the new stack.
+    int id = m_states.size();
+    m_states.append(stack);
+    m_stateIds.insert(stack, id);
+    return id;
+}
+
+int KNCodeSyntaxHighlighter::captureId(const QStringList &captures)
+{
+    auto captureIter = m_captureIds.constFind(captures);
+    if(captureIter != m_captureIds.constEnd())
+    {
+        return captureIter.value();
     }
-    //Set the document.
-    QDomDocument syntaxDoc;
-    if(!syntaxDoc.setContent(&xmlFile))
+    int id = m_captures.size();
+    m_captures.append(captures);
+    m_captureIds.insert(captures, id);
+    return id;
+}
+
+void KNCodeSyntaxHighlighter::addFormat(int start, int end, int attribute)
+{
+    //Merge the continuous text with the same attribute into one run.
+    if(attribute == m_runAttribute && start == m_runEnd)
     {
-        xmlFile.close();
+        m_runEnd = end;
         return;
     }
-    xmlFile.close();
-    //Show the information.
-    auto header = syntaxDoc.firstChildElement("language");
-    auto syntaxName = header.attribute("name"),
-            syntaxExts = header.attribute("extensions");
-    int syntaxPriority = header.attribute("priority").toInt();
-    //Insert the file to file map.
-    namePathMap.insert(syntaxName, xmlPath);
-    //Also insert for its priority.
-    priorityMap.insert(syntaxName, syntaxPriority);
-    //Extract the syntax extensions.
-    auto extensions = syntaxExts.split(';');
-    for(auto ext : extensions)
-    {
-        if(ext.isEmpty())
-        {
-            continue;
-        }
-        int dotPos = ext.indexOf('.');
-        if(dotPos > -1)
-        {
-            //Only save the data after first dot.
-            ext = ext.mid(dotPos + 1);
-        }
-        if(!extMap.contains(ext) ||
-                syntaxPriority > priorityMap.value(extMap.value(ext)))
+    flushFormat();
+    m_runStart = start;
+    m_runEnd = end;
+    m_runAttribute = attribute;
+}
+
+void KNCodeSyntaxHighlighter::flushFormat()
+{
+    //The normal text do not need to be set.
+    if(m_runEnd > m_runStart && !m_definition->isPlainFormat(m_runAttribute))
+    {
+        setFormat(m_runStart, m_runEnd - m_runStart,
+                  m_definition->format(m_runAttribute));
+        if(m_recordRuns)
         {
-            //Update the extsion value.
-            extMap.insert(ext, syntaxName);
+            m_formatRuns << m_runStart << (m_runEnd - m_runStart)
+                         << m_runAttribute;
         }
     }
+    m_runAttribute = -1;
 }
@@ -13,22 +13,23 @@
 #ifndef KNCODESYNTAXHIGHLIGHTER_H
 #define KNCODESYNTAXHIGHLIGHTER_H
 
-#include <QDomElement>
+#include <QSharedPointer>
+
+#include "knhighlightcache.h"
+#include "knsyntaxdefinition.h"
 
 #include "knsyntaxhighlighter.h"
 
+/*!
+ * \brief The KNCodeSyntaxHighlighter class highlights the text with the rules
+ * of a Kate syntax definition. The context stack at the end of each block is
+ * saved as the block state, the stacks are interned so the same stack always
+ * gets the same state.
+ */
 class KNCodeSyntaxHighlighter : public KNSyntaxHighlighter
 {
     Q_OBJECT
 public:
-    struct SyntaxExt
-    {
-        const QString name;
-        const int priority;
-        SyntaxExt(const QString &n, int p) :
-            name(n), priority(p) {}
-    };
-
     explicit KNCodeSyntaxHighlighter(const QString &syntaxName,
                                      QObject *parent = nullptr);
 
@@ -43,16 +44,52 @@ public:
 
     bool hasCodeLevel() const override;
 
+    /*!
+     * \brief Reimplemented from KNSyntaxHighlighter::loadCache().
+     */
+    bool loadCache(const QString &filePath) override;
+
+    /*!
+     * \brief Reimplemented from KNSyntaxHighlighter::saveCache().
+     */
+    void saveCache(const QString &filePath) override;
+
 signals:
 
+protected:
+    /*!
+     * \brief Reimplemented from KNSyntaxHighlighter::syntaxProcess().
+     */
+    void syntaxProcess(const QString &text, KNTextBlockData *data) override;
+
 private:
-    void parseLanguageNode(const QDomElement &lan);
-    void parseHighlight(const QDomElement &highlights);
-    static QHash<QString, QString> extMap;
-    static QHash<QString, QString> namePathMap;
-    static bool syntaxLoaded;
-    static void loadDir(const QString &dirPath, QHash<QString, int> &priorityMap);
-    static void loadXml(const QString &xmlPath, QHash<QString, int> &priorityMap);
+    void resetStates();
+    bool applyCache(const QString &text, KNTextBlockData *data);
+    void highlightLine(const QString &text, QVector<int> &stack);
+    int matchRule(const KNSyntaxDefinition::Rule &rule, const QString &text,
+                  int pos, const QStringList &captures,
+                  QStringList &matchCaptures);
+    void switchContext(QVector<int> &stack,
+                       const KNSyntaxDefinition::ContextSwitch &contextSwitch,
+                       const QStringList &captures);
+    int stateId(const QVector<int> &stack);
+    int captureId(const QStringList &captures);
+    void addFormat(int start, int end, int attribute);
+    void flushFormat();
+    QSharedPointer<const KNSyntaxDefinition> m_definition;
+    //The context stack is saved as pairs of the context and its captures.
+    QVector<QVector<int>> m_states;
+    QHash<QVector<int>, int> m_stateIds;
+    QVector<QStringList> m_captures;
+    QHash<QStringList, int> m_captureIds;
+    QVector<int> m_regExpNext;
+    //The dynamic expressions compiled for the substituted patterns.
+    QHash<QString, QRegularExpression> m_dynamicRegExps;
+    QVector<int> m_regionMarks;
+    QVector<int> m_formatRuns;
+    KNHighlightCache m_cache;
+    int m_runStart, m_runEnd, m_runAttribute;
+    bool m_recordRuns;
 };
 
 #endif // KNCODESYNTAXHIGHLIGHTER_H
@@ -0,0 +1,282 @@
+/*
+ * Copyright (C) Kreogist Dev Team
+ *
+ * You can redistribute this software and/or modify it under the
+ * terms of the HARERU Software License; either version 1 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * license file for more details.
+ */
+#include <QFuture>
+#include <QThread>
+#include <QtConcurrent/QtConcurrent>
+
+#include "knlinesorter.h"
+#include "kntexteditor.h"
+#include "kntexttransform.h"
+
+#include "kndelimitedtext.h"
+
+//The minimum characters measured by one task.
+#define MEASURE_TASK_SIZE   (65536)
+
+static int fieldEnd(QStringView line, int start, QChar delimiter)
+{
+    //The delimiters in the quotes are a part of the field, an escaped quote
+    //toggles the state twice.
+    bool quoted = false;
+    for(int i=start; i<line.size(); ++i)
+    {
+        if(line.at(i) == '"')
+        {
+            quoted = !quoted;
+            continue;
+        }
+        if(!quoted && line.at(i) == delimiter)
+        {
+            return i;
+        }
+    }
+    return static_cast<int>(line.size());
+}
+
+static bool fieldRange(QStringView line, int column, QChar delimiter,
+                       int &start, int &length)
+{
+    start = 0;
+    for(int i=0; i<column; ++i)
+    {
+        int end = fieldEnd(line, start, delimiter);
+        if(end == line.size())
+        {
+            start = static_cast<int>(line.size());
+            length = 0;
+            return false;
+        }
+        start = end + 1;
+    }
+    length = fieldEnd(line, start, delimiter) - start;
+    return true;
+}
+
+static int fieldWidth(QStringView field)
+{
+    int width = 0;
+    for(const QChar &c : field)
+    {
+        width += KNTextEditor::charWidth(c);
+    }
+    return width;
+}
+
+KNDelimitedText::KNDelimitedText(const QString &text, QChar delimiter) :
+    m_text(text),
+    m_delimiter(delimiter)
+{
+}
+
+QChar KNDelimitedText::detectDelimiter(QStringView line)
+{
+    static const QChar candidates[] = {'\t', ',', ';', '|'};
+    int counts[4] = {0, 0, 0, 0};
+    bool quoted = false;
+    for(const QChar &c : line)
+    {
+        if(c == '"')
+        {
+            quoted = !quoted;
+            continue;
+        }
+        for(int i=0; !quoted && i<4; ++i)
+        {
+            counts[i] += (c == candidates[i]);
+        }
+    }
+    int best = 1;
+    for(int i=0; i<4; ++i)
+    {
+        if(counts[i] > counts[best])
+        {
+            best = i;
+        }
+    }
+    return candidates[best];
+}
+
+int KNDelimitedText::columnAt(QStringView line, int position, QChar delimiter)
+{
+    int column = 0, start = 0;
+    while(true)
+    {
+        int end = fieldEnd(line, start, delimiter);
+        if(position <= end || end == line.size())
+        {
+            return column;
+        }
+        ++column;
+        start = end + 1;
+    }
+}
+
+QChar KNDelimitedText::delimiter() const
+{
+    return m_delimiter;
+}
+
+QString KNDelimitedText::sortByColumn(int column, int mode, int options) const
+{
+    QChar delimiter = m_delimiter;
+    return KNLineSorter::sort(m_text, mode, options, [=](
+                              QStringView line, int &keyStart, int &keyLength)
+    {
+        fieldRange(line, column, delimiter, keyStart, keyLength);
+        //The enclosing quotes are not a part of the key.
+        if(keyLength > 1 && line.at(keyStart) == '"' &&
+                line.at(keyStart + keyLength - 1) == '"')
+        {
+            ++keyStart;
+            keyLength -= 2;
+        }
+    });
+}
+
+QString KNDelimitedText::extractColumn(int column) const
+{
+    QChar delimiter = m_delimiter;
+    return KNTextTransform::mapLines(m_text, [=](QStringView line)
+    {
+        int start, length;
+        fieldRange(line, column, delimiter, start, length);
+        return line.mid(start, length).toString();
+    });
+}
+
+QString KNDelimitedText::removeColumn(int column) const
+{
+    QChar delimiter = m_delimiter;
+    return KNTextTransform::mapLines(m_text, [=](QStringView line)
+    {
+        int start, length;
+        if(!fieldRange(line, column, delimiter, start, length))
+        {
+            return line.toString();
+        }
+        //Remove the delimiter after the field, or the delimiter before the
+        //last field.
+        int end = start + length;
+        if(end < line.size())
+        {
+            ++end;
+        }
+        else if(start > 0)
+        {
+            --start;
+        }
+        return line.left(start).toString() + line.mid(end).toString();
+    });
+}
+
+QString KNDelimitedText::alignColumns() const
+{
+    QChar delimiter = m_delimiter;
+    const QVector<int> widths = columnWidths();
+    return KNTextTransform::mapLines(m_text, [=](QStringView line)
+    {
+        QString result;
+        result.reserve(static_cast<int>(line.size()));
+        int start = 0;
+        for(int column = 0; ; ++column)
+        {
+            int end = fieldEnd(line, start, delimiter);
+            QStringView field = line.mid(start, end - start);
+            result.append(field.toString());
+            if(end == line.size())
+            {
+                return result;
+            }
+            result.append(QString(widths.at(column) - fieldWidth(field), ' '));
+            result.append(delimiter);
+            start = end + 1;
+        }
+    });
+}
+
+QVector<int> KNDelimitedText::columnWidths() const
+{
+    //Split the text at the line ends, the last part ends at the text end.
+    int taskSize = qMax(MEASURE_TASK_SIZE,
+                        m_text.length() / qMax(1, QThread::idealThreadCount()));
+    QVector<QFuture<QVector<int>>> tasks;
+    for(int partStart = 0; partStart <= m_text.length(); )
+    {
+        int partEnd = m_text.length();
+        if(partEnd - partStart > taskSize)
+        {
+            int lineEnd = m_text.indexOf('\n', partStart + taskSize);
+            if(lineEnd != -1)
+            {
+                partEnd = lineEnd;
+            }
+        }
+        tasks.append(QtConcurrent::run([=]
+        {
+            return columnWidths(partStart, partEnd);
+        }));
+        partStart = partEnd + 1;
+    }
+    //Combine the widest fields of the parts.
+    QVector<int> widths;
+    for(int i=0; i<tasks.size(); ++i)
+    {
+        const QVector<int> partWidths = tasks[i].result();
+        if(widths.size() < partWidths.size())
+        {
+            widths.resize(partWidths.size());
+        }
+        for(int j=0; j<partWidths.size(); ++j)
+        {
+            widths[j] = qMax(widths.at(j), partWidths.at(j));
+        }
+    }
+    return widths;
+}
+
+QVector<int> KNDelimitedText::columnWidths(int from, int to) const
+{
+    QVector<int> widths;
+    int lineStart = from;
+    while(true)
+    {
+        int lineEnd = m_text.indexOf('\n', lineStart);
+        if(lineEnd == -1 || lineEnd > to)
+        {
+            lineEnd = to;
+        }
+        //Measure the display width of the fields.
+        QStringView line(m_text.constData() + lineStart, lineEnd - lineStart);
+        int start = 0;
+        for(int column = 0; ; ++column)
+        {
+            int end = fieldEnd(line, start, m_delimiter);
+            if(column == widths.size())
+            {
+                widths.append(0);
+            }
+            widths[column] = qMax(widths.at(column),
+                                  fieldWidth(line.mid(start, end - start)));
+            if(end == line.size())
+            {
+                break;
+            }
+            start = end + 1;
+        }
+        if(lineEnd == to)
+        {
+            return widths;
+        }
+        lineStart = lineEnd + 1;
+    }
+}
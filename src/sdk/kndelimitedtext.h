@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) Kreogist Dev Team
+ *
+ * You can redistribute this software and/or modify it under the
+ * terms of the HARERU Software License; either version 1 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * license file for more details.
+ */
+#ifndef KNDELIMITEDTEXT_H
+#define KNDELIMITEDTEXT_H
+
+#include <QString>
+#include <QStringView>
+#include <QVector>
+
+/*!
+ * \brief The KNDelimitedText class provides the column operations on the
+ * delimited data, such as CSV and TSV. Each line is a record, and the fields
+ * are split by the delimiter outside the double quotes.\n
+ * The column operations stream over the lines and produce the whole transformed
+ * text, which is written back as a bulk transform. Only the column alignment
+ * needs the display width of each column, which is measured in parallel before
+ * the lines are padded.
+ */
+class KNDelimitedText
+{
+public:
+    /*!
+     * \brief Construct a KNDelimitedText object.
+     * \param text The lines separated by line feeds.
+     * \param delimiter The field delimiter.
+     */
+    KNDelimitedText(const QString &text, QChar delimiter);
+
+    /*!
+     * \brief Guess the delimiter from a line, the delimiter is the most used
+     * one of tab, comma, semicolon and vertical bar.
+     * \param line The line text.
+     * \return The delimiter. If none of them is used, return comma.
+     */
+    static QChar detectDelimiter(QStringView line);
+
+    /*!
+     * \brief Find the column at a position of a line.
+     * \param line The line text.
+     * \param position The character position in the line.
+     * \param delimiter The field delimiter.
+     * \return The column index.
+     */
+    static int columnAt(QStringView line, int position, QChar delimiter);
+
+    /*!
+     * \brief Get the field delimiter.
+     * \return The delimiter character.
+     */
+    QChar delimiter() const;
+
+    /*!
+     * \brief Sort the lines by the fields of a column. The enclosing quotes of
+     * the fields are not compared, the lines without the column have the empty
+     * key.
+     * \param column The column index.
+     * \param mode The sort mode, it should be a KNLineSorter::SortMode.
+     * \param options The KNLineSorter::SortOption flags.
+     * \return The sorted lines.
+     */
+    QString sortByColumn(int column, int mode, int options = 0) const;
+
+    /*!
+     * \brief Extract the fields of a column.
+     * \param column The column index.
+     * \return The fields of the column, one field a line.
+     */
+    QString extractColumn(int column) const;
+
+    /*!
+     * \brief Remove a column with its delimiter from all the lines.
+     * \param column The column index.
+     * \return The lines without the column.
+     */
+    QString removeColumn(int column) const;
+
+    /*!
+     * \brief Pad the fields with spaces before the delimiters, so the columns
+     * are aligned when the text is displayed.
+     * \return The aligned lines.
+     */
+    QString alignColumns() const;
+
+private:
+    QVector<int> columnWidths() const;
+    QVector<int> columnWidths(int from, int to) const;
+    QString m_text;
+    QChar m_delimiter;
+};
+
+#endif // KNDELIMITEDTEXT_H
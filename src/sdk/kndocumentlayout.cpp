@@ -10,26 +10,426 @@
  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
  * license file for more details.
  */
+#include <algorithm>
+#include <QFontMetricsF>
 #include <QTextBlock>
-#include <QPainter>
+#include <QTextCursor>
+#include <QTextDocument>
+#include <QTextLayout>
+
+#include "knframeprofiler.h"
+#include "kntextblockdata.h"
 
 #include "kndocumentlayout.h"
 
+#define SEGMENT_LENGTH          (1024)
+#define MAX_SHAPED_SEGMENTS     (64)
+
 KNDocumentLayout::KNDocumentLayout(QTextDocument *document) :
-    QPlainTextDocumentLayout(document)
+    QPlainTextDocumentLayout(document),
+    m_longLineWidth(0.0),
+    m_charWidth(0.0),
+    m_lineHeight(0.0),
+    m_longLineThreshold(10000),
+    m_blockCount(document->blockCount())
+{
+}
+
+int KNDocumentLayout::longLineThreshold() const
+{
+    return m_longLineThreshold;
+}
+
+void KNDocumentLayout::setLongLineThreshold(int threshold)
+{
+    //Check whether the threshold is changed.
+    if(m_longLineThreshold == threshold)
+    {
+        return;
+    }
+    m_longLineThreshold = threshold;
+    //Relayout the entire document.
+    m_longLineWidth = 0.0;
+    documentChanged(0, 0, document()->characterCount());
+}
+
+bool KNDocumentLayout::isLongBlock(const QTextBlock &block) const
+{
+    return m_longLineThreshold > 0 && block.length() > m_longLineThreshold;
+}
+
+int KNDocumentLayout::segmentCount(const QTextBlock &block) const
 {
+    KNTextBlockData *data = segmentData(block);
+    return data ? data->segmentStarts.size() : 0;
 }
 
-void KNDocumentLayout::draw(
-        QPainter *painter,
-        const QAbstractTextDocumentLayout::PaintContext &context)
+int KNDocumentLayout::segmentAt(const QTextBlock &block, qreal x) const
 {
-    painter->drawRect(context.clip);
+    KNTextBlockData *data = segmentData(block);
+    if(!data || data->segmentStarts.isEmpty())
+    {
+        return 0;
+    }
+    //The segments are sorted by their x position, binary search the segment.
+    const QVector<qreal> &segmentX = data->segmentX;
+    auto iter = std::upper_bound(segmentX.constBegin(),
+                                 segmentX.constEnd() - 1, x);
+    return qMax(0, static_cast<int>(iter - segmentX.constBegin()) - 1);
 }
 
-void KNDocumentLayout::documentChanged(int from, int charsRemoved, int charsAdded)
+int KNDocumentLayout::segmentStart(const QTextBlock &block, int segment) const
 {
-    //Broadcast this layout.
-    //Do original document changed
+    return segmentData(block)->segmentStarts.at(segment);
+}
+
+qreal KNDocumentLayout::segmentX(const QTextBlock &block, int segment) const
+{
+    return segmentData(block)->segmentX.at(segment);
+}
+
+QTextLayout *KNDocumentLayout::segmentLayout(const QTextBlock &block,
+                                             int segment)
+{
+    KNTextBlockData *data = segmentData(block);
+    QTextLayout *layout = data->segmentLayouts.at(segment);
+    if(layout)
+    {
+        return layout;
+    }
+    KNProfileScope profileScope(KNFrameProfiler::Layout);
+    //Free the shaped segments when there are too many of them.
+    if(data->shapedSegments >= MAX_SHAPED_SEGMENTS)
+    {
+        for(int i=0; i<data->segmentLayouts.size(); ++i)
+        {
+            delete data->segmentLayouts.at(i);
+            data->segmentLayouts[i] = nullptr;
+        }
+        data->shapedSegments = 0;
+    }
+    //Copy the text of the segment from the document.
+    QTextDocument *doc = document();
+    int start = data->segmentStarts.at(segment),
+        end = segment + 1 < data->segmentStarts.size() ?
+                data->segmentStarts.at(segment + 1) : data->segmentLength;
+    QTextCursor cursor(doc);
+    cursor.setPosition(block.position() + start);
+    cursor.setPosition(block.position() + end, QTextCursor::KeepAnchor);
+    layout = new QTextLayout(cursor.selectedText(), doc->defaultFont());
+    QTextOption option = doc->defaultTextOption();
+    option.setWrapMode(QTextOption::NoWrap);
+    layout->setTextOption(option);
+    //Move the formats of the block inside the segment, the formats are sorted
+    //by their start positions.
+    const auto formats = block.layout()->formats();
+    auto iter = std::upper_bound(
+                formats.constBegin(), formats.constEnd(), start,
+                [](int position, const QTextLayout::FormatRange &range)
+    {
+        return position < range.start;
+    });
+    if(iter != formats.constBegin())
+    {
+        --iter;
+    }
+    QVector<QTextLayout::FormatRange> ranges;
+    for(; iter != formats.constEnd() && iter->start < end; ++iter)
+    {
+        int rangeStart = qMax(iter->start, start),
+            rangeEnd = qMin(iter->start + iter->length, end);
+        if(rangeStart < rangeEnd)
+        {
+            QTextLayout::FormatRange range;
+            range.start = rangeStart - start;
+            range.length = rangeEnd - rangeStart;
+            range.format = iter->format;
+            ranges.append(range);
+        }
+    }
+    layout->setFormats(ranges);
+    //Shape the segment as one line.
+    layout->beginLayout();
+    QTextLine line = layout->createLine();
+    if(line.isValid())
+    {
+        line.setLeadingIncluded(true);
+        line.setNumColumns(end - start);
+        line.setPosition(QPointF(0, 0));
+    }
+    layout->endLayout();
+    data->segmentLayouts[segment] = layout;
+    ++data->shapedSegments;
+    //Move the following segments when the estimated width is not correct.
+    qreal shift = (line.isValid() ? line.naturalTextWidth() : 0.0) -
+            (data->segmentX.at(segment + 1) - data->segmentX.at(segment));
+    if(!qFuzzyIsNull(shift))
+    {
+        for(int i=segment + 1; i<data->segmentX.size(); ++i)
+        {
+            data->segmentX[i] += shift;
+        }
+        updateLongLineWidth(data->segmentX.last() + doc->documentMargin());
+    }
+    return layout;
+}
+
+int KNDocumentLayout::hitTestLongBlock(const QTextBlock &block, qreal x)
+{
+    if(!segmentCount(block))
+    {
+        return 0;
+    }
+    int segment = segmentAt(block, x);
+    QTextLayout *layout = segmentLayout(block, segment);
+    return segmentStart(block, segment) +
+            layout->lineAt(0).xToCursor(x - segmentX(block, segment));
+}
+
+qreal KNDocumentLayout::cursorToXLongBlock(const QTextBlock &block,
+                                           int position)
+{
+    if(!segmentCount(block))
+    {
+        return 0.0;
+    }
+    //Find the segment which contains the position.
+    const QVector<int> &starts = segmentData(block)->segmentStarts;
+    int segment = qMax(0, static_cast<int>(
+                           std::upper_bound(starts.constBegin(),
+                                            starts.constEnd(), position) -
+                           starts.constBegin()) - 1);
+    QTextLayout *layout = segmentLayout(block, segment);
+    return segmentX(block, segment) +
+            layout->lineAt(0).cursorToX(position - starts.at(segment));
+}
+
+QRectF KNDocumentLayout::blockBoundingRect(const QTextBlock &block) const
+{
+    //Normal blocks are laid out by the plain text layout.
+    if(!block.isValid() || !isLongBlock(block))
+    {
+        return QPlainTextDocumentLayout::blockBoundingRect(block);
+    }
+    if(!block.isVisible())
+    {
+        return QRectF();
+    }
+    //The segments are laid out when the document is changed. The plain text
+    //edit looks for the line of the cursor inside every block which has a
+    //valid rect, while the layout of a long block never has any line. The
+    //width of the rect is left empty, the editor scrolls to the cursor through
+    //the segments.
+    QRectF br(0, 0, 0, m_lineHeight);
+    if(!block.next().isValid())
+    {
+        br.adjust(0, 0, 0, document()->documentMargin());
+    }
+    return br;
+}
+
+QSizeF KNDocumentLayout::documentSize() const
+{
+    //The long blocks are not counted by the plain text layout.
+    QSizeF size = QPlainTextDocumentLayout::documentSize();
+    size.setWidth(qMax(size.width(), m_longLineWidth));
+    return size;
+}
+
+void KNDocumentLayout::documentChanged(int from, int charsRemoved,
+                                       int charsAdded)
+{
+    KNProfileScope profileScope(KNFrameProfiler::Layout);
+    QTextDocument *doc = document();
+    int charsChanged = charsRemoved + charsAdded;
+    QTextBlock changeStartBlock = doc->findBlock(from),
+            changeEndBlock = doc->findBlock(qMax(0, from + charsChanged - 1));
+    //When the change is only inside a long block, the plain text layout would
+    //lay it out as a single line, update the changed segments instead.
+    if(changeStartBlock == changeEndBlock && isLongBlock(changeStartBlock)
+            && doc->blockCount() == m_blockCount)
+    {
+        changeStartBlock.clearLayout();
+        updateLongBlock(changeStartBlock, from - changeStartBlock.position(),
+                        charsRemoved, charsAdded);
+        emit update();
+        return;
+    }
+    //Reset the long line width when the entire document is replaced.
+    if(from == 0 && charsAdded >= doc->characterCount() - 1)
+    {
+        m_longLineWidth = 0.0;
+    }
+    //Do original document changed.
     QPlainTextDocumentLayout::documentChanged(from, charsRemoved, charsAdded);
+    m_blockCount = doc->blockCount();
+    //Lay out the segments of the changed long blocks, the segments of the
+    //other blocks are out of date.
+    for(QTextBlock block = changeStartBlock; block.isValid();
+        block = block.next())
+    {
+        if(isLongBlock(block))
+        {
+            layoutLongBlock(block);
+        }
+        else
+        {
+            clearSegments(block);
+        }
+        if(block == changeEndBlock)
+        {
+            break;
+        }
+    }
+}
+
+KNTextBlockData *KNDocumentLayout::segmentData(const QTextBlock &block) const
+{
+    return static_cast<KNTextBlockData *>(block.userData());
+}
+
+void KNDocumentLayout::layoutLongBlock(const QTextBlock &block)
+{
+    KNProfileScope profileScope(KNFrameProfiler::Layout);
+    KNTextBlockData *data = segmentData(block);
+    if(!data)
+    {
+        data = new KNTextBlockData;
+        QTextBlock(block).setUserData(data);
+    }
+    QTextDocument *doc = document();
+    //Long blocks are never wrapped, the widths of the segments are estimated
+    //from the character width of the font before they are shaped.
+    QFontMetricsF metrics(doc->defaultFont());
+    m_charWidth = metrics.horizontalAdvance(QLatin1Char(' '));
+    m_lineHeight = metrics.ascent() + metrics.descent() +
+            qMax<qreal>(0.0, metrics.leading());
+    qDeleteAll(data->segmentLayouts);
+    data->segmentLayouts.clear();
+    data->segmentStarts.clear();
+    data->segmentX.clear();
+    data->shapedSegments = 0;
+    int length = block.length() - 1, start = 0;
+    qreal x = doc->documentMargin();
+    while(start < length)
+    {
+        int end = segmentEnd(block, start + SEGMENT_LENGTH, length);
+        data->segmentStarts.append(start);
+        data->segmentX.append(x);
+        data->segmentLayouts.append(nullptr);
+        x += (end - start) * m_charWidth;
+        start = end;
+    }
+    data->segmentX.append(x);
+    data->segmentLength = length;
+    //The segments are displayed as one visual line.
+    QTextBlock(block).setLineCount(block.isVisible() ? 1 : 0);
+    updateLongLineWidth(x + doc->documentMargin());
+}
+
+void KNDocumentLayout::updateLongBlock(const QTextBlock &block, int position,
+                                       int charsRemoved, int charsAdded)
+{
+    KNTextBlockData *data = segmentData(block);
+    int length = block.length() - 1, delta = charsAdded - charsRemoved;
+    //Lay out the entire block when the segments are not matched.
+    if(!data || data->segmentStarts.isEmpty() ||
+            data->segmentLength != length - delta)
+    {
+        layoutLongBlock(block);
+        return;
+    }
+    KNProfileScope profileScope(KNFrameProfiler::Layout);
+    //Find the segments which contain the changed text.
+    const QVector<int> &starts = data->segmentStarts;
+    int count = starts.size(),
+        first = qMax(0, static_cast<int>(
+                     std::upper_bound(starts.constBegin(), starts.constEnd(),
+                                      position) - starts.constBegin()) - 1),
+        last = qMax(first, static_cast<int>(
+                        std::upper_bound(starts.constBegin(), starts.constEnd(),
+                                         position + charsRemoved - 1) -
+                        starts.constBegin()) - 1);
+    int start = starts.at(first),
+        end = (last + 1 < count ? starts.at(last + 1) : data->segmentLength)
+            + delta;
+    //Keep the segments before the change.
+    QVector<int> segmentStarts = starts.mid(0, first);
+    QVector<qreal> segmentX = data->segmentX.mid(0, first);
+    QVector<QTextLayout *> segmentLayouts = data->segmentLayouts.mid(0, first);
+    for(int i=first; i<=last; ++i)
+    {
+        if(data->segmentLayouts.at(i))
+        {
+            delete data->segmentLayouts.at(i);
+            --data->shapedSegments;
+        }
+    }
+    //Split the changed text again, a segment is only split when it is twice
+    //longer than the segment length.
+    int pieceLength = end - start > (SEGMENT_LENGTH << 1) ?
+                SEGMENT_LENGTH : end - start;
+    qreal x = data->segmentX.at(first);
+    while(start < end)
+    {
+        int pieceEnd = segmentEnd(block, start + pieceLength, end);
+        segmentStarts.append(start);
+        segmentX.append(x);
+        segmentLayouts.append(nullptr);
+        x += (pieceEnd - start) * m_charWidth;
+        start = pieceEnd;
+    }
+    //Move the segments after the change.
+    qreal shift = x - data->segmentX.at(last + 1);
+    for(int i=last + 1; i<count; ++i)
+    {
+        segmentStarts.append(starts.at(i) + delta);
+        segmentX.append(data->segmentX.at(i) + shift);
+        segmentLayouts.append(data->segmentLayouts.at(i));
+    }
+    segmentX.append(data->segmentX.last() + shift);
+    data->segmentStarts = segmentStarts;
+    data->segmentX = segmentX;
+    data->segmentLayouts = segmentLayouts;
+    data->segmentLength = length;
+    updateLongLineWidth(segmentX.last() + document()->documentMargin());
+}
+
+void KNDocumentLayout::clearSegments(const QTextBlock &block)
+{
+    KNTextBlockData *data = segmentData(block);
+    if(data && !data->segmentStarts.isEmpty())
+    {
+        qDeleteAll(data->segmentLayouts);
+        data->segmentLayouts.clear();
+        data->segmentStarts.clear();
+        data->segmentX.clear();
+        data->segmentLength = 0;
+        data->shapedSegments = 0;
+    }
+}
+
+int KNDocumentLayout::segmentEnd(const QTextBlock &block, int end,
+                                 int limit) const
+{
+    if(end >= limit)
+    {
+        return limit;
+    }
+    //Never split a surrogate pair into two segments.
+    if(document()->characterAt(block.position() + end - 1).isHighSurrogate())
+    {
+        ++end;
+    }
+    return end;
+}
+
+void KNDocumentLayout::updateLongLineWidth(qreal width)
+{
+    //Update the document width.
+    if(width > m_longLineWidth)
+    {
+        m_longLineWidth = width;
+        emit documentSizeChanged(documentSize());
+    }
 }
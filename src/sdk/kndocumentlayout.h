@@ -15,19 +15,129 @@
 
 #include <QPlainTextDocumentLayout>
 
+class KNTextBlockData;
+/*!
+ * \brief The KNDocumentLayout class is the plain text document layout used by
+ * the text editor. Besides the original plain text layout, it lays out the
+ * blocks longer than the long line threshold as a row of horizontal segments.
+ * Only the positions of the segments are kept for the whole block, their widths
+ * are estimated from the character counts. A segment is shaped into its own
+ * QTextLayout only when it is painted or hit tested, and an edit only resets the
+ * segments it touches.
+ */
 class KNDocumentLayout : public QPlainTextDocumentLayout
 {
     Q_OBJECT
 public:
+    /*!
+     * \brief Construct a KNDocumentLayout object.
+     * \param document The document which uses the layout.
+     */
     explicit KNDocumentLayout(QTextDocument *document);
 
-    void draw(QPainter *painter, const PaintContext &context) override;
+    /*!
+     * \brief Get the long line threshold.
+     * \return The character count limit of a block before it is laid out in
+     * segments. 0 means the long line layout is disabled.
+     */
+    int longLineThreshold() const;
+
+    /*!
+     * \brief Set the long line threshold.
+     * \param threshold The character count limit of a block.
+     */
+    void setLongLineThreshold(int threshold);
+
+    /*!
+     * \brief Check whether a block is laid out in horizontal segments.
+     * \param block The text block.
+     * \return If the block is a long block, return true.
+     */
+    bool isLongBlock(const QTextBlock &block) const;
+
+    /*!
+     * \brief Get the number of the segments of a long block.
+     * \param block The long block.
+     * \return The segment count.
+     */
+    int segmentCount(const QTextBlock &block) const;
+
+    /*!
+     * \brief Find the segment of a long block at a specific x position.
+     * \param block The long block.
+     * \param x The x position in the block coordinate.
+     * \return The segment index.
+     */
+    int segmentAt(const QTextBlock &block, qreal x) const;
+
+    /*!
+     * \brief Get the start position of a segment.
+     * \param block The long block.
+     * \param segment The segment index.
+     * \return The position of the first character of the segment in the block.
+     */
+    int segmentStart(const QTextBlock &block, int segment) const;
+
+    /*!
+     * \brief Get the x position of a segment.
+     * \param block The long block.
+     * \param segment The segment index.
+     * \return The left edge of the segment in the block coordinate.
+     */
+    qreal segmentX(const QTextBlock &block, int segment) const;
+
+    /*!
+     * \brief Get the shaped layout of a segment. The segment is shaped when it
+     * is not shaped yet, the positions of the following segments will be moved
+     * when the shaped width is different from the estimated width.
+     * \param block The long block.
+     * \param segment The segment index.
+     * \return The layout of the segment, which has one line at (0, 0).
+     */
+    QTextLayout *segmentLayout(const QTextBlock &block, int segment);
+
+    /*!
+     * \brief Find the cursor position of a long block at a x position.
+     * \param block The long block.
+     * \param x The x position in the block coordinate.
+     * \return The cursor position in the block.
+     */
+    int hitTestLongBlock(const QTextBlock &block, qreal x);
+
+    /*!
+     * \brief Get the x position of a cursor position in a long block.
+     * \param block The long block.
+     * \param position The cursor position in the block.
+     * \return The x position in the block coordinate.
+     */
+    qreal cursorToXLongBlock(const QTextBlock &block, int position);
+
+    /*!
+     * \brief Reimplemented from QPlainTextDocumentLayout::blockBoundingRect().
+     */
+    QRectF blockBoundingRect(const QTextBlock &block) const override;
 
-signals:
+    /*!
+     * \brief Reimplemented from QPlainTextDocumentLayout::documentSize().
+     */
+    QSizeF documentSize() const override;
 
 protected:
+    /*!
+     * \brief Reimplemented from QPlainTextDocumentLayout::documentChanged().
+     */
     void documentChanged(int from, int charsRemoved, int charsAdded) override;
 
+private:
+    KNTextBlockData *segmentData(const QTextBlock &block) const;
+    void layoutLongBlock(const QTextBlock &block);
+    void updateLongBlock(const QTextBlock &block, int position,
+                         int charsRemoved, int charsAdded);
+    void clearSegments(const QTextBlock &block);
+    int segmentEnd(const QTextBlock &block, int end, int limit) const;
+    void updateLongLineWidth(qreal width);
+    qreal m_longLineWidth, m_charWidth, m_lineHeight;
+    int m_longLineThreshold, m_blockCount;
 };
 
 #endif // KNDOCUMENTLAYOUT_H
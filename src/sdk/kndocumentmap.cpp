@@ -11,34 +11,372 @@
  * license file for more details.
  */
 #include <QPainter>
+#include <QScrollBar>
+#include <QTimer>
+#include <QMouseEvent>
+#include <QTextBlock>
 #include <QTextDocument>
-#include <QAbstractTextDocumentLayout>
+#include <QTextLayout>
+#include <QtConcurrent/QtConcurrent>
+
+#include "knglobal.h"
+#include "kntexteditor.h"
 
 #include "kndocumentmap.h"
 
+#define TILE_HEIGHT     (128)
+#define SAMPLE_LINES    (4)
+#define RENDER_DELAY    (50)
+
 KNDocumentMap::KNDocumentMap(QWidget *parent) :
     QWidget(parent),
-    m_document(nullptr)
+    m_renderTimer(new QTimer(this)),
+    m_linesPerRow(1),
+    m_rowCount(0),
+    m_blockCount(0),
+    m_generation(0),
+    m_renderIndex(-1),
+    m_renderGeneration(-1)
+{
+    //Coalesce the content changes before rendering.
+    m_renderTimer->setSingleShot(true);
+    m_renderTimer->setInterval(RENDER_DELAY);
+    connect(m_renderTimer, &QTimer::timeout,
+            this, &KNDocumentMap::renderNextTile);
+    connect(&m_watcher, &QFutureWatcher<QImage>::finished,
+            this, &KNDocumentMap::onTileRendered);
+}
+
+KNDocumentMap::~KNDocumentMap()
 {
+    //Wait for the rendering tile.
+    m_watcher.waitForFinished();
+}
+
+void KNDocumentMap::setEditor(KNTextEditor *editor)
+{
+    //Check whether the editor is changed.
+    if(m_editor == editor)
+    {
+        return;
+    }
+    //Disconnect the previous editor.
+    for(auto link : m_links)
+    {
+        disconnect(link);
+    }
+    m_links.clear();
+    m_editor = editor;
+    if(m_editor)
+    {
+        m_links.append(connect(m_editor->document(),
+                               &QTextDocument::contentsChange,
+                               this, &KNDocumentMap::onContentsChange));
+        m_links.append(connect(m_editor->verticalScrollBar(),
+                               &QScrollBar::valueChanged,
+                               this, [=]{ update(); }));
+    }
+    //Render the entire map of the new editor.
+    m_tiles.clear();
+    resetMap();
 }
 
 void KNDocumentMap::paintEvent(QPaintEvent *event)
 {
-    Q_UNUSED(event)
     QPainter painter(this);
-    if(m_document)
+    if(!m_editor)
+    {
+        return;
+    }
+    painter.fillRect(event->rect(), m_editor->palette().color(QPalette::Base));
+    //Blit the cached tiles.
+    for(int i=0; i<m_tiles.size(); ++i)
+    {
+        const QImage &tile = m_tiles.at(i);
+        if(!tile.isNull()
+                && event->rect().intersects(QRect(0, i * TILE_HEIGHT,
+                                                  tile.width(), TILE_HEIGHT)))
+        {
+            painter.drawImage(0, i * TILE_HEIGHT, tile);
+        }
+    }
+    //Draw the viewport indicator.
+    int top = m_editor->cursorForPosition(QPoint(0, 0)).blockNumber(),
+            bottom = m_editor->cursorForPosition(
+                QPoint(0, m_editor->viewport()->height() - 1)).blockNumber();
+    int indicatorTop = top / m_linesPerRow;
+    QColor indicatorColor = m_editor->palette().color(QPalette::Text);
+    indicatorColor.setAlpha(40);
+    painter.fillRect(QRect(0, indicatorTop, width(),
+                           bottom / m_linesPerRow - indicatorTop + 1),
+                     indicatorColor);
+}
+
+void KNDocumentMap::resizeEvent(QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+    //The lines per row and the tile width are changed.
+    resetMap();
+}
+
+void KNDocumentMap::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+    //Render the tiles changed when the map is hidden.
+    scheduleRender();
+}
+
+void KNDocumentMap::mousePressEvent(QMouseEvent *event)
+{
+    QWidget::mousePressEvent(event);
+    if(event->button() == Qt::LeftButton)
+    {
+        scrollToRow(event->pos().y());
+    }
+}
+
+void KNDocumentMap::mouseMoveEvent(QMouseEvent *event)
+{
+    QWidget::mouseMoveEvent(event);
+    if(event->buttons() & Qt::LeftButton)
+    {
+        scrollToRow(event->pos().y());
+    }
+}
+
+void KNDocumentMap::onContentsChange(int position, int charsRemoved,
+                                     int charsAdded)
+{
+    Q_UNUSED(charsRemoved)
+    QTextDocument *document = m_editor->document();
+    int blockCount = document->blockCount(), mapHeight = qMax(1, height());
+    //When the lines per row is changed, all the rows are moved.
+    if(qMax(1, (blockCount + mapHeight - 1) / mapHeight) != m_linesPerRow)
+    {
+        resetMap();
+        return;
+    }
+    int lastPosition = document->characterCount() - 1,
+            startBlock = document->findBlock(
+                qMin(position, lastPosition)).blockNumber();
+    if(blockCount == m_blockCount)
+    {
+        //Only the rows of the changed blocks are changed.
+        int endBlock = document->findBlock(
+                    qMin(position + charsAdded, lastPosition)).blockNumber();
+        markDirty(startBlock / m_linesPerRow, endBlock / m_linesPerRow);
+    }
+    else
+    {
+        //The lines after the change are moved, render all the rows after it.
+        m_blockCount = blockCount;
+        m_rowCount = (m_blockCount + m_linesPerRow - 1) / m_linesPerRow;
+        int tileCount = (m_rowCount + TILE_HEIGHT - 1) / TILE_HEIGHT,
+                previousCount = m_tiles.size();
+        m_tiles.resize(tileCount);
+        m_tileDirty.resize(tileCount);
+        for(int i=previousCount; i<tileCount; ++i)
+        {
+            m_tileDirty[i] = true;
+        }
+        markDirty(startBlock / m_linesPerRow, m_rowCount - 1);
+        update();
+    }
+    scheduleRender();
+}
+
+void KNDocumentMap::onTileRendered()
+{
+    //Check whether the tile is still the same position of the map.
+    if(m_renderGeneration == m_generation && m_renderIndex < m_tiles.size())
+    {
+        m_tiles[m_renderIndex] = m_watcher.result();
+        update(0, m_renderIndex * TILE_HEIGHT, width(), TILE_HEIGHT);
+    }
+    //Continue to render the next tile.
+    renderNextTile();
+}
+
+void KNDocumentMap::renderNextTile()
+{
+    //Only one tile is rendered at one time, and the hidden map is rendered
+    //when it is shown.
+    if(!m_editor || !isVisible() || m_watcher.isRunning())
+    {
+        return;
+    }
+    int index = m_tileDirty.indexOf(true);
+    if(index == -1)
+    {
+        return;
+    }
+    m_tileDirty[index] = false;
+    m_renderIndex = index;
+    m_renderGeneration = m_generation;
+    //The text blocks could only be read in the GUI thread, render the
+    //snapshot in the background.
+    m_watcher.setFuture(QtConcurrent::run(&KNDocumentMap::renderTile,
+                                          snapshotTile(index)));
+}
+
+QImage KNDocumentMap::renderTile(const MapTile &tile)
+{
+    QImage image(tile.width, TILE_HEIGHT, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    for(int y=0; y<tile.rows.size(); ++y)
+    {
+        QRgb *pixels = reinterpret_cast<QRgb *>(image.scanLine(y));
+        //The first sampled line which has a character at the column wins.
+        for(const MapLine &line : tile.rows.at(y))
+        {
+            int x = 0, run = 0;
+            for(int i=0; i<line.text.size() && x<tile.width; ++i)
+            {
+                QChar c = line.text.at(i);
+                if(c == QLatin1Char('\t'))
+                {
+                    x += tile.tabSpacing - (x % tile.tabSpacing);
+                    continue;
+                }
+                //Find the format run of the character.
+                while(run < line.runs.size()
+                      && line.runs.at(run).start + line.runs.at(run).length <= i)
+                {
+                    ++run;
+                }
+                if(!c.isSpace() && !pixels[x])
+                {
+                    QRgb color = (run < line.runs.size()
+                                  && line.runs.at(run).start <= i) ?
+                                line.runs.at(run).color : tile.foreground;
+                    pixels[x] = qPremultiply(qRgba(qRed(color), qGreen(color),
+                                                   qBlue(color), 0xB0));
+                }
+                ++x;
+            }
+        }
+    }
+    return image;
+}
+
+KNDocumentMap::MapTile KNDocumentMap::snapshotTile(int index) const
+{
+    QTextDocument *document = m_editor->document();
+    MapTile tile;
+    tile.width = qMax(1, width());
+    tile.tabSpacing = qMax(1, knGlobal->tabSpacing());
+    tile.foreground = m_editor->palette().color(QPalette::Text).rgba();
+    int firstRow = index * TILE_HEIGHT,
+            lastRow = qMin(firstRow + TILE_HEIGHT, m_rowCount),
+            samples = qMin(m_linesPerRow, SAMPLE_LINES);
+    tile.rows.resize(lastRow - firstRow);
+    for(int row=firstRow; row<lastRow; ++row)
     {
-//        QAbstractTextDocumentLayout::PaintContext ctx;
-//        ctx.clip = rect();
-//        ctx.palette.setColor(QPalette::Text, QColor(0, 0, 0));
-//        m_document->documentLayout()->draw(&painter, ctx);
-        painter.setPen(QColor(255, 0, 0));
-        m_document->drawContents(&painter);
+        QVector<MapLine> &lines = tile.rows[row - firstRow];
+        //Sample the lines evenly inside the row.
+        for(int i=0; i<samples; ++i)
+        {
+            QTextBlock block = document->findBlockByNumber(
+                        row * m_linesPerRow + i * m_linesPerRow / samples);
+            if(!block.isValid())
+            {
+                break;
+            }
+            MapLine line;
+            //Only the characters inside the map are needed, avoid copying the
+            //entire text of a long line.
+            if(block.length() > (tile.width << 1))
+            {
+                int position = block.position();
+                line.text.reserve(tile.width);
+                for(int j=0; j<tile.width; ++j)
+                {
+                    line.text.append(document->characterAt(position + j));
+                }
+            }
+            else
+            {
+                line.text = block.text();
+            }
+            //Save the colors of the syntax formats.
+            const auto formats = block.layout()->formats();
+            for(const auto &range : formats)
+            {
+                if(range.start < line.text.size()
+                        && range.format.hasProperty(QTextFormat::ForegroundBrush))
+                {
+                    MapRun run;
+                    run.start = range.start;
+                    run.length = range.length;
+                    run.color = range.format.foreground().color().rgba();
+                    line.runs.append(run);
+                }
+            }
+            std::sort(line.runs.begin(), line.runs.end(),
+                      [](const MapRun &left, const MapRun &right)
+            {
+                return left.start < right.start;
+            });
+            lines.append(line);
+        }
     }
+    return tile;
 }
 
-void KNDocumentMap::setDocument(QTextDocument *document)
+void KNDocumentMap::resetMap()
 {
-    m_document = document;
+    //Discard the rendering result of the previous map.
+    ++m_generation;
+    if(!m_editor)
+    {
+        m_rowCount = 0;
+        m_blockCount = 0;
+        m_tiles.clear();
+        m_tileDirty.clear();
+        update();
+        return;
+    }
+    //Fit the entire document into the height of the map.
+    int mapHeight = qMax(1, height());
+    m_blockCount = m_editor->document()->blockCount();
+    m_linesPerRow = qMax(1, (m_blockCount + mapHeight - 1) / mapHeight);
+    m_rowCount = (m_blockCount + m_linesPerRow - 1) / m_linesPerRow;
+    //Keep the previous tiles until they are rendered again.
+    int tileCount = (m_rowCount + TILE_HEIGHT - 1) / TILE_HEIGHT;
+    m_tiles.resize(tileCount);
+    m_tileDirty.fill(true, tileCount);
+    scheduleRender();
     update();
 }
+
+void KNDocumentMap::markDirty(int fromRow, int toRow)
+{
+    int lastTile = qMin(toRow / TILE_HEIGHT, m_tileDirty.size() - 1);
+    for(int i=qMax(0, fromRow / TILE_HEIGHT); i<=lastTile; ++i)
+    {
+        m_tileDirty[i] = true;
+    }
+}
+
+void KNDocumentMap::scheduleRender()
+{
+    //Do not restart the timer, keep rendering while typing.
+    if(!m_renderTimer->isActive())
+    {
+        m_renderTimer->start();
+    }
+}
+
+void KNDocumentMap::scrollToRow(int y)
+{
+    if(!m_editor || !m_rowCount)
+    {
+        return;
+    }
+    //Place the line of the row at the center of the editor.
+    int top = m_editor->cursorForPosition(QPoint(0, 0)).blockNumber(),
+            bottom = m_editor->cursorForPosition(
+                QPoint(0, m_editor->viewport()->height() - 1)).blockNumber();
+    int line = qBound(0, y, m_rowCount - 1) * m_linesPerRow;
+    m_editor->verticalScrollBar()->setValue(line - ((bottom - top) >> 1));
+}
@@ -13,22 +13,102 @@
 #ifndef KNDOCUMENTMAP_H
 #define KNDOCUMENTMAP_H
 
+#include <QImage>
+#include <QPointer>
+#include <QFutureWatcher>
 #include <QWidget>
 
-class QTextDocument;
+class QTimer;
+class KNTextEditor;
+/*!
+ * \brief The KNDocumentMap class provides the minimap of a text editor. The
+ * whole document is downsampled into the widget, one pixel row for every N
+ * lines and one pixel for every character, coloured by the syntax format.\n
+ * The map is split into tiles, which are rendered in a background thread from
+ * a snapshot of the sampled lines. Only the tiles touched by a content change
+ * are rendered again, the painting only blits the cached images.
+ */
 class KNDocumentMap : public QWidget
 {
     Q_OBJECT
 public:
-    explicit KNDocumentMap(QWidget *widget = nullptr);
+    /*!
+     * \brief Construct a KNDocumentMap widget.
+     * \param parent The parent widget.
+     */
+    explicit KNDocumentMap(QWidget *parent = nullptr);
+    ~KNDocumentMap();
 
-    void setDocument(QTextDocument *document);
+    /*!
+     * \brief Set the text editor to be displayed in the map.
+     * \param editor The text editor. Set nullptr to clear the map.
+     */
+    void setEditor(KNTextEditor *editor);
 
 protected:
+    /*!
+     * \brief Reimplemented from QWidget::paintEvent().
+     */
     void paintEvent(QPaintEvent *event) override;
 
+    /*!
+     * \brief Reimplemented from QWidget::resizeEvent().
+     */
+    void resizeEvent(QResizeEvent *event) override;
+
+    /*!
+     * \brief Reimplemented from QWidget::showEvent().
+     */
+    void showEvent(QShowEvent *event) override;
+
+    /*!
+     * \brief Reimplemented from QWidget::mousePressEvent().
+     */
+    void mousePressEvent(QMouseEvent *event) override;
+
+    /*!
+     * \brief Reimplemented from QWidget::mouseMoveEvent().
+     */
+    void mouseMoveEvent(QMouseEvent *event) override;
+
+private slots:
+    void onContentsChange(int position, int charsRemoved, int charsAdded);
+    void onTileRendered();
+    void renderNextTile();
+
 private:
-    QTextDocument *m_document;
+    struct MapRun
+    {
+        int start;
+        int length;
+        QRgb color;
+    };
+    struct MapLine
+    {
+        QString text;
+        QVector<MapRun> runs;
+    };
+    struct MapTile
+    {
+        QVector<QVector<MapLine>> rows;
+        QRgb foreground;
+        int width;
+        int tabSpacing;
+    };
+    static QImage renderTile(const MapTile &tile);
+    MapTile snapshotTile(int index) const;
+    void resetMap();
+    void markDirty(int fromRow, int toRow);
+    void scheduleRender();
+    void scrollToRow(int y);
+    QVector<QImage> m_tiles;
+    QVector<bool> m_tileDirty;
+    QList<QMetaObject::Connection> m_links;
+    QFutureWatcher<QImage> m_watcher;
+    QPointer<KNTextEditor> m_editor;
+    QTimer *m_renderTimer;
+    int m_linesPerRow, m_rowCount, m_blockCount, m_generation, m_renderIndex,
+        m_renderGeneration;
 };
 
 #endif // KNDOCUMENTMAP_H
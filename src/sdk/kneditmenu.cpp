@@ -19,6 +19,13 @@
 #include <QClipboard>
 #include <QMimeData>
 #include <QDockWidget>
+#include <QFileDialog>
+#include <QFutureWatcher>
+#include <QInputDialog>
+#include <QMessageBox>
+#include <QProgressDialog>
+#include <QRegularExpression>
+#include <QtConcurrent/QtConcurrent>
 
 #include "knutil.h"
 #include "kntexteditor.h"
@@ -27,6 +34,11 @@
 #include "kncharpanel.h"
 #include "knmainwindow.h"
 #include "knclipboardhistory.h"
+#include "kndelimitedtext.h"
+#include "knfiletransform.h"
+#include "knlinededuplicator.h"
+#include "knlinesorter.h"
+#include "kntexttransform.h"
 
 #include "kneditmenu.h"
 
@@ -94,24 +106,45 @@ KNEditMenu::KNEditMenu(QWidget *parent) : QMenu(parent),
     addMenu(m_subMenus[LineOps]);
     m_subMenus[LineOps]->addAction(m_menuItems[LineDuplicate]);
     m_subMenus[LineOps]->addAction(m_menuItems[LineRemoveDuplicate]);
+    m_subMenus[LineOps]->addAction(m_menuItems[LineRemoveAllDuplicates]);
+    m_subMenus[LineOps]->addAction(m_menuItems[LineRemoveAllDuplicatesKeepLast]);
+    m_subMenus[LineOps]->addAction(m_menuItems[LineCountDuplicates]);
     m_subMenus[LineOps]->addAction(m_menuItems[LineJoin]);
     m_subMenus[LineOps]->addAction(m_menuItems[LineMoveUp]);
     m_subMenus[LineOps]->addAction(m_menuItems[LineMoveDown]);
     m_subMenus[LineOps]->addAction(m_menuItems[LineRemoveEmpty]);
     m_subMenus[LineOps]->addAction(m_menuItems[LineRemoveBlank]);
+    m_subMenus[LineOps]->addAction(m_menuItems[LineSqueezeBlank]);
+    m_subMenus[LineOps]->addAction(m_menuItems[LineRemoveMatching]);
     m_subMenus[LineOps]->addSeparator();
     m_subMenus[LineOps]->addAction(m_menuItems[LineSortLexAsc]);
     m_subMenus[LineOps]->addAction(m_menuItems[LineSortIntAsc]);
     m_subMenus[LineOps]->addAction(m_menuItems[LineSortDecCommaAsc]);
     m_subMenus[LineOps]->addAction(m_menuItems[LineSortDecDotAsc]);
+    m_subMenus[LineOps]->addAction(m_menuItems[LineSortLexCaseAsc]);
+    m_subMenus[LineOps]->addAction(m_menuItems[LineSortNaturalAsc]);
+    m_subMenus[LineOps]->addAction(m_menuItems[LineSortUniqueAsc]);
     m_subMenus[LineOps]->addSeparator();
     m_subMenus[LineOps]->addAction(m_menuItems[LineSortLexDec]);
     m_subMenus[LineOps]->addAction(m_menuItems[LineSortIntDec]);
     m_subMenus[LineOps]->addAction(m_menuItems[LineSortDecCommaDec]);
     m_subMenus[LineOps]->addAction(m_menuItems[LineSortDecDotDec]);
+    m_subMenus[LineOps]->addAction(m_menuItems[LineSortLexCaseDec]);
+    m_subMenus[LineOps]->addAction(m_menuItems[LineSortNaturalDec]);
+    m_subMenus[LineOps]->addAction(m_menuItems[LineSortUniqueDec]);
+    addMenu(m_subMenus[ColumnOps]);
+    m_subMenus[ColumnOps]->addAction(m_menuItems[ColumnSortAsc]);
+    m_subMenus[ColumnOps]->addAction(m_menuItems[ColumnSortDec]);
+    m_subMenus[ColumnOps]->addSeparator();
+    m_subMenus[ColumnOps]->addAction(m_menuItems[ColumnExtract]);
+    m_subMenus[ColumnOps]->addAction(m_menuItems[ColumnRemove]);
+    m_subMenus[ColumnOps]->addAction(m_menuItems[ColumnAlign]);
     addMenu(m_subMenus[Comment]);
     addMenu(m_subMenus[AutoComplete]);
     addMenu(m_subMenus[EOLConvert]);
+    m_subMenus[EOLConvert]->addAction(m_menuItems[FileEolWindows]);
+    m_subMenus[EOLConvert]->addAction(m_menuItems[FileEolUnix]);
+    m_subMenus[EOLConvert]->addAction(m_menuItems[FileEolMac]);
     addMenu(m_subMenus[BlankOperations]);
     m_subMenus[BlankOperations]->addAction(m_menuItems[TrimRight]);
     m_subMenus[BlankOperations]->addAction(m_menuItems[TrimLeft]);
@@ -122,6 +155,10 @@ KNEditMenu::KNEditMenu(QWidget *parent) : QMenu(parent),
     m_subMenus[BlankOperations]->addAction(m_menuItems[TrimTabToSpace]);
     m_subMenus[BlankOperations]->addAction(m_menuItems[TrimSpaceToTab]);
     m_subMenus[BlankOperations]->addAction(m_menuItems[TrimSpaceToTabLead]);
+    m_subMenus[BlankOperations]->addSeparator();
+    m_subMenus[BlankOperations]->addAction(m_menuItems[FileTabToSpace]);
+    m_subMenus[BlankOperations]->addAction(m_menuItems[FileSpaceToTab]);
+    m_subMenus[BlankOperations]->addAction(m_menuItems[FileSpaceToTabLead]);
     addMenu(m_subMenus[PasteSpecial]);
     m_subMenus[PasteSpecial]->addAction(m_menuItems[PasteHtml]);
     m_subMenus[PasteSpecial]->addAction(m_menuItems[PasteRtf]);
@@ -172,25 +209,64 @@ KNEditMenu::KNEditMenu(QWidget *parent) : QMenu(parent),
     connect(m_menuItems[CaseRandom], &QAction::triggered, this, &KNEditMenu::onToRandom);
     connect(m_menuItems[LineDuplicate], &QAction::triggered, this, &KNEditMenu::onLineDuplicate);
     connect(m_menuItems[LineRemoveDuplicate], &QAction::triggered, this, &KNEditMenu::onLineRemoveDuplicate);
+    connect(m_menuItems[LineRemoveAllDuplicates], &QAction::triggered, [=]{ deduplicateLines(KNLineDeduplicator::KeepFirst); });
+    connect(m_menuItems[LineRemoveAllDuplicatesKeepLast], &QAction::triggered, [=]{ deduplicateLines(KNLineDeduplicator::KeepLast); });
+    connect(m_menuItems[LineCountDuplicates], &QAction::triggered, [=]{ deduplicateLines(KNLineDeduplicator::CountOccurrences); });
     connect(m_menuItems[LineJoin], &QAction::triggered, this, &KNEditMenu::onLineJoin);
     connect(m_menuItems[LineMoveUp], &QAction::triggered, this, &KNEditMenu::onLineMoveUp);
     connect(m_menuItems[LineMoveDown], &QAction::triggered, this, &KNEditMenu::onLineMoveDown);
-    connect(m_menuItems[LineRemoveEmpty], &QAction::triggered, [=]{ removeEmptyLines(false); });
-    connect(m_menuItems[LineRemoveBlank], &QAction::triggered, [=]{ removeEmptyLines(true); });
-    connect(m_menuItems[LineSortLexAsc], &QAction::triggered, [=]{ sortLines(true, SortLexcial); });
-    connect(m_menuItems[LineSortLexDec], &QAction::triggered, [=]{ sortLines(false, SortLexcial); });
-    connect(m_menuItems[LineSortIntAsc], &QAction::triggered, [=]{ sortLines(true, SortInt); });
-    connect(m_menuItems[LineSortIntDec], &QAction::triggered, [=]{ sortLines(false, SortInt); });
-    connect(m_menuItems[LineSortDecCommaDec], &QAction::triggered, [=]{ sortLines(false, SortDoubleComma); });
-    connect(m_menuItems[LineSortDecCommaAsc], &QAction::triggered, [=]{ sortLines(true, SortDoubleComma); });
-    connect(m_menuItems[LineSortDecDotDec], &QAction::triggered, [=]{ sortLines(false, SortDoubleDot); });
-    connect(m_menuItems[LineSortDecDotAsc], &QAction::triggered, [=]{ sortLines(true, SortDoubleDot); });
+    connect(m_menuItems[LineRemoveEmpty], &QAction::triggered, [=]{ removeLines(RemoveEmpty); });
+    connect(m_menuItems[LineRemoveBlank], &QAction::triggered, [=]{ removeLines(RemoveBlank); });
+    connect(m_menuItems[LineSqueezeBlank], &QAction::triggered, [=]{ removeLines(SqueezeBlank); });
+    connect(m_menuItems[LineRemoveMatching], &QAction::triggered, [=]{ removeLines(RemoveMatching); });
+    connect(m_menuItems[LineSortLexAsc], &QAction::triggered, [=]{ sortLines(KNLineSorter::Lexical); });
+    connect(m_menuItems[LineSortLexDec], &QAction::triggered, [=]{ sortLines(KNLineSorter::Lexical, KNLineSorter::Descending); });
+    connect(m_menuItems[LineSortIntAsc], &QAction::triggered, [=]{ sortLines(KNLineSorter::Integer); });
+    connect(m_menuItems[LineSortIntDec], &QAction::triggered, [=]{ sortLines(KNLineSorter::Integer, KNLineSorter::Descending); });
+    connect(m_menuItems[LineSortDecCommaDec], &QAction::triggered, [=]{ sortLines(KNLineSorter::DecimalComma, KNLineSorter::Descending); });
+    connect(m_menuItems[LineSortDecCommaAsc], &QAction::triggered, [=]{ sortLines(KNLineSorter::DecimalComma); });
+    connect(m_menuItems[LineSortDecDotDec], &QAction::triggered, [=]{ sortLines(KNLineSorter::DecimalDot, KNLineSorter::Descending); });
+    connect(m_menuItems[LineSortDecDotAsc], &QAction::triggered, [=]{ sortLines(KNLineSorter::DecimalDot); });
+    connect(m_menuItems[LineSortLexCaseAsc], &QAction::triggered, [=]{ sortLines(KNLineSorter::LexicalIgnoreCase); });
+    connect(m_menuItems[LineSortLexCaseDec], &QAction::triggered, [=]{ sortLines(KNLineSorter::LexicalIgnoreCase, KNLineSorter::Descending); });
+    connect(m_menuItems[LineSortNaturalAsc], &QAction::triggered, [=]{ sortLines(KNLineSorter::Natural); });
+    connect(m_menuItems[LineSortNaturalDec], &QAction::triggered, [=]{ sortLines(KNLineSorter::Natural, KNLineSorter::Descending); });
+    connect(m_menuItems[LineSortUniqueAsc], &QAction::triggered, [=]{ sortLines(KNLineSorter::Lexical, KNLineSorter::Unique); });
+    connect(m_menuItems[LineSortUniqueDec], &QAction::triggered, [=]{ sortLines(KNLineSorter::Lexical, KNLineSorter::Descending | KNLineSorter::Unique); });
+    connect(m_menuItems[ColumnSortAsc], &QAction::triggered, [=]{ columnOperation(ColumnOperationSortAsc); });
+    connect(m_menuItems[ColumnSortDec], &QAction::triggered, [=]{ columnOperation(ColumnOperationSortDec); });
+    connect(m_menuItems[ColumnExtract], &QAction::triggered, [=]{ columnOperation(ColumnOperationExtract); });
+    connect(m_menuItems[ColumnRemove], &QAction::triggered, [=]{ columnOperation(ColumnOperationRemove); });
+    connect(m_menuItems[ColumnAlign], &QAction::triggered, [=]{ columnOperation(ColumnOperationAlign); });
     connect(m_menuItems[TrimRight], &QAction::triggered, [=] { trimLines(TrimModeRight); });
     connect(m_menuItems[TrimLeft], &QAction::triggered, [=] { trimLines(TrimModeLeft); });
     connect(m_menuItems[TrimAll], &QAction::triggered, [=] { trimLines(TrimModeBoth); });
     connect(m_menuItems[TrimEolToSpace], &QAction::triggered, this, &KNEditMenu::onTrimEol);
     connect(m_menuItems[TrimAllAndEol], &QAction::triggered, this, &KNEditMenu::onTrimEolAndSpace);
     connect(m_menuItems[TrimTabToSpace], &QAction::triggered, this, &KNEditMenu::onTabToSpace);
+    connect(m_menuItems[TrimSpaceToTab], &QAction::triggered, [=]{ onSpaceToTab(false); });
+    connect(m_menuItems[TrimSpaceToTabLead], &QAction::triggered, [=]{ onSpaceToTab(true); });
+    connect(m_menuItems[FileTabToSpace], &QAction::triggered, [=]
+    {
+        int tabSpacing = knGlobal->tabSpacing();
+        transformFile([=](QStringView line) { return KNTextTransform::tabToSpace(line, tabSpacing); },
+                      KNFileTransform::EolKeep);
+    });
+    connect(m_menuItems[FileSpaceToTab], &QAction::triggered, [=]
+    {
+        int tabSpacing = knGlobal->tabSpacing();
+        transformFile([=](QStringView line) { return KNTextTransform::spaceToTab(line, tabSpacing, false); },
+                      KNFileTransform::EolKeep);
+    });
+    connect(m_menuItems[FileSpaceToTabLead], &QAction::triggered, [=]
+    {
+        int tabSpacing = knGlobal->tabSpacing();
+        transformFile([=](QStringView line) { return KNTextTransform::spaceToTab(line, tabSpacing, true); },
+                      KNFileTransform::EolKeep);
+    });
+    connect(m_menuItems[FileEolWindows], &QAction::triggered, [=]{ transformFile(nullptr, KNFileTransform::EolWindows); });
+    connect(m_menuItems[FileEolUnix], &QAction::triggered, [=]{ transformFile(nullptr, KNFileTransform::EolUnix); });
+    connect(m_menuItems[FileEolMac], &QAction::triggered, [=]{ transformFile(nullptr, KNFileTransform::EolMac); });
     connect(m_menuItems[PasteHtml], &QAction::triggered, this, &KNEditMenu::onPasteHtml);
     connect(m_menuItems[PasteRtf], &QAction::triggered, this, &KNEditMenu::onPasteRtf);
     connect(m_menuItems[SelectOpen], &QAction::triggered, this, &KNEditMenu::onSelectOpen);
@@ -268,6 +344,7 @@ void KNEditMenu::retranslate()
     m_subMenus[Indent]->setTitle(tr("Indent"));
     m_subMenus[ConvertCase]->setTitle(tr("Convert Case to"));
     m_subMenus[LineOps]->setTitle(tr("Line Operators"));
+    m_subMenus[ColumnOps]->setTitle(tr("Delimited Column Operators"));
     m_subMenus[Comment]->setTitle(tr("Comment/Uncomment"));
     m_subMenus[AutoComplete]->setTitle(tr("Auto-Completion"));
     m_subMenus[EOLConvert]->setTitle(tr("EOL Conversion"));
@@ -287,11 +364,16 @@ void KNEditMenu::retranslate()
     m_menuItems[CaseRandom]->setText(tr("&ranDOM CasE"));
     m_menuItems[LineDuplicate]->setText(tr("Duplicate Current Line"));
     m_menuItems[LineRemoveDuplicate]->setText(tr("Remove Consecutive Duplicate Lines"));
+    m_menuItems[LineRemoveAllDuplicates]->setText(tr("Remove Duplicate Lines"));
+    m_menuItems[LineRemoveAllDuplicatesKeepLast]->setText(tr("Remove Duplicate Lines (Keep Last)"));
+    m_menuItems[LineCountDuplicates]->setText(tr("Count Duplicate Lines"));
     m_menuItems[LineJoin]->setText(tr("Join Lines"));
     m_menuItems[LineMoveUp]->setText(tr("Move Up Current Line"));
     m_menuItems[LineMoveDown]->setText(tr("Move Down Current Line"));
     m_menuItems[LineRemoveEmpty]->setText(tr("Remove Empty Lines"));
     m_menuItems[LineRemoveBlank]->setText(tr("Remove Empty Lines (Containing Blank characters)"));
+    m_menuItems[LineSqueezeBlank]->setText(tr("Squeeze Consecutive Blank Lines"));
+    m_menuItems[LineRemoveMatching]->setText(tr("Remove Lines Matching Regular Expression..."));
     m_menuItems[LineSortLexAsc]->setText(tr("Sort Lines Lexicographically Ascending"));
     m_menuItems[LineSortIntAsc]->setText(tr("Sort Lines As Integers Ascending"));
     m_menuItems[LineSortDecCommaAsc]->setText(tr("Sort Lines As Decimals (Comma) Ascending"));
@@ -300,6 +382,17 @@ void KNEditMenu::retranslate()
     m_menuItems[LineSortIntDec]->setText(tr("Sort Lines As Integers Descending"));
     m_menuItems[LineSortDecCommaDec]->setText(tr("Sort Lines As Decimals (Comma) Descending"));
     m_menuItems[LineSortDecDotDec]->setText(tr("Sort Lines As Decimals (Dot) Descending"));
+    m_menuItems[LineSortLexCaseAsc]->setText(tr("Sort Lines Lex. Ascending Ignoring Case"));
+    m_menuItems[LineSortLexCaseDec]->setText(tr("Sort Lines Lex. Descending Ignoring Case"));
+    m_menuItems[LineSortNaturalAsc]->setText(tr("Sort Lines In Natural Order Ascending"));
+    m_menuItems[LineSortNaturalDec]->setText(tr("Sort Lines In Natural Order Descending"));
+    m_menuItems[LineSortUniqueAsc]->setText(tr("Sort Lines Lex. Ascending And Remove Duplicates"));
+    m_menuItems[LineSortUniqueDec]->setText(tr("Sort Lines Lex. Descending And Remove Duplicates"));
+    m_menuItems[ColumnSortAsc]->setText(tr("Sort Lines By Current Column Ascending"));
+    m_menuItems[ColumnSortDec]->setText(tr("Sort Lines By Current Column Descending"));
+    m_menuItems[ColumnExtract]->setText(tr("Extract Current Column"));
+    m_menuItems[ColumnRemove]->setText(tr("Remove Current Column"));
+    m_menuItems[ColumnAlign]->setText(tr("Align Columns"));
     m_menuItems[TrimRight]->setText(tr("Trim Trailing Space"));
     m_menuItems[TrimLeft]->setText(tr("Trim Leading Space"));
     m_menuItems[TrimAll]->setText(tr("Trim Leading and Trailing Space"));
@@ -308,6 +401,12 @@ void KNEditMenu::retranslate()
     m_menuItems[TrimTabToSpace]->setText(tr("TAB to Space"));
     m_menuItems[TrimSpaceToTab]->setText(tr("Space to TAB (All)"));
     m_menuItems[TrimSpaceToTabLead]->setText(tr("Space to TAB (Leading)"));
+    m_menuItems[FileTabToSpace]->setText(tr("TAB to Space in File..."));
+    m_menuItems[FileSpaceToTab]->setText(tr("Space to TAB (All) in File..."));
+    m_menuItems[FileSpaceToTabLead]->setText(tr("Space to TAB (Leading) in File..."));
+    m_menuItems[FileEolWindows]->setText(tr("Convert File to Windows (CR LF)..."));
+    m_menuItems[FileEolUnix]->setText(tr("Convert File to Unix (LF)..."));
+    m_menuItems[FileEolMac]->setText(tr("Convert File to Macintosh (CR)..."));
     m_menuItems[SelectOpen]->setText(tr("Open File"));
     m_menuItems[SelectShowInExplorer]->setText(tr("Open Containing Folder in Explorer"));
     m_menuItems[SelectSearchOnInternet]->setText(tr("Search on Internet"));
@@ -470,20 +569,13 @@ void KNEditMenu::onLineRemoveDuplicate()
             lastBlock = block;
             block = block.next();
         }
-        //If the last block is valid, then start remove them.
+        //If the last block is valid, then remove them at once.
         if(lastBlock.isValid())
         {
-            tc.beginEditBlock();
-            while(lastBlock != currentBlock)
-            {
-                auto prevBlock = lastBlock.previous();
-                //Remove the block.
-                tc = QTextCursor(lastBlock);
-                tc.select(QTextCursor::BlockUnderCursor);
-                tc.removeSelectedText();
-                lastBlock = prevBlock;
-            }
-            tc.endEditBlock();
+            tc.setPosition(currentBlock.position() + currentBlock.length() - 1);
+            tc.setPosition(lastBlock.position() + lastBlock.length() - 1,
+                           QTextCursor::KeepAnchor);
+            tc.removeSelectedText();
         }
     }
 }
@@ -498,26 +590,10 @@ void KNEditMenu::onLineJoin()
         {
             return;
         }
-        auto doc = m_editor->document();
-        auto startBlock=doc->findBlock(tc.selectionStart()),
-                endBlock=doc->findBlock(tc.selectionEnd());
-        if(startBlock.blockNumber() == endBlock.blockNumber())
-        {
-            return;
-        }
-        //Combine the block number.
-        tc.beginEditBlock();
-        QTextBlock currentBlock = endBlock;
-        do
-        {
-            //Move to the previous block.
-            currentBlock = currentBlock.previous();
-            //Move the tc to the end of the current block.
-            tc.setPosition(currentBlock.position() + currentBlock.length() - 1);
-            tc.deleteChar();
-        }
-        while(currentBlock != startBlock);
-        tc.endEditBlock();
+        //Remove the line ends of the selected lines in one replacement.
+        KNTextTransform transform(m_editor);
+        QString result = transform.text();
+        transform.apply(result.remove('\n'));
     }
 }
 
@@ -537,87 +613,57 @@ void KNEditMenu::onLineMoveDown()
     }
 }
 
-void KNEditMenu::onTrimEol()
+static QString rstrip(QStringView source)
 {
-    if(m_editor)
+    int n = static_cast<int>(source.size());
+    while(n > 0 && source.at(n - 1).isSpace())
     {
-        //Loop for all the blocks.
-        auto doc = m_editor->document();
-        QTextCursor tc = m_editor->textCursor();
-        tc.beginEditBlock();
-        while(doc->blockCount() > 1)
-        {
-            //For all the block, remove its end spacing.
-            QTextBlock block = doc->firstBlock();
-            tc.setPosition(block.position() + block.length());
-            tc.deletePreviousChar();
-            tc.insertText(" ");
-        }
-        tc.endEditBlock();
+        --n;
     }
+    return source.left(n).toString();
 }
 
-static QString rstrip(const QString &source)
+static QString lstrip(QStringView source)
 {
-    for(int n=source.size()-1; n > -1; --n)
+    int n = 0;
+    while(n < source.size() && source.at(n).isSpace())
     {
-        if(!source.at(n).isSpace())
-        {
-            return source.left(n + 1);
-        }
+        ++n;
     }
-    return QString();
+    return source.mid(n).toString();
 }
 
-static QString lstrip(const QString &source)
+static QString strip(QStringView source)
 {
-    for(int n=0; n<source.size(); ++n)
+    int start = 0, end = static_cast<int>(source.size());
+    while(end > 0 && source.at(end - 1).isSpace())
     {
-        if(!source.at(n).isSpace())
-        {
-            return source.mid(n);
-        }
+        --end;
     }
-    return QString();
+    while(start < end && source.at(start).isSpace())
+    {
+        ++start;
+    }
+    return source.mid(start, end - start).toString();
 }
 
-static QString strip(const QString &source)
+void KNEditMenu::onTrimEol()
 {
-    return source.trimmed();
+    if(m_editor)
+    {
+        //Replace the line ends with spaces in one replacement.
+        KNTextTransform transform(m_editor);
+        QString result = transform.text();
+        transform.apply(result.replace('\n', ' '));
+    }
 }
 
 void KNEditMenu::onTrimEolAndSpace()
 {
     if(m_editor)
     {
-        //Loop for all the blocks.
-        auto doc = m_editor->document();
-        QTextCursor tc = m_editor->textCursor();
-        tc.beginEditBlock();
-        //Process the first block.
-        QTextBlock block = doc->firstBlock();
-        //For all the block, remove its end spacing.
-        tc.setPosition(block.position());
-        tc.setPosition(block.position() + block.length() - 1,
-                       QTextCursor::KeepAnchor);
-        tc.insertText(strip(block.text()));
-        //Check whether the block count is greater than 1.
-        while(doc->blockCount() > 1)
-        {
-            //Fetch the second block.
-            block = doc->findBlockByNumber(1);
-            //For all the block, remove its end spacing.
-            tc.setPosition(block.position());
-            tc.setPosition(block.position() + block.length() - 1,
-                           QTextCursor::KeepAnchor);
-            tc.insertText(strip(block.text()));
-            //Move to the end of the first block.
-            block = doc->firstBlock();
-            tc.setPosition(block.position() + block.length() - 1);
-            tc.deleteChar();
-            tc.insertText(" ");
-        }
-        tc.endEditBlock();
+        //Strip all the lines and join them with spaces.
+        KNTextTransform::transformLines(m_editor, strip, QString(" "));
     }
 }
 
@@ -625,51 +671,25 @@ void KNEditMenu::onTabToSpace()
 {
     if(m_editor)
     {
-        auto doc = m_editor->document();
-        QTextCursor tc = m_editor->textCursor();
-        tc.beginEditBlock();
-        //Find all the tab characters in the block
-        QTextBlock block = doc->firstBlock();
+        //Replace the tabs with the spaces to the next tab stops.
         int tabSpacing = knGlobal->tabSpacing();
-        while(block.isValid())
+        KNTextTransform::transformLines(m_editor, [=](QStringView line)
         {
-            //Find all '\t' chars.
-            QString blockText = block.text();
-            //Prepare the start and end position.
-            QVector<int> tabPos, tabSize;
-            //Calculate the positions.
-            int column = 0;
-            for(int i=0; i<blockText.size(); ++i)
-            {
-                //Check whether the iteration is \t.
-                if(blockText.at(i) == '\t')
-                {
-                    tabPos.append(i);
-                    //Get the start pos of tab.
-                    int tabStart = column;
-                    //Find the nearest variable.
-                    column = KNTextEditor::cellTabSpacing(column, tabSpacing);
-                    tabSize.append(column - tabStart);
-                    continue;
-                }
-                //Simply increase a char.
-                column += 1;
-            }
-            //Loop from the last info to the first one.
-            for(int i=tabPos.size() - 1; i>-1; --i)
-            {
-                //Replace the char as the spaces.
-                blockText.replace(tabPos.at(i), 1, QString(tabSize.at(i), ' '));
-            }
-            //Replace the block context.
-            tc.setPosition(block.position());
-            tc.setPosition(block.position() + block.length() - 1,
-                           QTextCursor::KeepAnchor);
-            tc.insertText(blockText);
-            //Move to next block.
-            block = block.next();
-        }
-        tc.endEditBlock();
+            return KNTextTransform::tabToSpace(line, tabSpacing);
+        });
+    }
+}
+
+void KNEditMenu::onSpaceToTab(bool leading)
+{
+    if(m_editor)
+    {
+        //Replace the spaces with the tabs at the tab stops.
+        int tabSpacing = knGlobal->tabSpacing();
+        KNTextTransform::transformLines(m_editor, [=](QStringView line)
+        {
+            return KNTextTransform::spaceToTab(line, tabSpacing, leading);
+        });
     }
 }
 
@@ -806,7 +826,7 @@ void KNEditMenu::onStartEndSelect()
 
 void KNEditMenu::trimLines(int trimMode)
 {
-    QString (*trimFunc)(const QString &);
+    QString (*trimFunc)(QStringView);
     switch(trimMode)
     {
     case TrimModeRight:
@@ -816,266 +836,197 @@ void KNEditMenu::trimLines(int trimMode)
         trimFunc = lstrip;
         break;
     case TrimModeBoth:
+    default:
         trimFunc = strip;
         break;
     }
 
     if(m_editor)
     {
-        //Loop for all the blocks.
-        auto doc = m_editor->document();
-        QTextCursor tc = m_editor->textCursor();
-        tc.beginEditBlock();
-        QTextBlock block = doc->firstBlock();
-        while(block.isValid())
-        {
-            //For all the block, remove its end spacing.
-            tc.setPosition(block.position());
-            tc.setPosition(block.position() + block.length() - 1,
-                           QTextCursor::KeepAnchor);
-            tc.insertText(trimFunc(block.text()));
-            block = block.next();
-        }
-        tc.endEditBlock();
+        //Trim all the lines in one pass.
+        KNTextTransform::transformLines(m_editor, trimFunc);
     }
 }
 
-int extractIntLength(const QString &buf)
+void KNEditMenu::sortLines(int sortMode, int options)
 {
-    if(buf.length() < 1)
-    {
-        return 0;
-    }
-    int pos = 0;
-    if(buf.at(0) == '-')
-    {
-        pos = 1;
-    }
-    for(; pos < buf.length(); ++pos)
-    {
-        auto c = buf.at(pos);
-        if(!(c>='0' && c<='9'))
-        {
-            //If there is only minus, treat as no number.
-            break;
-        }
-    }
-    //Check the invalid position.
-    if(pos == 1 && buf.at(0) == '-')
+    if(m_editor)
     {
-        return 0;
+        //Sort the selected lines, or the entire document.
+        KNTextTransform transform(m_editor);
+        transform.apply(KNLineSorter::sort(transform.text(), sortMode, options));
     }
-    return pos;
 }
 
-bool compareAsInt(const QString &a, const QString &b)
+void KNEditMenu::deduplicateLines(int mode)
 {
-    //Find the first integer length.
-    int numASize = extractIntLength(a), numBSize = extractIntLength(b);
-    if(numASize == 0 || numBSize == 0)
-    {
-        //One of those is pure string, cannot be compared as int.
-        return a < b;
-    }
-    //Both of them contains integers, check minus.
-    bool aMinus = a.at(0) == '-', bMinus = b.at(0) == '-';
-    if(aMinus && !bMinus)
-    {
-        return true;
-    }
-    if(!aMinus && bMinus)
-    {
-        return false;
-    }
-    //Now both of them is integer and both minus or plus.
-    if(numASize != numBSize)
-    {
-        return aMinus ? (numASize > numBSize) : (numASize < numBSize);
-    }
-    if(aMinus)
-    {
-        for(int i=1; i<numASize; ++i)
-        {
-            if(a.at(i) < b.at(i)) { return false; }
-            if(a.at(i) > b.at(i)) { return true; }
-        }
-        //Or else, just okay.
-        return true;
-    }
-    for(int i=0; i<numASize; ++i)
+    if(m_editor)
     {
-        if(a[i] < b[i]) { return true; }
-        if(a[i] > b[i]) { return false; }
+        //Remove the duplications in the selected lines, or the entire document.
+        KNTextTransform transform(m_editor);
+        transform.apply(KNLineDeduplicator::deduplicate(transform.text(), mode));
     }
-    //When achieved here, then they are the same, return false.
-    return false;
 }
 
-
-QString extractFloat(const QString &buf, const char splitter)
+void KNEditMenu::transformFile(const KNTextTransform::LineFunction &func,
+                               int eol)
 {
-    //Initial the variables.
-    if(buf.length() < 1)
+    //Select the source file and the target file, the file is transformed on
+    //the disk so it could be larger than the memory.
+    QString sourcePath = QFileDialog::getOpenFileName(
+                parentWidget(), tr("Select File to Transform"),
+                m_editor ? m_editor->filePath() : QString());
+    if(sourcePath.isEmpty())
     {
-        return QString();
+        return;
     }
-    //Initial the position.
-    int pos = 0, pointPos = -1;
-    if(buf.at(0) == '-')
+    QString targetPath = QFileDialog::getSaveFileName(
+                parentWidget(), tr("Save Transformed File"), sourcePath);
+    if(targetPath.isEmpty())
     {
-        pos = 1;
+        return;
     }
-    for(; pos < buf.length(); ++pos)
+    //Prepare the transform and the progress dialog.
+    KNFileTransform *transform = new KNFileTransform(this);
+    transform->setLineFunction(func);
+    transform->setEndOfLine(eol);
+    QProgressDialog *progress = new QProgressDialog(
+                tr("Transforming %1...").arg(QFileInfo(sourcePath).fileName()),
+                tr("Cancel"), 0, 1000, parentWidget());
+    progress->setWindowModality(Qt::WindowModal);
+    progress->setAutoReset(false);
+    connect(transform, &KNFileTransform::progress, progress,
+            [=](qint64 processed, qint64 total)
     {
-        auto c = buf.at(pos);
-        if(c == splitter)
+        progress->setValue(total > 0 ?
+                               static_cast<int>(processed * 1000 / total) :
+                               1000);
+    });
+    connect(progress, &QProgressDialog::canceled,
+            transform, &KNFileTransform::cancel);
+    //Run the transform in the thread pool.
+    QFutureWatcher<bool> *watcher = new QFutureWatcher<bool>(this);
+    connect(watcher, &QFutureWatcher<bool>::finished, [=]
+    {
+        progress->deleteLater();
+        if(watcher->result())
         {
-            //Check the point pos is set.
-            if(pointPos != -1)
-            {
-                //The second mark is invalid.
-                return buf.mid(0, pos);
-            }
-            pointPos = pos;
-            continue;
+            //The target file might be opened, e.g. transforming in place.
+            emit requireReload(targetPath);
         }
-        if(!(c>='0' && c<='9'))
+        else if(!transform->isCanceled())
         {
-            return buf.mid(0, pos);
+            QMessageBox::warning(parentWidget(), tr("Transform failed"),
+                                 transform->errorString());
         }
-    }
-    return buf;
+        transform->deleteLater();
+        watcher->deleteLater();
+    });
+    watcher->setFuture(QtConcurrent::run([=]
+    {
+        return transform->transform(sourcePath, targetPath);
+    }));
+    progress->show();
 }
 
-static bool compareAsFloat(const QString &a, const QString &b,
-                           const char splitter)
+void KNEditMenu::columnOperation(int operation)
 {
-    //Extract the float features.
-    QString &&numABuf = extractFloat(a, splitter),
-            &&numBBuf = extractFloat(b, splitter);
-    if(numABuf.isEmpty() || numBBuf.isEmpty())
+    if(!m_editor)
     {
-        //One of those is pure string, cannot be compared as int.
-        return a < b;
+        return;
     }
-    //Convert the splitter.
-    numABuf.replace(splitter, '.');
-    numBBuf.replace(splitter, '.');
-    //Convert the double.
-    bool resultA, resultB;
-    double valueA = numABuf.toDouble(&resultA),
-            valueB = numBBuf.toDouble(&resultB);
-    //Check the result.
-    if(!resultA || !resultB)
+    //The delimiter and the column are decided by the line of the cursor.
+    QTextCursor tc = m_editor->textCursor();
+    QString cursorLine = tc.block().text();
+    QChar delimiter = KNDelimitedText::detectDelimiter(cursorLine);
+    int column = KNDelimitedText::columnAt(cursorLine, tc.positionInBlock(),
+                                           delimiter);
+    //Apply the operation to the selected lines, or the entire document.
+    KNTextTransform transform(m_editor);
+    KNDelimitedText table(transform.text(), delimiter);
+    switch(operation)
     {
-        return a < b;
+    case ColumnOperationSortAsc:
+        transform.apply(table.sortByColumn(column, KNLineSorter::Natural));
+        break;
+    case ColumnOperationSortDec:
+        transform.apply(table.sortByColumn(column, KNLineSorter::Natural,
+                                           KNLineSorter::Descending));
+        break;
+    case ColumnOperationExtract:
+        transform.apply(table.extractColumn(column));
+        break;
+    case ColumnOperationRemove:
+        transform.apply(table.removeColumn(column));
+        break;
+    case ColumnOperationAlign:
+        transform.apply(table.alignColumns());
+        break;
     }
-    //Compare those two values.
-    return valueA < valueB;
 }
 
-void KNEditMenu::sortLines(bool asc, int sortMode)
+void KNEditMenu::removeLines(int removeMode)
 {
-    if(m_editor)
+    if(!m_editor)
     {
-        //Split the entire document based on space.
-        QStringList lines = m_editor->toPlainText().split('\n');
-        //Sort the lines.
-        switch(sortMode)
+        return;
+    }
+    auto isBlank = [](const QString &line)
+    {
+        for(const QChar &c : line)
         {
-        case SortLexcial:
-            lines.sort();
-            break;
-        case SortInt:
-            //Extract integers.
-            std::sort(lines.begin(), lines.end(), compareAsInt);
-            break;
-        case SortDoubleComma:
-            //Extract double.
-            std::sort(lines.begin(), lines.end(),
-                      [=](const QString &a, const QString &b)
-            { return compareAsFloat(a, b, ','); });
-            break;
-        case SortDoubleDot:
-            //Extract double.
-            std::sort(lines.begin(), lines.end(),
-                      [=](const QString &a, const QString &b)
-            { return compareAsFloat(a, b, '.'); });
-            break;
+            if(c != ' ' && c != '\t')
+            {
+                return false;
+            }
         }
-        //Check sort order.
-        if(!asc)
+        return true;
+    };
+    switch(removeMode)
+    {
+    case RemoveEmpty:
+        KNTextTransform::removeLines(m_editor, [](const QString &line)
         {
-            //Reverse the result.
-            std::reverse(lines.begin(), lines.end());
-        }
-        //Select all and replace.
-        QTextCursor tc = m_editor->textCursor();
-        tc.movePosition(QTextCursor::Start);
-        tc.movePosition(QTextCursor::End, QTextCursor::KeepAnchor);
-        //Insert the text.
-        tc.insertText(lines.join("\n"));
+            return line.isEmpty();
+        });
+        break;
+    case RemoveBlank:
+        KNTextTransform::removeLines(m_editor, isBlank);
+        break;
+    case SqueezeBlank:
+    {
+        //Only keep the first blank line of the continuous blank lines.
+        bool previousBlank = false;
+        KNTextTransform::removeLines(m_editor, [&](const QString &line)
+        {
+            bool blank = isBlank(line), removed = previousBlank && blank;
+            previousBlank = blank;
+            return removed;
+        });
+        break;
     }
-}
-
-void KNEditMenu::removeEmptyLines(bool blankCheck)
-{
-    if(m_editor)
+    case RemoveMatching:
     {
-        //Loop from the end of the line.
-        bool edited = false;
-        auto doc = m_editor->document();
-        QTextCursor tc = m_editor->textCursor();
-        QTextBlock block = doc->lastBlock();
-        while(block.isValid())
+        QString pattern = QInputDialog::getText(
+                    parentWidget(), tr("Remove Matching Lines"),
+                    tr("Remove the lines matching the regular expression:"));
+        if(pattern.isEmpty())
         {
-            //Check the block length.
-            bool removed = block.length() == 1;
-            if(!removed && blankCheck)
-            {
-                //Need to check whether this line is emtirely blank.
-                removed = (KNTextEditor::firstNonSpacePos(block) ==
-                           (block.length() - 1));
-            }
-            if(removed)
-            {
-                //Which means it only contains a new line char, remove it.
-                if(!edited)
-                {
-                    edited = true;
-                    tc.beginEditBlock();
-                }
-                //Clear the line first.
-                tc.setPosition(block.position());
-                if(block.length() > 1)
-                {
-                    tc.setPosition(block.position() + block.length() - 1,
-                                   QTextCursor::KeepAnchor);
-                    tc.removeSelectedText();
-                }
-                if(block.blockNumber() == 0)
-                {
-                    //Time to break.
-                    tc.deleteChar();
-                    break;
-                }
-                else if(block.blockNumber() == doc->lastBlock().blockNumber())
-                {
-                    //Then remove the current block.
-                    tc.deletePreviousChar();
-                    //Move to the next block.
-                    block = tc.block();
-                    continue;
-                }
-                //Or else, remove the current line.
-                tc.deleteChar();
-            }
-            //Move to the next block.
-            block = block.previous();
+            return;
         }
-        if(edited)
+        QRegularExpression regExp(pattern);
+        if(!regExp.isValid())
         {
-            tc.endEditBlock();
+            QMessageBox::warning(parentWidget(), tr("Remove Matching Lines"),
+                                 regExp.errorString());
+            return;
         }
+        regExp.optimize();
+        KNTextTransform::removeLines(m_editor, [&](const QString &line)
+        {
+            return regExp.match(line).hasMatch();
+        });
+        break;
+    }
     }
 }
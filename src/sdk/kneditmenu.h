@@ -15,6 +15,8 @@
 
 #include <QMenu>
 
+#include "kntexttransform.h"
+
 class QDockWidget;
 class KNTextEditor;
 class KNClipboardHistory;
@@ -53,11 +55,16 @@ public:
         CaseRandom,
         LineDuplicate,
         LineRemoveDuplicate,
+        LineRemoveAllDuplicates,
+        LineRemoveAllDuplicatesKeepLast,
+        LineCountDuplicates,
         LineJoin,
         LineMoveUp,
         LineMoveDown,
         LineRemoveEmpty,
         LineRemoveBlank,
+        LineSqueezeBlank,
+        LineRemoveMatching,
         LineSortLexAsc,
         LineSortIntAsc,
         LineSortDecCommaAsc,
@@ -66,6 +73,17 @@ public:
         LineSortIntDec,
         LineSortDecCommaDec,
         LineSortDecDotDec,
+        LineSortLexCaseAsc,
+        LineSortLexCaseDec,
+        LineSortNaturalAsc,
+        LineSortNaturalDec,
+        LineSortUniqueAsc,
+        LineSortUniqueDec,
+        ColumnSortAsc,
+        ColumnSortDec,
+        ColumnExtract,
+        ColumnRemove,
+        ColumnAlign,
         TrimRight,
         TrimLeft,
         TrimAll,
@@ -74,6 +92,12 @@ public:
         TrimTabToSpace,
         TrimSpaceToTab,
         TrimSpaceToTabLead,
+        FileTabToSpace,
+        FileSpaceToTab,
+        FileSpaceToTabLead,
+        FileEolWindows,
+        FileEolUnix,
+        FileEolMac,
         PasteHtml,
         PasteRtf,
         SelectOpen,
@@ -102,6 +126,12 @@ public:
     QAction *menuItem(int index);
 
 signals:
+    /*!
+     * \brief Request to reload the editors of a file which is changed on the
+     * disk by the file transform.
+     * \param filePath The file path.
+     */
+    void requireReload(const QString &filePath);
 
 private slots:
     void retranslate();
@@ -134,6 +164,7 @@ private slots:
     void onTrimEol();
     void onTrimEolAndSpace();
     void onTabToSpace();
+    void onSpaceToTab(bool leading);
     void onPasteHtml();
     void onPasteRtf();
     void onSelectOpen();
@@ -145,14 +176,9 @@ private slots:
     void onStartEndSelect();
 
 private:
-    enum SortMode
-    {
-        SortLexcial,
-        SortInt,
-        SortDoubleComma,
-        SortDoubleDot
-    };
-    void sortLines(bool asc, int sortMode);
+    void sortLines(int sortMode, int options = 0);
+    void deduplicateLines(int mode);
+    void transformFile(const KNTextTransform::LineFunction &func, int eol);
     enum TrimMode
     {
         TrimModeRight,
@@ -160,7 +186,23 @@ private:
         TrimModeBoth
     };
     void trimLines(int trimMode);
-    void removeEmptyLines(bool blankCheck = false);
+    enum RemoveLineMode
+    {
+        RemoveEmpty,
+        RemoveBlank,
+        SqueezeBlank,
+        RemoveMatching
+    };
+    void removeLines(int removeMode);
+    enum ColumnOperation
+    {
+        ColumnOperationSortAsc,
+        ColumnOperationSortDec,
+        ColumnOperationExtract,
+        ColumnOperationRemove,
+        ColumnOperationAlign
+    };
+    void columnOperation(int operation);
 
     enum EditSubMenus
     {
@@ -168,6 +210,7 @@ private:
         Indent,
         ConvertCase,
         LineOps,
+        ColumnOps,
         Comment,
         AutoComplete,
         EOLConvert,
@@ -12,6 +12,7 @@
  */
 #include <QBoxLayout>
 #include <QDir>
+#include <QFileInfo>
 #include <QMenu>
 #include <QStackedWidget>
 #include <QMessageBox>
@@ -37,6 +38,7 @@
 #include "knutil.h"
 #include "knsearchbar.h"
 #include "kntoolmenu.h"
+#include "knmacromenu.h"
 #include "knwindowsmenu.h"
 #include "knrecentfilerecorder.h"
 #include "kntabswitcher.h"
@@ -51,6 +53,7 @@ KNFileManager::KNFileManager(QWidget *parent) : QWidget(parent),
     m_viewMenu(new KNViewMenu(parentWidget())),
     m_codecMenu(new KNCodecMenu(this)),
     m_toolMenu(new KNToolMenu(this)),
+    m_macroMenu(new KNMacroMenu(this)),
     m_recent(new KNRecentFileRecorder(this)),
     m_tabBar(new KNTabBar(this)),
     m_windowsMenu(new KNWindowsMenu(m_tabBar, this)),
@@ -125,6 +128,51 @@ KNFileManager::KNFileManager(QWidget *parent) : QWidget(parent),
             this, &KNFileManager::onReloadUseCodec);
     connect(m_codecMenu, &KNCodecMenu::requireSetCodec,
             this, &KNFileManager::onSetCodec);
+    connect(m_editMenu, &KNEditMenu::requireReload,
+            this, &KNFileManager::onReloadFile);
+    //Record the editing and searching actions in the macro.
+    for(int i=0; i<KNEditMenu::EditMenuItemCount; ++i)
+    {
+        switch(i)
+        {
+        case KNEditMenu::ColumnEditor:
+        case KNEditMenu::CharacterPanel:
+        case KNEditMenu::ClipboardHistory:
+        case KNEditMenu::SetReadOnly:
+        case KNEditMenu::ClearReadOnly:
+        case KNEditMenu::CopyFilePath:
+        case KNEditMenu::CopyFileName:
+        case KNEditMenu::CopyFileDir:
+        case KNEditMenu::LineCountDuplicates:
+        case KNEditMenu::LineRemoveMatching:
+        case KNEditMenu::FileTabToSpace:
+        case KNEditMenu::FileSpaceToTab:
+        case KNEditMenu::FileSpaceToTabLead:
+        case KNEditMenu::FileEolWindows:
+        case KNEditMenu::FileEolUnix:
+        case KNEditMenu::FileEolMac:
+        case KNEditMenu::SelectOpen:
+        case KNEditMenu::SelectShowInExplorer:
+        case KNEditMenu::SelectSearchOnInternet:
+            //These actions open dialogs or work outside the editor.
+            break;
+        default:
+            m_macroMenu->addRecordAction(m_editMenu->menuItem(i));
+            break;
+        }
+    }
+    for(int i=KNSearchMenu::FindNext; i<=KNSearchMenu::FindVolatilePrev; ++i)
+    {
+        m_macroMenu->addRecordAction(m_searchMenu->menuItem(i));
+    }
+    m_macroMenu->addRecordAction(m_searchMenu->menuItem(KNSearchMenu::NextResult));
+    m_macroMenu->addRecordAction(m_searchMenu->menuItem(KNSearchMenu::PrevResult));
+    m_macroMenu->addRecordAction(m_searchMenu->menuItem(KNSearchMenu::GoToMatch));
+    m_macroMenu->addRecordAction(m_searchMenu->menuItem(KNSearchMenu::SelectBetween));
+    for(int i=KNSearchMenu::BookmarkToggle; i<=KNSearchMenu::BookmarkInverse; ++i)
+    {
+        m_macroMenu->addRecordAction(m_searchMenu->menuItem(i));
+    }
     //Link the recent manager.
     connect(m_recent, &KNRecentFileRecorder::requireOpen,
             this, &KNFileManager::openFile);
@@ -614,6 +662,34 @@ void KNFileManager::onReloadCurrent()
     }
 }
 
+void KNFileManager::onReloadFile(const QString &filePath)
+{
+    //Reload all the editors of the file which is changed on the disk.
+    QFileInfo fileInfo(filePath);
+    const auto editors = allEditors();
+    for(auto editor : editors)
+    {
+        if(!editor->isOnDisk() || QFileInfo(editor->filePath()) != fileInfo)
+        {
+            continue;
+        }
+        //Document edited check.
+        if(editor->document()->isModified())
+        {
+            int result = QMessageBox::question(
+                        this, tr("Reload"),
+                        tr("%1 is changed on the disk. Do you want to reload "
+                           "it and lose the changes?").arg(
+                            fileInfo.fileName()));
+            if(result == QMessageBox::No)
+            {
+                continue;
+            }
+        }
+        editor->loadFrom(editor->filePath());
+    }
+}
+
 void KNFileManager::onTabChange(int index)
 {
     if(index > -1)
@@ -630,6 +706,7 @@ void KNFileManager::onTabChange(int index)
         //Update the menu target.
         m_editMenu->setEditor(editor);
         m_searchMenu->setEditor(editor);
+        m_macroMenu->setEditor(editor);
         m_viewMenu->setEditor(editor);
         //Update reload state.
         updateFileItemsEnabled(editor->isOnDisk());
@@ -855,6 +932,11 @@ QMenu *KNFileManager::toolMenu() const
     return m_toolMenu;
 }
 
+QMenu *KNFileManager::macroMenu() const
+{
+    return m_macroMenu;
+}
+
 QMenu *KNFileManager::viewMenu() const
 {
     return m_viewMenu;
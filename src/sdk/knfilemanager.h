@@ -24,6 +24,7 @@ class KNSearchMenu;
 class KNViewMenu;
 class KNCodecMenu;
 class KNToolMenu;
+class KNMacroMenu;
 class KNWindowsMenu;
 class KNTabSwitcher;
 class KNRecentFileRecorder;
@@ -164,6 +165,12 @@ public:
      */
     QMenu *toolMenu() const;
 
+    /*!
+     * \brief Get the macro menu.
+     * \return The menu pointer.
+     */
+    QMenu *macroMenu() const;
+
     /*!
      * \brief Get the window menu.
      * \return The menu pointer.
@@ -224,6 +231,7 @@ private slots:
     void onShowSwitcher();
     void onShowEditor(KNTextEditor *editor);
     void onReloadCurrent();
+    void onReloadFile(const QString &filePath);
     void onTabChange(int index);
     void onEditorTitleChange();
     void onEditorModified(bool modified);
@@ -266,6 +274,7 @@ private:
     KNViewMenu *m_viewMenu;
     KNCodecMenu *m_codecMenu;
     KNToolMenu *m_toolMenu;
+    KNMacroMenu *m_macroMenu;
     KNRecentFileRecorder *m_recent;
     QMenu *m_subMenus[SubMenuCount];
     QAction *m_menuItems[MenuItemCount];
@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) Kreogist Dev Team
+ *
+ * You can redistribute this software and/or modify it under the
+ * terms of the HARERU Software License; either version 1 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * license file for more details.
+ */
+#include <QFile>
+#include <QSaveFile>
+#include <QTextCodec>
+
+#include "kntexteditor.h"
+
+#include "knfiletransform.h"
+
+//The size of the source data read at once, in bytes.
+#define CHUNK_SIZE  (1048576)
+
+KNFileTransform::KNFileTransform(QObject *parent) : QObject(parent),
+    m_endOfLine(EolKeep),
+    m_quit(false)
+{
+}
+
+void KNFileTransform::setLineFunction(
+        const KNTextTransform::LineFunction &func)
+{
+    m_lineFunction = func;
+}
+
+void KNFileTransform::setEndOfLine(int eol)
+{
+    m_endOfLine = eol;
+}
+
+bool KNFileTransform::transform(const QString &sourcePath,
+                                const QString &targetPath)
+{
+    m_quitLock.lock();
+    m_quit = false;
+    m_quitLock.unlock();
+    m_errorString.clear();
+    //Open the source file and the temporary target file.
+    QFile sourceFile(sourcePath);
+    if(!sourceFile.open(QIODevice::ReadOnly))
+    {
+        m_errorString = sourceFile.errorString();
+        return false;
+    }
+    QSaveFile targetFile(targetPath);
+    if(!targetFile.open(QIODevice::WriteOnly))
+    {
+        m_errorString = targetFile.errorString();
+        return false;
+    }
+    //Detect the codec from the first chunk.
+    qint64 total = sourceFile.size(), processed = 0;
+    QByteArray chunk = sourceFile.read(CHUNK_SIZE);
+    QTextCodec *codec = KNTextEditor::codecFromData(chunk);
+    //The decoder skips the byte order mark, copy it to the target directly.
+    int bomLength = 0;
+    if(chunk.startsWith("\xEF\xBB\xBF"))
+    {
+        bomLength = 3;
+    }
+    else if(chunk.startsWith("\xFE\xFF") || chunk.startsWith("\xFF\xFE"))
+    {
+        bomLength = 2;
+    }
+    targetFile.write(chunk.constData(), bomLength);
+    QScopedPointer<QTextDecoder> decoder(codec->makeDecoder());
+    QScopedPointer<QTextEncoder> encoder(
+                codec->makeEncoder(QTextCodec::IgnoreHeader));
+    //Process the source chunk by chunk, only the complete lines are
+    //transformed, the tail of the chunk is kept for the next chunk.
+    QString buffer;
+    while(!chunk.isEmpty())
+    {
+        if(isCanceled())
+        {
+            targetFile.cancelWriting();
+            return false;
+        }
+        buffer.append(decoder->toUnicode(chunk));
+        processed += chunk.size();
+        chunk = sourceFile.read(CHUNK_SIZE);
+        if(targetFile.write(encoder->fromUnicode(
+                                processLines(buffer, chunk.isEmpty()))) < 0)
+        {
+            break;
+        }
+        emit progress(processed, total);
+    }
+    if(sourceFile.error() != QFile::NoError)
+    {
+        m_errorString = sourceFile.errorString();
+        targetFile.cancelWriting();
+        return false;
+    }
+    //The source file might be the target, it could not be replaced while it is
+    //still opened on some platforms.
+    sourceFile.close();
+    if(targetFile.error() != QFile::NoError || !targetFile.commit())
+    {
+        m_errorString = targetFile.errorString();
+        return false;
+    }
+    return true;
+}
+
+QString KNFileTransform::errorString() const
+{
+    return m_errorString;
+}
+
+bool KNFileTransform::isCanceled() const
+{
+    QMutexLocker locker(&m_quitLock);
+    return m_quit;
+}
+
+void KNFileTransform::cancel()
+{
+    m_quitLock.lock();
+    m_quit = true;
+    m_quitLock.unlock();
+}
+
+QString KNFileTransform::processLines(QString &buffer, bool isEnd)
+{
+    static const QString eols[] = {QString(), "\r\n", "\n", "\r"};
+    QString result;
+    result.reserve(buffer.size());
+    const QChar *data = buffer.constData();
+    int lineStart = 0, size = buffer.size();
+    for(int i=0; i<size; ++i)
+    {
+        QChar c = data[i];
+        if(c != '\n' && c != '\r')
+        {
+            continue;
+        }
+        //A CR at the end of the buffer might be the first half of a CR LF.
+        int eolLength = 1;
+        if(c == '\r')
+        {
+            if(i + 1 == size && !isEnd)
+            {
+                break;
+            }
+            if(i + 1 < size && data[i + 1] == '\n')
+            {
+                eolLength = 2;
+            }
+        }
+        QStringView line(data + lineStart, i - lineStart);
+        result.append(m_lineFunction ? m_lineFunction(line) : line.toString());
+        result.append(m_endOfLine == EolKeep ?
+                          QString(data + i, eolLength) : eols[m_endOfLine]);
+        i += eolLength - 1;
+        lineStart = i + 1;
+    }
+    //Flush the last line without the line end when the file is finished.
+    if(isEnd && lineStart < size)
+    {
+        QStringView line(data + lineStart, size - lineStart);
+        result.append(m_lineFunction ? m_lineFunction(line) : line.toString());
+        lineStart = size;
+    }
+    buffer.remove(0, lineStart);
+    return result;
+}
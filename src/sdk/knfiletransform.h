@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) Kreogist Dev Team
+ *
+ * You can redistribute this software and/or modify it under the
+ * terms of the HARERU Software License; either version 1 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * license file for more details.
+ */
+#ifndef KNFILETRANSFORM_H
+#define KNFILETRANSFORM_H
+
+#include <QMutex>
+#include <QObject>
+
+#include "kntexttransform.h"
+
+/*!
+ * \brief The KNFileTransform class transforms a file on the disk without
+ * loading it into an editor. The file is read and decoded chunk by chunk, the
+ * complete lines of each chunk are transformed by the same line functions as
+ * the editor, and written to a temporary file which replaces the target file
+ * when the transform is finished. The memory used is limited by the chunk size
+ * and the longest line of the file.\n
+ * The transform could run in another thread, the progress is reported through
+ * the signal.
+ */
+class KNFileTransform : public QObject
+{
+    Q_OBJECT
+public:
+    enum EndOfLine
+    {
+        EolKeep,
+        EolWindows,
+        EolUnix,
+        EolMac
+    };
+
+    /*!
+     * \brief Construct a KNFileTransform object.
+     * \param parent The parent object.
+     */
+    explicit KNFileTransform(QObject *parent = nullptr);
+
+    /*!
+     * \brief Set the function applied to every line, the line does not
+     * contain the line end. By default the lines are not changed.
+     * \param func The line function.
+     */
+    void setLineFunction(const KNTextTransform::LineFunction &func);
+
+    /*!
+     * \brief Set the line end of the target file.
+     * \param eol The end of line type, the original line ends are kept by
+     * default.
+     */
+    void setEndOfLine(int eol);
+
+    /*!
+     * \brief Transform the source file to the target file. The target file is
+     * only replaced when the transform is completed, the source file is closed
+     * before it is replaced. The editors of the target file are not reloaded.
+     * \param sourcePath The source file path.
+     * \param targetPath The target file path, it could be the source file.
+     * \return If the target file is written, return true.
+     */
+    bool transform(const QString &sourcePath, const QString &targetPath);
+
+    /*!
+     * \brief Get the error description of the last failed transform.
+     * \return The error text.
+     */
+    QString errorString() const;
+
+    /*!
+     * \brief Check whether the last transform is canceled.
+     * \return If the transform is canceled, return true.
+     */
+    bool isCanceled() const;
+
+signals:
+    /*!
+     * \brief When a chunk of the source file is processed, this signal is
+     * emitted.
+     * \param processed The processed bytes.
+     * \param total The size of the source file.
+     */
+    void progress(qint64 processed, qint64 total);
+
+public slots:
+    /*!
+     * \brief Cancel the running transform, it is safe to be called from the
+     * other thread.
+     */
+    void cancel();
+
+private:
+    QString processLines(QString &buffer, bool isEnd);
+    KNTextTransform::LineFunction m_lineFunction;
+    QString m_errorString;
+    mutable QMutex m_quitLock;
+    int m_endOfLine;
+    bool m_quit;
+};
+
+#endif // KNFILETRANSFORM_H
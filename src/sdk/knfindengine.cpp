@@ -13,11 +13,17 @@
 #include <QTextBlock>
 #include <QTextCodec>
 #include <QFileInfo>
+#include <QStringMatcher>
+#include <QThread>
+#include <QtConcurrent/QtConcurrent>
 
 #include "kntexteditor.h"
 
 #include "knfindengine.h"
 
+//The minimum characters searched by one mark task.
+#define MARK_TASK_SIZE  (65536)
+
 KNFindEngine::KNFindEngine(QObject *parent) : QObject(parent),
     m_fileDocumentBuf(nullptr),
     m_quit(false),
@@ -177,6 +183,171 @@ QTextCursor KNFindEngine::cacheSearch(QTextDocument *doc,
     return doc->find(cache.keywords, tc, flags);
 }
 
+static inline bool isWholeWord(const QString &text, int start, int end)
+{
+    return (start == 0 || !text.at(start - 1).isLetterOrNumber()) &&
+            (end == text.length() || !text.at(end).isLetterOrNumber());
+}
+
+static QVector<KNTextMarks::Mark> markKeywords(
+        const QString &text, int from, int to, int limit,
+        const QString &keywords, QTextDocument::FindFlags flags, int style)
+{
+    //The matches start before the end of the part, but they could end after it.
+    QVector<KNTextMarks::Mark> marks;
+    QStringMatcher matcher(keywords,
+                           (flags & QTextDocument::FindCaseSensitively) ?
+                               Qt::CaseSensitive : Qt::CaseInsensitive);
+    int length = keywords.length(),
+            searchEnd = qMin(limit, to + length - 1),
+            pos = static_cast<int>(
+                matcher.indexIn(text.constData(), searchEnd, from));
+    while(pos != -1 && pos < to)
+    {
+        if((flags & QTextDocument::FindWholeWords) &&
+                !isWholeWord(text, pos, pos + length))
+        {
+            pos = static_cast<int>(
+                        matcher.indexIn(text.constData(), searchEnd, pos + 1));
+            continue;
+        }
+        marks.append({pos, length, style});
+        pos = static_cast<int>(
+                    matcher.indexIn(text.constData(), searchEnd, pos + length));
+    }
+    return marks;
+}
+
+static inline QRegularExpressionMatchIterator matchLine(
+        const QRegularExpression &regExp, const QString &text, int start,
+        int length)
+{
+    //Match on a view of the line, the line is not copied.
+#if QT_VERSION >= QT_VERSION_CHECK(6, 5, 0)
+    return regExp.globalMatchView(QStringView(text).mid(start, length));
+#elif QT_VERSION_MAJOR > 5
+    return regExp.globalMatch(QStringView(text).mid(start, length));
+#else
+    return regExp.globalMatch(text.midRef(start, length));
+#endif
+}
+
+static QVector<KNTextMarks::Mark> markRegExp(
+        const QString &text, int from, int to, const QRegularExpression &exp,
+        int style)
+{
+    //Each task uses its own expression. The lines are matched one by one, the
+    //same as searching in the blocks.
+    QRegularExpression regExp(exp.pattern(), exp.patternOptions());
+    QVector<KNTextMarks::Mark> marks;
+    int lineStart = from;
+    while(lineStart < to)
+    {
+        int lineEnd = text.indexOf('\n', lineStart);
+        if(lineEnd == -1 || lineEnd > to)
+        {
+            lineEnd = to;
+        }
+        auto matches = matchLine(regExp, text, lineStart, lineEnd - lineStart);
+        while(matches.hasNext())
+        {
+            auto match = matches.next();
+            //Empty matches could not be marked.
+            if(match.capturedLength() > 0)
+            {
+                marks.append({lineStart + static_cast<int>(match.capturedStart()),
+                              static_cast<int>(match.capturedLength()),
+                              style});
+            }
+        }
+        lineStart = lineEnd + 1;
+    }
+    return marks;
+}
+
+QVector<KNTextMarks::Mark> KNFindEngine::markSearch(
+        QTextDocument *doc, const KNFindEngine::SearchCache &cache,
+        QTextDocument::FindFlags flags, int style, int from, int to)
+{
+    QVector<KNTextMarks::Mark> marks;
+    if(cache.keywords.isEmpty())
+    {
+        return marks;
+    }
+    //The multiple line expression has to be matched with the blocks.
+    if(cache.useReg && cache.multiLine)
+    {
+        QTextCursor tc(doc);
+        tc.setPosition(from);
+        tc = cacheSearch(doc, tc, cache, flags);
+        while(!tc.isNull() && (to == -1 || tc.selectionEnd() <= to))
+        {
+            if(tc.selectionStart() >= from)
+            {
+                marks.append({tc.selectionStart(),
+                              tc.selectionEnd() - tc.selectionStart(),
+                              style});
+            }
+            tc = cacheSearch(doc, tc, cache, flags);
+        }
+        return marks;
+    }
+    //Take a snapshot of the document, the blocks are separated by line feeds.
+    const QString text = doc->toPlainText();
+    if(to == -1 || to > text.length())
+    {
+        to = text.length();
+    }
+    //Split the text at the line ends, each task finds the matches starting in
+    //its own part.
+    int taskSize = qMax(MARK_TASK_SIZE,
+                        (to - from) / qMax(1, QThread::idealThreadCount()));
+    QVector<QFuture<QVector<KNTextMarks::Mark>>> tasks;
+    for(int taskStart = from, taskEnd; taskStart < to; taskStart = taskEnd)
+    {
+        taskEnd = to;
+        if(to - taskStart > taskSize)
+        {
+            taskEnd = text.indexOf('\n', taskStart + taskSize);
+            taskEnd = (taskEnd == -1) ? to : qMin(taskEnd + 1, to);
+        }
+        if(cache.useReg)
+        {
+            tasks.append(QtConcurrent::run([&text, &cache, taskStart, taskEnd,
+                                           style]
+            {
+                return markRegExp(text, taskStart, taskEnd, cache.regExp,
+                                  style);
+            }));
+        }
+        else
+        {
+            tasks.append(QtConcurrent::run([&text, &cache, taskStart, taskEnd,
+                                           to, flags, style]
+            {
+                return markKeywords(text, taskStart, taskEnd, to,
+                                    cache.keywords, flags, style);
+            }));
+        }
+    }
+    //Join the results. A match overlapping the previous one is skipped, the
+    //same as searching in order.
+    int lastEnd = from;
+    for(int i=0; i<tasks.size(); ++i)
+    {
+        const QVector<KNTextMarks::Mark> taskMarks = tasks[i].result();
+        for(const KNTextMarks::Mark &mark : taskMarks)
+        {
+            if(mark.start >= lastEnd)
+            {
+                marks.append(mark);
+                lastEnd = mark.start + mark.length;
+            }
+        }
+    }
+    return marks;
+}
+
 void KNFindEngine::start()
 {
     //Configure the quit variable.
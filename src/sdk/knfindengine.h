@@ -19,6 +19,7 @@
 #include <QMutex>
 
 #include "knsearchresult.h"
+#include "kntextmarks.h"
 
 #include <QObject>
 
@@ -63,6 +64,23 @@ public:
             const SearchCache &cache,
             QTextDocument::FindFlags flags);
 
+    /*!
+     * \brief Find all the matches in a range of a document as marks. The
+     * search runs over a snapshot of the document text, the text is split at
+     * the line ends and the parts are searched in parallel.
+     * \param doc The document to search.
+     * \param cache The prepared search cache.
+     * \param flags The search flag, the backward flag should not be set.
+     * \param style The mark style of the matches.
+     * \param from The start position of the range.
+     * \param to The end position of the range, -1 means the document end.
+     * \return The marks sorted by the start position.
+     */
+    static QVector<KNTextMarks::Mark> markSearch(QTextDocument *doc,
+            const SearchCache &cache,
+            QTextDocument::FindFlags flags,
+            int style, int from = 0, int to = -1);
+
     /*!
      * \brief Set the document search cache.
      * \param cache The cache of the document.
@@ -53,6 +53,7 @@ KNFindWindow::KNFindWindow(KNSearchResult *result, QWidget *parent) :
     m_findText(generateBox()),
     m_replaceText(generateBox()),
     m_filters(generateBox()),
+    m_markStyle(new QComboBox(this)),
     m_optionNormal(new QRadioButton(this)),
     m_optionExtend(new QRadioButton(this)),
     m_optionReg(new QRadioButton(this)),
@@ -313,6 +314,15 @@ void KNFindWindow::retranslate()
     m_labels[LabelFind]->setText(tr("Find what :"));
     m_labels[LabelReplace]->setText(tr("Replace with :"));
     m_labels[LabelFilter]->setText(tr("Filters :"));
+    m_labels[LabelStyle]->setText(tr("Mark style :"));
+    //Update the mark styles.
+    int markStyle = qMax(m_markStyle->currentIndex(), 0);
+    m_markStyle->clear();
+    for(int i=0; i<MARK_STYLE_COUNT; ++i)
+    {
+        m_markStyle->addItem(tr("Style %1").arg(i + 1));
+    }
+    m_markStyle->setCurrentIndex(markStyle);
     //Summary the label size.
     m_inSelection->setText(tr("In select&ion"));
     m_optionNormal->setText(tr("&Normal"));
@@ -405,7 +415,9 @@ void KNFindWindow::onTabChanged(int tabIndex)
     m_matchOption[OptionWrapAround]->hide();
     m_labels[LabelReplace]->hide();
     m_labels[LabelFilter]->hide();
+    m_labels[LabelStyle]->hide();
     m_replaceText->hide();
+    m_markStyle->hide();
     m_selectBox->hide();
     m_inSelection->hide();
     m_filters->hide();
@@ -461,6 +473,8 @@ void KNFindWindow::onTabChanged(int tabIndex)
         m_buttons[MarkAll]->setDefault(true);
         setWidget(m_buttons[ClearMarks], 1, 5, 1, 1);
         setWidget(m_buttons[Close], 2, 5, 1, 1);
+        setWidget(m_labels[LabelStyle], 1, 0, 1, 1, Qt::AlignRight | Qt::AlignVCenter);
+        setWidget(m_markStyle, 1, 1, 1, 1);
         setWidget(m_inSelection, 2, 3, 1, 1);
         m_matchOption[OptionBookmarkLine]->show();
         m_matchOption[OptionPurge]->show();
@@ -648,10 +662,52 @@ void KNFindWindow::onReplaceAll()
 
 void KNFindWindow::onMarkAll()
 {
+    //Convert the find next.
+    auto manager = static_cast<KNFileManager *>(parentWidget());
+    //Fetch the current editor.
+    KNTextEditor *editor = manager->currentEditor();
+    if(!editor)
+    {
+        return;
+    }
+    //Clear the previous marks.
+    if(m_matchOption[OptionPurge]->isChecked())
+    {
+        editor->clearMarks();
+    }
+    //Check the search range.
+    QTextCursor tc = editor->textCursor();
+    bool inSelection = m_inSelection->isEnabled() &&
+            m_inSelection->isChecked() && tc.hasSelection();
+    int from = inSelection ? tc.selectionStart() : 0,
+            to = inSelection ? tc.selectionEnd() : -1;
+    //Mark all the matches in the range.
+    auto marks = KNFindEngine::markSearch(editor->document(),
+                                          createSearchCache(),
+                                          getOneWaySearchFlags(),
+                                          m_markStyle->currentIndex(),
+                                          from, to);
+    editor->addMarks(marks, m_matchOption[OptionBookmarkLine]->isChecked());
+    //Update the mark result.
+    m_message->setText(infoText(
+                           (inSelection ?
+                                tr("Mark: %1 match(es) in selected text.") :
+                                tr("Mark: %1 match(es) in entire file.")).arg(
+                               QString::number(marks.size()))));
 }
 
 void KNFindWindow::onClearMarks()
 {
+    //Convert the find next.
+    auto manager = static_cast<KNFileManager *>(parentWidget());
+    //Fetch the current editor.
+    KNTextEditor *editor = manager->currentEditor();
+    if(!editor)
+    {
+        return;
+    }
+    editor->clearMarks();
+    m_message->clear();
 }
 
 void KNFindWindow::onCancelSearchEngine()
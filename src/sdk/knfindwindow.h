@@ -134,6 +134,7 @@ private:
         LabelFind,
         LabelReplace,
         LabelFilter,
+        LabelStyle,
         LabelCount
     };
     enum MatchOptions
@@ -172,7 +173,7 @@ private:
     QGridLayout *m_layout;
     QTabBar *m_tabBar;
     QLabel *m_labels[LabelCount], *m_message;
-    QComboBox *m_findText, *m_replaceText, *m_filters;
+    QComboBox *m_findText, *m_replaceText, *m_filters, *m_markStyle;
     QRadioButton *m_optionNormal, *m_optionExtend, *m_optionReg,
                  *m_transOnLose, *m_transAlways;
     QSlider *m_transValue;
@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) Kreogist Dev Team
+ *
+ * You can redistribute this software and/or modify it under the
+ * terms of the HARERU Software License; either version 1 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * license file for more details.
+ */
+#include <QBoxLayout>
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QPainter>
+#include <QPushButton>
+
+#include "knuimanager.h"
+
+#include "knframemonitor.h"
+
+//The frame time of 60 FPS in nanosecond.
+#define FRAME_BUDGET    (16666667)
+#define BAR_WIDTH       (2)
+
+static const QColor phaseColors[KNFrameProfiler::PhaseCount] =
+{
+    QColor(66, 133, 244),
+    QColor(15, 157, 88),
+    QColor(244, 180, 0),
+    QColor(219, 68, 55),
+    QColor(171, 71, 188)
+};
+
+KNFrameMonitor::KNFrameMonitor(QWidget *parent) : QWidget(parent),
+    m_record(new QPushButton(this)),
+    m_save(new QPushButton(this))
+{
+    //Add widgets, the frames are painted above the buttons.
+    QBoxLayout *layout = new QBoxLayout(QBoxLayout::TopToBottom, this);
+    layout->setContentsMargins(knUi->margins(0, 0, 0, 0));
+    layout->setSpacing(0);
+    setLayout(layout);
+    layout->addStretch();
+    QBoxLayout *buttonLayout = new QBoxLayout(QBoxLayout::LeftToRight);
+    layout->addLayout(buttonLayout);
+    buttonLayout->addStretch();
+    buttonLayout->addWidget(m_record);
+    buttonLayout->addWidget(m_save);
+    //Configure the buttons.
+    m_record->setCheckable(true);
+    connect(m_record, &QPushButton::toggled,
+            knProfiler, &KNFrameProfiler::setTracing);
+    connect(m_save, &QPushButton::clicked, this, &KNFrameMonitor::onSaveTrace);
+    //Update the monitor when a frame is finished.
+    connect(knProfiler, &KNFrameProfiler::frameFinished,
+            this, [=]{ update(); });
+    //Link the retranslate.
+    knUi->addTranslate(this, &KNFrameMonitor::retranslate);
+}
+
+void KNFrameMonitor::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event)
+    QPainter painter(this);
+    const QVector<KNFrameProfiler::Frame> frames = knProfiler->frames();
+    int lineHeight = fontMetrics().height(), y = 0;
+    //Draw the details of the latest frame.
+    if(!frames.isEmpty())
+    {
+        const KNFrameProfiler::Frame &frame = frames.last();
+        painter.drawText(0, y, width(), lineHeight, Qt::AlignLeft,
+                         m_frameText.arg(
+                             QString::number(frame.duration / 1000000.0, 'f', 2)));
+        y += lineHeight;
+        for(int i=0; i<KNFrameProfiler::PhaseCount; ++i)
+        {
+            painter.fillRect(0, y + (lineHeight >> 2), lineHeight >> 1,
+                             lineHeight >> 1, phaseColors[i]);
+            painter.drawText(lineHeight, y, width() - lineHeight, lineHeight,
+                             Qt::AlignLeft,
+                             m_phaseNames[i].arg(QString::number(
+                                                     frame.phases[i] / 1000000.0, 'f', 2)));
+            y += lineHeight;
+        }
+        for(int i=0; i<KNFrameProfiler::CounterCount; ++i)
+        {
+            painter.drawText(0, y, width(), lineHeight, Qt::AlignLeft,
+                             m_counterNames[i].arg(frame.counters[i]));
+            y += lineHeight;
+        }
+    }
+    //Draw the frame graph between the details and the buttons.
+    QRect graphRect(0, y, width(), m_record->y() - y);
+    if(graphRect.height() <= 0)
+    {
+        return;
+    }
+    //The frame budget is the half of the graph.
+    qreal scale = (graphRect.height() >> 1) / static_cast<qreal>(FRAME_BUDGET);
+    int x = graphRect.right() - BAR_WIDTH + 1;
+    for(int i=frames.size() - 1; i>-1 && x>=0; --i, x-=BAR_WIDTH)
+    {
+        const KNFrameProfiler::Frame &frame = frames.at(i);
+        qreal barBottom = graphRect.bottom() + 1;
+        for(int j=0; j<KNFrameProfiler::PhaseCount; ++j)
+        {
+            qreal barHeight = frame.phases[j] * scale;
+            painter.fillRect(QRectF(x, barBottom - barHeight, BAR_WIDTH,
+                                    barHeight), phaseColors[j]);
+            barBottom -= barHeight;
+        }
+    }
+    //Draw the frame budget line.
+    int budgetY = graphRect.bottom() - (graphRect.height() >> 1);
+    painter.setPen(palette().color(QPalette::WindowText));
+    painter.drawLine(0, budgetY, width(), budgetY);
+}
+
+void KNFrameMonitor::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+    //Start recording when the monitor is shown.
+    knProfiler->setEnabled(true);
+}
+
+void KNFrameMonitor::hideEvent(QHideEvent *event)
+{
+    QWidget::hideEvent(event);
+    //Stop recording when the monitor is hidden.
+    knProfiler->setEnabled(false);
+}
+
+void KNFrameMonitor::retranslate()
+{
+    m_frameText = tr("Frame: %1 ms");
+    m_phaseNames[KNFrameProfiler::PaintEditor] = tr("Paint editor: %1 ms");
+    m_phaseNames[KNFrameProfiler::PaintSidebar] = tr("Paint sidebar: %1 ms");
+    m_phaseNames[KNFrameProfiler::ExtraSelections] = tr("Extra selections: %1 ms");
+    m_phaseNames[KNFrameProfiler::Highlight] = tr("Highlight: %1 ms");
+    m_phaseNames[KNFrameProfiler::Layout] = tr("Layout: %1 ms");
+    m_counterNames[KNFrameProfiler::BlocksPainted] = tr("Blocks painted: %1");
+    m_counterNames[KNFrameProfiler::SelectionsProcessed] = tr("Selections processed: %1");
+    m_counterNames[KNFrameProfiler::HighlighterCalls] = tr("Highlighter calls: %1");
+    m_record->setText(tr("Record Trace"));
+    m_save->setText(tr("Save Trace..."));
+    update();
+}
+
+void KNFrameMonitor::onSaveTrace()
+{
+    //Get the file path.
+    QString filePath = QFileDialog::getSaveFileName(
+                this, tr("Save Trace"), QString(),
+                tr("Chrome trace files (*.json)"));
+    if(filePath.isEmpty())
+    {
+        return;
+    }
+    if(!knProfiler->saveTrace(filePath))
+    {
+        QMessageBox::information(this, tr("Save failed"),
+                                 tr("Please check if the trace file is writable."));
+    }
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) Kreogist Dev Team
+ *
+ * You can redistribute this software and/or modify it under the
+ * terms of the HARERU Software License; either version 1 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * license file for more details.
+ */
+#ifndef KNFRAMEMONITOR_H
+#define KNFRAMEMONITOR_H
+
+#include "knframeprofiler.h"
+
+#include <QWidget>
+
+class QPushButton;
+/*!
+ * \brief The KNFrameMonitor class displays the frames recorded by the frame
+ * profiler. It shows the time of each phase in the latest frame, the frame time
+ * graph of the recent frames, and provides the buttons to record and save a
+ * Chrome trace file.\n
+ * The profiler is enabled only when the monitor is shown.
+ */
+class KNFrameMonitor : public QWidget
+{
+    Q_OBJECT
+public:
+    /*!
+     * \brief Construct a KNFrameMonitor widget.
+     * \param parent The parent widget.
+     */
+    explicit KNFrameMonitor(QWidget *parent = nullptr);
+
+protected:
+    /*!
+     * \brief Reimplemented from QWidget::paintEvent().
+     */
+    void paintEvent(QPaintEvent *event) override;
+
+    /*!
+     * \brief Reimplemented from QWidget::showEvent().
+     */
+    void showEvent(QShowEvent *event) override;
+
+    /*!
+     * \brief Reimplemented from QWidget::hideEvent().
+     */
+    void hideEvent(QHideEvent *event) override;
+
+private slots:
+    void retranslate();
+    void onSaveTrace();
+
+private:
+    QString m_phaseNames[KNFrameProfiler::PhaseCount],
+            m_counterNames[KNFrameProfiler::CounterCount],
+            m_frameText;
+    QPushButton *m_record, *m_save;
+};
+
+#endif // KNFRAMEMONITOR_H
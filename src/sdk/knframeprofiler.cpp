@@ -0,0 +1,280 @@
+/*
+ * Copyright (C) Kreogist Dev Team
+ *
+ * You can redistribute this software and/or modify it under the
+ * terms of the HARERU Software License; either version 1 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * license file for more details.
+ */
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QFile>
+#include <QTimer>
+
+#include "knframeprofiler.h"
+
+#define MAX_FRAMES          (240)
+#define MAX_TRACE_EVENTS    (1000000)
+
+KNFrameProfiler *KNFrameProfiler::ins = nullptr;
+
+KNFrameProfiler *KNFrameProfiler::instance()
+{
+    //Return the instance pointer.
+    return ins;
+}
+
+void KNFrameProfiler::initial(QObject *parent)
+{
+    //Check if the singleton instance variable is null. Set the pointer to this
+    //object if this is the first constructed object.
+    if(ins == nullptr)
+    {
+        ins = new KNFrameProfiler(parent);
+    }
+}
+
+bool KNFrameProfiler::isEnabled() const
+{
+    return m_enabled;
+}
+
+void KNFrameProfiler::count(int counter, int value)
+{
+    //Ignore the counters when the profiler is disabled.
+    if(!ins || !ins->m_enabled)
+    {
+        return;
+    }
+    ins->startFrame();
+    ins->m_current.counters[counter] += value;
+}
+
+QVector<KNFrameProfiler::Frame> KNFrameProfiler::frames() const
+{
+    return m_frames;
+}
+
+QString KNFrameProfiler::phaseName(int phase)
+{
+    switch(phase)
+    {
+    case PaintEditor:
+        return QStringLiteral("Paint editor");
+    case PaintSidebar:
+        return QStringLiteral("Paint sidebar");
+    case ExtraSelections:
+        return QStringLiteral("Extra selections");
+    case Highlight:
+        return QStringLiteral("Highlight");
+    case Layout:
+        return QStringLiteral("Layout");
+    default:
+        return QString();
+    }
+}
+
+QString KNFrameProfiler::counterName(int counter)
+{
+    switch(counter)
+    {
+    case BlocksPainted:
+        return QStringLiteral("Blocks painted");
+    case SelectionsProcessed:
+        return QStringLiteral("Selections processed");
+    case HighlighterCalls:
+        return QStringLiteral("Highlighter calls");
+    default:
+        return QString();
+    }
+}
+
+bool KNFrameProfiler::isTracing() const
+{
+    return m_tracing;
+}
+
+bool KNFrameProfiler::saveTrace(const QString &filePath) const
+{
+    //Convert the events to Chrome trace complete events, the time unit of the
+    //trace is microsecond.
+    QJsonArray traceEvents;
+    for(int i=0; i<m_events.size(); ++i)
+    {
+        const TraceEvent &event = m_events.at(i);
+        QJsonObject traceEvent;
+        traceEvent.insert("pid", 1);
+        traceEvent.insert("tid", 1);
+        traceEvent.insert("ts", static_cast<double>(event.start) / 1000.0);
+        if(event.phase == -1)
+        {
+            //Frame counters.
+            QJsonObject args;
+            for(int j=0; j<CounterCount; ++j)
+            {
+                args.insert(counterName(j), event.counters[j]);
+            }
+            traceEvent.insert("name", QStringLiteral("Frame"));
+            traceEvent.insert("ph", QStringLiteral("C"));
+            traceEvent.insert("args", args);
+        }
+        else
+        {
+            traceEvent.insert("name", phaseName(event.phase));
+            traceEvent.insert("cat", QStringLiteral("editor"));
+            traceEvent.insert("ph", QStringLiteral("X"));
+            traceEvent.insert("dur", static_cast<double>(event.duration) / 1000.0);
+        }
+        traceEvents.append(traceEvent);
+    }
+    QJsonObject trace;
+    trace.insert("traceEvents", traceEvents);
+    trace.insert("displayTimeUnit", QStringLiteral("ms"));
+    //Write the trace file.
+    QFile traceFile(filePath);
+    if(!traceFile.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+    traceFile.write(QJsonDocument(trace).toJson(QJsonDocument::Compact));
+    traceFile.close();
+    return true;
+}
+
+void KNFrameProfiler::setEnabled(bool enabled)
+{
+    m_enabled = enabled;
+    if(!m_enabled)
+    {
+        //Drop the unfinished frame.
+        m_frameOpen = false;
+        m_scope = nullptr;
+    }
+}
+
+void KNFrameProfiler::setTracing(bool tracing)
+{
+    if(tracing)
+    {
+        m_events.clear();
+    }
+    m_tracing = tracing;
+}
+
+void KNFrameProfiler::onFrameFinished()
+{
+    //Check whether the frame is dropped.
+    if(!m_frameOpen)
+    {
+        return;
+    }
+    m_frameOpen = false;
+    m_current.duration = m_frameEnd - m_frameStart;
+    //Save the frame.
+    if(m_frames.size() == MAX_FRAMES)
+    {
+        m_frames.removeFirst();
+    }
+    m_frames.append(m_current);
+    if(m_tracing && m_events.size() < MAX_TRACE_EVENTS)
+    {
+        TraceEvent event;
+        event.start = m_frameStart;
+        event.duration = m_current.duration;
+        event.phase = -1;
+        for(int i=0; i<CounterCount; ++i)
+        {
+            event.counters[i] = m_current.counters[i];
+        }
+        m_events.append(event);
+    }
+    emit frameFinished();
+}
+
+KNFrameProfiler::KNFrameProfiler(QObject *parent) : QObject(parent),
+    m_scope(nullptr),
+    m_frameStart(0),
+    m_frameEnd(0),
+    m_enabled(false),
+    m_tracing(false),
+    m_frameOpen(false)
+{
+    m_clock.start();
+}
+
+void KNFrameProfiler::startFrame()
+{
+    if(m_frameOpen)
+    {
+        return;
+    }
+    //All the work until the event loop is back is the same frame.
+    m_frameOpen = true;
+    m_frameStart = m_clock.nsecsElapsed();
+    m_frameEnd = m_frameStart;
+    m_current = Frame();
+    QTimer::singleShot(0, this, &KNFrameProfiler::onFrameFinished);
+}
+
+void KNFrameProfiler::record(int phase, qint64 start, qint64 duration,
+                             qint64 selfTime)
+{
+    startFrame();
+    m_current.phases[phase] += selfTime;
+    m_frameStart = qMin(m_frameStart, start);
+    m_frameEnd = qMax(m_frameEnd, start + duration);
+    //Save the trace event.
+    if(m_tracing && m_events.size() < MAX_TRACE_EVENTS)
+    {
+        TraceEvent event;
+        event.start = start;
+        event.duration = duration;
+        event.phase = phase;
+        m_events.append(event);
+    }
+}
+
+KNProfileScope::KNProfileScope(int phase) :
+    m_profiler(KNFrameProfiler::instance()),
+    m_parent(nullptr),
+    m_start(0),
+    m_childTime(0),
+    m_phase(phase)
+{
+    //Check whether the profiler is recording.
+    if(!m_profiler || !m_profiler->m_enabled)
+    {
+        m_profiler = nullptr;
+        return;
+    }
+    //Push the scope.
+    m_parent = m_profiler->m_scope;
+    m_profiler->m_scope = this;
+    m_start = m_profiler->m_clock.nsecsElapsed();
+}
+
+KNProfileScope::~KNProfileScope()
+{
+    if(!m_profiler)
+    {
+        return;
+    }
+    qint64 duration = m_profiler->m_clock.nsecsElapsed() - m_start;
+    //Check whether the profiler is disabled while timing.
+    if(!m_profiler->m_enabled)
+    {
+        return;
+    }
+    m_profiler->record(m_phase, m_start, duration, duration - m_childTime);
+    //Pop the scope.
+    if(m_parent)
+    {
+        m_parent->m_childTime += duration;
+    }
+    m_profiler->m_scope = m_parent;
+}
@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) Kreogist Dev Team
+ *
+ * You can redistribute this software and/or modify it under the
+ * terms of the HARERU Software License; either version 1 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * license file for more details.
+ */
+#ifndef KNFRAMEPROFILER_H
+#define KNFRAMEPROFILER_H
+
+#include <QElapsedTimer>
+#include <QVector>
+
+#include <QObject>
+
+/*!
+ * \def knProfiler
+ * A global pointer referring to the unique frame profiler object.
+ */
+#define knProfiler  (KNFrameProfiler::instance())
+
+class KNProfileScope;
+/*!
+ * \brief The KNFrameProfiler class records the time spent in the editor
+ * rendering phases. All the work recorded in the same event loop iteration is
+ * counted as one frame.\n
+ * The profiler only records in the GUI thread, and it does nothing until it
+ * is enabled.
+ */
+class KNFrameProfiler : public QObject
+{
+    Q_OBJECT
+public:
+    enum Phases
+    {
+        PaintEditor,
+        PaintSidebar,
+        ExtraSelections,
+        Highlight,
+        Layout,
+        PhaseCount
+    };
+
+    enum Counters
+    {
+        BlocksPainted,
+        SelectionsProcessed,
+        HighlighterCalls,
+        CounterCount
+    };
+
+    struct Frame
+    {
+        qint64 duration;
+        qint64 phases[PhaseCount];
+        int counters[CounterCount];
+    };
+
+    /*!
+     * \brief Get the global instance of the frame profiler.
+     * \return The global frame profiler instance.
+     */
+    static KNFrameProfiler *instance();
+
+    /*!
+     * \brief Initial the profiler, generate the instance with the given parent
+     * object.\n
+     * Only the first time will create a instance.
+     */
+    static void initial(QObject *parent = nullptr);
+
+    /*!
+     * \brief Check whether the profiler is recording.
+     * \return If the profiler is enabled, return true.
+     */
+    bool isEnabled() const;
+
+    /*!
+     * \brief Add a value to a counter of the current frame.
+     * \param counter The counter index.
+     * \param value The value to add.
+     */
+    static void count(int counter, int value = 1);
+
+    /*!
+     * \brief Get the recorded frames, from the oldest to the latest.
+     * \return The frame list.
+     */
+    QVector<Frame> frames() const;
+
+    /*!
+     * \brief Get the name of a phase.
+     * \param phase The phase index.
+     * \return The untranslated phase name.
+     */
+    static QString phaseName(int phase);
+
+    /*!
+     * \brief Get the name of a counter.
+     * \param counter The counter index.
+     * \return The untranslated counter name.
+     */
+    static QString counterName(int counter);
+
+    /*!
+     * \brief Check whether the profiler is saving trace events.
+     * \return If the trace is recording, return true.
+     */
+    bool isTracing() const;
+
+    /*!
+     * \brief Save the trace events in Chrome trace event format.
+     * \param filePath The target file path.
+     * \return If the file is saved, return true.
+     */
+    bool saveTrace(const QString &filePath) const;
+
+signals:
+    /*!
+     * \brief When a frame is finished, this signal is emitted.
+     */
+    void frameFinished();
+
+public slots:
+    /*!
+     * \brief Enable or disable the profiler.
+     * \param enabled To enable the profiler, set true.
+     */
+    void setEnabled(bool enabled);
+
+    /*!
+     * \brief Start or stop saving the trace events. Starting a trace clears
+     * the previous events.
+     * \param tracing To start the trace, set true.
+     */
+    void setTracing(bool tracing);
+
+private slots:
+    void onFrameFinished();
+
+private:
+    friend class KNProfileScope;
+    struct TraceEvent
+    {
+        qint64 start;
+        qint64 duration;
+        int phase;
+        int counters[CounterCount];
+    };
+    explicit KNFrameProfiler(QObject *parent = nullptr);
+    static KNFrameProfiler *ins;
+    void startFrame();
+    void record(int phase, qint64 start, qint64 duration, qint64 selfTime);
+    QVector<Frame> m_frames;
+    QVector<TraceEvent> m_events;
+    Frame m_current;
+    QElapsedTimer m_clock;
+    KNProfileScope *m_scope;
+    qint64 m_frameStart, m_frameEnd;
+    bool m_enabled, m_tracing, m_frameOpen;
+};
+
+/*!
+ * \brief The KNProfileScope class records the time of a phase from the
+ * construction to the destruction. The time of the nested scopes is excluded
+ * from the phase time of the outer scope.
+ */
+class KNProfileScope
+{
+public:
+    /*!
+     * \brief Construct a KNProfileScope object and start timing.
+     * \param phase The phase index.
+     */
+    explicit KNProfileScope(int phase);
+    ~KNProfileScope();
+
+private:
+    Q_DISABLE_COPY(KNProfileScope)
+    KNFrameProfiler *m_profiler;
+    KNProfileScope *m_parent;
+    qint64 m_start, m_childTime;
+    int m_phase;
+};
+
+#endif // KNFRAMEPROFILER_H
@@ -23,6 +23,9 @@
 #include "knutil.h"
 #include "knsyntaxhighlighter.h"
 #include "knversion.h"
+#include "knframeprofiler.h"
+#include "knlanguagemodel.h"
+#include "knhighlightcache.h"
 
 #include "knglobal.h"
 
@@ -68,6 +71,10 @@ KNGlobal::KNGlobal(KNMainWindow *parent) : QObject(parent),
     KNConfigureManager::initial(this);
     //Generate the UI manager.
     KNUiManager::initial(this);
+    //Generate the frame profiler.
+    KNFrameProfiler::initial(this);
+    //Generate the language model.
+    KNLanguageModel::initial(this);
     //Load the infrastructures.
     //Initial the paths.
     /*
@@ -449,10 +456,19 @@ void KNGlobal::startUp()
                                      QFontDatabase::systemFont(QFontDatabase::FixedFont)).value<QFont>();
     m_presetFont.setPointSize(knUi->heightF(10));
     m_scaledFont = m_presetFont;
+    //Configure the highlight cache of the large files.
+    if(m_configure->data("HighlightCache", true).toBool())
+    {
+        KNHighlightCache::setDirectory(m_dirPath[UserDir] + "/Cache/Highlight");
+    }
     //Update the quick search format.
     m_quickSearchFormat.setBackground(QColor(155, 255, 155));
-    //Update the format.
+    //Update the format of the mark styles.
     m_markFormat[0].setBackground(QColor(255, 155, 155));
+    m_markFormat[1].setBackground(QColor(155, 205, 255));
+    m_markFormat[2].setBackground(QColor(255, 215, 135));
+    m_markFormat[3].setBackground(QColor(215, 165, 255));
+    m_markFormat[4].setBackground(QColor(165, 235, 225));
     // Initialize the main window.
     m_mainWindow->initalize();
     // Set the theme based on the settings.
@@ -476,6 +492,18 @@ bool KNGlobal::replaceTab() const
     return m_configure->data("ReplaceTabAsSpace", true).toBool();
 }
 
+int KNGlobal::longLineThreshold() const
+{
+    //Fetch the information.
+    return m_configure->data("LongLineThreshold", 10000).toInt();
+}
+
+int KNGlobal::tileCacheBudget() const
+{
+    //Fetch the information.
+    return m_configure->data("TileCacheBudget", 32).toInt();
+}
+
 int KNGlobal::symbolDisplayMode() const
 {
     //Fetch the information.
@@ -106,6 +106,19 @@ public:
      */
     bool replaceTab() const;
 
+    /*!
+     * \brief Get the long line threshold of the text editors.
+     * \return The character count limit of a line before it is laid out in
+     * horizontal segments.
+     */
+    int longLineThreshold() const;
+
+    /*!
+     * \brief Get the memory budget of the text editor tile cache.
+     * \return The memory budget of each text editor in megabytes.
+     */
+    int tileCacheBudget() const;
+
     /*!
      * \brief Get the symbol display mode.
      * \return The text editor display mode.
@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) Kreogist Dev Team
+ *
+ * You can redistribute this software and/or modify it under the
+ * terms of the HARERU Software License; either version 1 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * license file for more details.
+ */
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include "knhighlightcache.h"
+
+#define CACHE_MAGIC     (0x4B4E4843)
+#define CACHE_VERSION   (1)
+//The files smaller than this size are highlighted fast enough.
+#define CACHE_MIN_SIZE  (262144)
+
+void KNHighlightCache::setDirectory(const QString &dirPath)
+{
+    directory() = dirPath;
+}
+
+bool KNHighlightCache::isEnabled()
+{
+    return !directory().isEmpty();
+}
+
+bool KNHighlightCache::isCacheable(const QString &filePath)
+{
+    return isEnabled() && QFileInfo(filePath).size() >= CACHE_MIN_SIZE;
+}
+
+quint64 KNHighlightCache::textHash(const QString &text)
+{
+    //FNV-1a of the UTF-16 code units, qHash() is seeded for each process.
+    quint64 hash = 14695981039346656037ULL;
+    const QChar *data = text.constData();
+    for(int i=0; i<text.size(); ++i)
+    {
+        hash = (hash ^ data[i].unicode()) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+bool KNHighlightCache::load(const QString &filePath,
+                            const QByteArray &definitionHash)
+{
+    if(definitionHash.isEmpty() || !isCacheable(filePath))
+    {
+        return false;
+    }
+    QFileInfo fileInfo(filePath);
+    QFile cacheFile(cachePath(filePath));
+    if(!cacheFile.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+    QDataStream stream(&cacheFile);
+    stream.setVersion(QDataStream::Qt_5_6);
+    //Check the key of the cache.
+    quint32 magic, version;
+    QString cachedPath;
+    qint64 size, modified;
+    QByteArray cachedHash;
+    stream >> magic >> version;
+    if(magic != CACHE_MAGIC || version != CACHE_VERSION)
+    {
+        return false;
+    }
+    stream >> cachedPath >> size >> modified >> cachedHash;
+    if(stream.status() != QDataStream::Ok ||
+            cachedPath != fileInfo.absoluteFilePath() ||
+            size != fileInfo.size() ||
+            modified != fileInfo.lastModified().toMSecsSinceEpoch() ||
+            cachedHash != definitionHash)
+    {
+        return false;
+    }
+    //Load the state table and the blocks.
+    qint32 blockCount;
+    stream >> states >> captures >> blockCount;
+    blocks.clear();
+    blocks.reserve(qMax(0, blockCount));
+    for(int i=0; i<blockCount && stream.status() == QDataStream::Ok; ++i)
+    {
+        Block block;
+        qint32 previousState, state;
+        stream >> block.isValid;
+        if(block.isValid)
+        {
+            stream >> block.textHash >> previousState >> state
+                   >> block.formatRuns >> block.regionMarks;
+            block.previousState = previousState;
+            block.state = state;
+        }
+        blocks.append(block);
+    }
+    if(stream.status() != QDataStream::Ok || states.isEmpty())
+    {
+        states.clear();
+        captures.clear();
+        blocks.clear();
+        return false;
+    }
+    return true;
+}
+
+bool KNHighlightCache::save(const QString &filePath,
+                            const QByteArray &definitionHash) const
+{
+    if(definitionHash.isEmpty() || !isCacheable(filePath) ||
+            !QDir().mkpath(directory()))
+    {
+        return false;
+    }
+    QFileInfo fileInfo(filePath);
+    //Write to a temporary file, a broken cache never replaces the old one.
+    QSaveFile cacheFile(cachePath(filePath));
+    if(!cacheFile.open(QIODevice::WriteOnly))
+    {
+        return false;
+    }
+    QDataStream stream(&cacheFile);
+    stream.setVersion(QDataStream::Qt_5_6);
+    stream << quint32(CACHE_MAGIC) << quint32(CACHE_VERSION)
+           << fileInfo.absoluteFilePath() << qint64(fileInfo.size())
+           << qint64(fileInfo.lastModified().toMSecsSinceEpoch())
+           << definitionHash << states << captures << qint32(blocks.size());
+    for(const Block &block : blocks)
+    {
+        stream << block.isValid;
+        if(block.isValid)
+        {
+            stream << block.textHash << qint32(block.previousState)
+                   << qint32(block.state) << block.formatRuns
+                   << block.regionMarks;
+        }
+    }
+    return stream.status() == QDataStream::Ok && cacheFile.commit();
+}
+
+QString &KNHighlightCache::directory()
+{
+    static QString dirPath;
+    return dirPath;
+}
+
+QString KNHighlightCache::cachePath(const QString &filePath)
+{
+    //The cache file is named by the hash of the file path.
+    QByteArray pathHash = QCryptographicHash::hash(
+                QFileInfo(filePath).absoluteFilePath().toUtf8(),
+                QCryptographicHash::Sha1).toHex();
+    return directory() + "/" + QString::fromLatin1(pathHash) + ".cache";
+}
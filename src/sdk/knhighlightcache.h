@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) Kreogist Dev Team
+ *
+ * You can redistribute this software and/or modify it under the
+ * terms of the HARERU Software License; either version 1 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * license file for more details.
+ */
+#ifndef KNHIGHLIGHTCACHE_H
+#define KNHIGHLIGHTCACHE_H
+
+#include <QStringList>
+#include <QVector>
+
+/*!
+ * \brief The KNHighlightCache class is the highlight result of a file saved on
+ * the disk. It keeps the end state and the format runs of each block, and the
+ * state table of the highlighter, so a reopened file could apply the formats
+ * without running the syntax rules.\n
+ * The cache of a file is only loaded when the file path, size, modified time
+ * and the hash of the syntax definition are all the same as saved. A block is
+ * still checked with its text hash and the state of its previous block before
+ * the cached formats are used.
+ */
+class KNHighlightCache
+{
+public:
+    struct Block
+    {
+        //The format runs are saved as start, length and attribute triples.
+        QVector<int> formatRuns;
+        QVector<int> regionMarks;
+        quint64 textHash = 0;
+        int previousState = -1;
+        int state = -1;
+        bool isValid = false;
+    };
+
+    /*!
+     * \brief Set the directory of the cache files. An empty directory disables
+     * the cache.
+     * \param dirPath The cache directory path.
+     */
+    static void setDirectory(const QString &dirPath);
+
+    /*!
+     * \brief Check whether the cache is enabled.
+     * \return If the cache directory is set, return true.
+     */
+    static bool isEnabled();
+
+    /*!
+     * \brief Check whether a file is large enough to be cached.
+     * \param filePath The file path.
+     * \return If the cache is enabled and the file should be cached, return
+     * true.
+     */
+    static bool isCacheable(const QString &filePath);
+
+    /*!
+     * \brief Calculate the hash of the block text, which is stable across the
+     * application runs.
+     * \param text The block text.
+     * \return The text hash.
+     */
+    static quint64 textHash(const QString &text);
+
+    /*!
+     * \brief Load the cache of a file.
+     * \param filePath The file path.
+     * \param definitionHash The hash of the syntax definition.
+     * \return If the cache is found and still matches the file, return true.
+     */
+    bool load(const QString &filePath, const QByteArray &definitionHash);
+
+    /*!
+     * \brief Save the cache of a file.
+     * \param filePath The file path.
+     * \param definitionHash The hash of the syntax definition.
+     * \return If the cache is saved, return true.
+     */
+    bool save(const QString &filePath, const QByteArray &definitionHash) const;
+
+    //The highlighter state table.
+    QVector<QVector<int>> states;
+    QVector<QStringList> captures;
+    QVector<Block> blocks;
+
+private:
+    static QString &directory();
+    static QString cachePath(const QString &filePath);
+};
+
+#endif // KNHIGHLIGHTCACHE_H
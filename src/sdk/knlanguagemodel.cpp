@@ -10,9 +10,100 @@
  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
  * license file for more details.
  */
+#include <QFileInfo>
+
 #include "knlanguagemodel.h"
 
+KNLanguageModel *KNLanguageModel::ins = nullptr;
+
+KNLanguageModel *KNLanguageModel::instance()
+{
+    //Return the instance pointer.
+    return ins;
+}
+
+void KNLanguageModel::initial(QObject *parent)
+{
+    //Check if the singleton instance variable is null. Set the pointer to this
+    //object if this is the first constructed object.
+    if(ins == nullptr)
+    {
+        ins = new KNLanguageModel(parent);
+    }
+}
+
+QString KNLanguageModel::languageOf(const QString &filePath) const
+{
+    return m_extMap.value(QFileInfo(filePath).suffix());
+}
+
+QSharedPointer<const KNSyntaxDefinition> KNLanguageModel::definition(
+        const QString &syntaxName)
+{
+    //Check whether the definition is still used by other highlighters.
+    QSharedPointer<const KNSyntaxDefinition> syntaxDefinition =
+            m_definitions.value(syntaxName).toStrongRef();
+    if(syntaxDefinition)
+    {
+        return syntaxDefinition;
+    }
+    //Load the rules from the binary data, the expressions are compiled when
+    //they are matched for the first time.
+    QSharedPointer<KNSyntaxDefinition> loadedDefinition(new KNSyntaxDefinition());
+    if(!loadedDefinition->fromBinary(m_nameDataMap.value(syntaxName)))
+    {
+        return QSharedPointer<const KNSyntaxDefinition>();
+    }
+    m_definitions.insert(syntaxName, loadedDefinition);
+    return loadedDefinition;
+}
+
 KNLanguageModel::KNLanguageModel(QObject *parent) :
-    KNSyntaxHighlighter(parent)
+    QObject(parent)
+{
+    QHash<QString, int> syntaxPriority;
+    //Load the headers of the definitions compiled at build time.
+    const auto binaries = KNSyntaxDefinition::binaries();
+    for(const auto &data : binaries)
+    {
+        loadBinary(data, syntaxPriority);
+    }
+}
+
+void KNLanguageModel::loadBinary(const QByteArray &data,
+                                 QHash<QString, int> &priorityMap)
 {
+    //Only read the header of the binary definition.
+    QString syntaxName;
+    QStringList extensions;
+    int syntaxPriority;
+    if(!KNSyntaxDefinition::readHeader(data, syntaxName, extensions,
+                                       syntaxPriority))
+    {
+        return;
+    }
+    //Insert the data to data map.
+    m_nameDataMap.insert(syntaxName, data);
+    //Also insert for its priority.
+    priorityMap.insert(syntaxName, syntaxPriority);
+    //Extract the syntax extensions.
+    for(auto ext : extensions)
+    {
+        if(ext.isEmpty())
+        {
+            continue;
+        }
+        int dotPos = ext.indexOf('.');
+        if(dotPos > -1)
+        {
+            //Only save the data after first dot.
+            ext = ext.mid(dotPos + 1);
+        }
+        if(!m_extMap.contains(ext) ||
+                syntaxPriority > priorityMap.value(m_extMap.value(ext)))
+        {
+            //Update the extsion value.
+            m_extMap.insert(ext, syntaxName);
+        }
+    }
 }
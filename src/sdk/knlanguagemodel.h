@@ -13,20 +13,70 @@
 #ifndef KNLANGUAGEMODEL_H
 #define KNLANGUAGEMODEL_H
 
-#include "knsyntaxhighlighter.h"
+#include <QHash>
+#include <QSharedPointer>
+#include <QWeakPointer>
 
-class KNLanguageModel : public KNSyntaxHighlighter
+#include <QObject>
+
+#include "knsyntaxdefinition.h"
+
+/*!
+ * \def knLanguage
+ * A global pointer referring to the unique language model object.
+ */
+#define knLanguage  (KNLanguageModel::instance())
+
+/*!
+ * \brief The KNLanguageModel class is the registry of the syntax definitions.
+ * It only reads the headers of the compiled definitions at startup. A
+ * definition is loaded when its language is used for the first time, and it is
+ * shared by all the highlighters of the language. The definition is released
+ * when the last highlighter using it is destroyed.
+ */
+class KNLanguageModel : public QObject
 {
     Q_OBJECT
 public:
     /*!
-     * \brief Construct a KNLanguageModel object.
-     * \param parent The parent widget.
+     * \brief Get the global instance of the language model.
+     * \return The global language model instance.
      */
-    explicit KNLanguageModel(QObject *parent = nullptr);
+    static KNLanguageModel *instance();
+
+    /*!
+     * \brief Initial the language model, generate the instance with the given
+     * parent object.\n
+     * Only the first time will create a instance.
+     */
+    static void initial(QObject *parent = nullptr);
+
+    /*!
+     * \brief Find the language of a file based on its suffix.
+     * \param filePath The file path.
+     * \return The language name. If no language matches, return an empty
+     * string.
+     */
+    QString languageOf(const QString &filePath) const;
+
+    /*!
+     * \brief Get the shared definition of a language.
+     * \param syntaxName The language name.
+     * \return The compiled definition. If the language is not found, return a
+     * null pointer.
+     */
+    QSharedPointer<const KNSyntaxDefinition> definition(
+            const QString &syntaxName);
 
 signals:
 
+private:
+    explicit KNLanguageModel(QObject *parent = nullptr);
+    static KNLanguageModel *ins;
+    void loadBinary(const QByteArray &data, QHash<QString, int> &priorityMap);
+    QHash<QString, QString> m_extMap;
+    QHash<QString, QByteArray> m_nameDataMap;
+    QHash<QString, QWeakPointer<const KNSyntaxDefinition>> m_definitions;
 };
 
 #endif // KNLANGUAGEMODEL_H
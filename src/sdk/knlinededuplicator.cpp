@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) Kreogist Dev Team
+ *
+ * You can redistribute this software and/or modify it under the
+ * terms of the HARERU Software License; either version 1 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * license file for more details.
+ */
+#include <QFuture>
+#include <QHash>
+#include <QThread>
+#include <QVector>
+#include <QtConcurrent/QtConcurrent>
+
+#include "knlinededuplicator.h"
+
+//The minimum lines processed by one task.
+#define DEDUPLICATE_TASK_SIZE   (16384)
+
+static inline quint64 lineHash(const QChar *line, int length)
+{
+    //FNV-1a of the UTF-16 code units.
+    quint64 hash = 14695981039346656037ULL;
+    for(int i=0; i<length; ++i)
+    {
+        hash = (hash ^ line[i].unicode()) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+static inline bool isSameLine(const QChar *left, int leftLength,
+                              const QChar *right, int rightLength)
+{
+    if(leftLength != rightLength)
+    {
+        return false;
+    }
+    for(int i=0; i<leftLength; ++i)
+    {
+        if(left[i] != right[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+QString KNLineDeduplicator::deduplicate(const QString &text, int mode)
+{
+    //Split the lines.
+    QVector<int> starts, lengths;
+    for(int start = 0; ; )
+    {
+        int end = text.indexOf('\n', start);
+        starts.append(start);
+        if(end == -1)
+        {
+            lengths.append(text.length() - start);
+            break;
+        }
+        lengths.append(end - start);
+        start = end + 1;
+    }
+    const QChar *data = text.constData();
+    int count = starts.size(),
+            tasks = qBound(1, count / DEDUPLICATE_TASK_SIZE,
+                           QThread::idealThreadCount());
+    //Hash the lines in parallel.
+    //The tasks write the different items through the data pointers.
+    QVector<quint64> hashes(count);
+    quint64 *hashData = hashes.data();
+    QVector<QFuture<void>> futures;
+    for(int i=0; i<tasks; ++i)
+    {
+        int begin = static_cast<int>(static_cast<qint64>(count) * i / tasks),
+                end = static_cast<int>(static_cast<qint64>(count) * (i + 1) / tasks);
+        futures.append(QtConcurrent::run([&, begin, end]
+        {
+            for(int j=begin; j<end; ++j)
+            {
+                hashData[j] = lineHash(data + starts.at(j), lengths.at(j));
+            }
+        }));
+    }
+    for(int i=0; i<futures.size(); ++i)
+    {
+        futures[i].waitForFinished();
+    }
+    //Partition the lines by the hash, the lines in a partition are in order.
+    QVector<QVector<int>> partitions(tasks);
+    for(int i=0; i<count; ++i)
+    {
+        partitions[static_cast<int>((hashes.at(i) >> 32) % tasks)].append(i);
+    }
+    //Find the first line of each group. The groups with the same hash are
+    //linked from the first group by the next array.
+    QVector<int> firsts(count), lasts(count), occurrences(count, 0),
+            nextGroups(count, -1);
+    int *firstData = firsts.data(), *lastData = lasts.data(),
+            *occurrenceData = occurrences.data(),
+            *nextGroupData = nextGroups.data();
+    futures.clear();
+    for(int i=0; i<tasks; ++i)
+    {
+        futures.append(QtConcurrent::run([&, i]
+        {
+            const QVector<int> &lines = partitions.at(i);
+            QHash<quint64, int> groups;
+            groups.reserve(lines.size());
+            for(int line : lines)
+            {
+                auto iter = groups.find(hashes.at(line));
+                if(iter == groups.end())
+                {
+                    groups.insert(hashes.at(line), line);
+                    firstData[line] = line;
+                    continue;
+                }
+                //Compare the lines to avoid the hash collision.
+                int group = iter.value(), lastGroup = group;
+                while(group != -1 &&
+                      !isSameLine(data + starts.at(group), lengths.at(group),
+                                  data + starts.at(line), lengths.at(line)))
+                {
+                    lastGroup = group;
+                    group = nextGroupData[group];
+                }
+                if(group == -1)
+                {
+                    nextGroupData[lastGroup] = line;
+                    group = line;
+                }
+                firstData[line] = group;
+            }
+            //Count the lines of the groups.
+            for(int line : lines)
+            {
+                int group = firstData[line];
+                ++occurrenceData[group];
+                lastData[group] = line;
+            }
+        }));
+    }
+    for(int i=0; i<futures.size(); ++i)
+    {
+        futures[i].waitForFinished();
+    }
+    //Join the kept lines in order.
+    QString result;
+    result.reserve(text.length());
+    bool firstLine = true;
+    for(int i=0; i<count; ++i)
+    {
+        int group = firsts.at(i);
+        if(mode == KeepLast ? lasts.at(group) != i : group != i)
+        {
+            continue;
+        }
+        if(!firstLine)
+        {
+            result.append('\n');
+        }
+        firstLine = false;
+        if(mode == CountOccurrences)
+        {
+            result.append(QString::number(occurrences.at(group)));
+            result.append('\t');
+        }
+        result.append(data + starts.at(i), lengths.at(i));
+    }
+    return result;
+}
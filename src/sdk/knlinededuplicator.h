@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) Kreogist Dev Team
+ *
+ * You can redistribute this software and/or modify it under the
+ * terms of the HARERU Software License; either version 1 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * license file for more details.
+ */
+#ifndef KNLINEDEDUPLICATOR_H
+#define KNLINEDEDUPLICATOR_H
+
+#include <QString>
+
+/*!
+ * \brief The KNLineDeduplicator class removes the duplicated lines of a text.
+ * The lines are hashed to 64-bit values in parallel, then they are partitioned
+ * by the hash values and each partition is grouped by an independent task. The
+ * lines with the same hash value are compared to confirm the duplication, so
+ * a hash collision never removes a different line.
+ */
+class KNLineDeduplicator
+{
+public:
+    enum DeduplicateMode
+    {
+        KeepFirst,
+        KeepLast,
+        CountOccurrences
+    };
+
+    /*!
+     * \brief Remove the duplicated lines of a text.\n
+     * KeepFirst keeps the first occurrence of each line, KeepLast keeps the
+     * last occurrence, and CountOccurrences keeps the first occurrence with
+     * the number of the occurrences and a tab before it.
+     * \param text The lines separated by line feeds.
+     * \param mode The deduplicate mode.
+     * \return The result lines separated by line feeds.
+     */
+    static QString deduplicate(const QString &text, int mode);
+};
+
+#endif // KNLINEDEDUPLICATOR_H
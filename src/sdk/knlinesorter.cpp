@@ -0,0 +1,430 @@
+/*
+ * Copyright (C) Kreogist Dev Team
+ *
+ * You can redistribute this software and/or modify it under the
+ * terms of the HARERU Software License; either version 1 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * license file for more details.
+ */
+#include <algorithm>
+#include <cmath>
+
+#include <QFuture>
+#include <QThread>
+#include <QVector>
+#include <QtConcurrent/QtConcurrent>
+
+#include "knlinesorter.h"
+
+//The minimum lines sorted by one task.
+#define SORT_TASK_SIZE  (16384)
+
+struct SortLine
+{
+    int start;
+    int length;
+    int keyStart;
+    int keyLength;
+};
+
+struct SortNumber
+{
+    //The value of the decimal, or the digit range of the integer.
+    double value;
+    int digitStart;
+    int digitLength;
+    bool isNumber;
+    bool negative;
+};
+
+static inline bool isDigit(QChar c)
+{
+    return c.unicode() >= '0' && c.unicode() <= '9';
+}
+
+static inline int compareText(const QChar *left, int leftLength,
+                              const QChar *right, int rightLength)
+{
+    int length = qMin(leftLength, rightLength);
+    for(int i=0; i<length; ++i)
+    {
+        if(left[i] != right[i])
+        {
+            return left[i].unicode() < right[i].unicode() ? -1 : 1;
+        }
+    }
+    return leftLength == rightLength ? 0 : (leftLength < rightLength ? -1 : 1);
+}
+
+static int compareNatural(const QChar *left, int leftLength,
+                          const QChar *right, int rightLength)
+{
+    int i = 0, j = 0;
+    while(i < leftLength && j < rightLength)
+    {
+        if(isDigit(left[i]) && isDigit(right[j]))
+        {
+            //Skip the leading zeros, the number with more digits is larger.
+            while(i < leftLength - 1 && left[i] == '0' && isDigit(left[i + 1]))
+            {
+                ++i;
+            }
+            while(j < rightLength - 1 && right[j] == '0' && isDigit(right[j + 1]))
+            {
+                ++j;
+            }
+            int leftEnd = i, rightEnd = j;
+            while(leftEnd < leftLength && isDigit(left[leftEnd]))
+            {
+                ++leftEnd;
+            }
+            while(rightEnd < rightLength && isDigit(right[rightEnd]))
+            {
+                ++rightEnd;
+            }
+            int leftDigits = leftEnd - i, rightDigits = rightEnd - j;
+            if(leftDigits != rightDigits)
+            {
+                return leftDigits < rightDigits ? -1 : 1;
+            }
+            int result = compareText(left + i, leftDigits, right + j, rightDigits);
+            if(result)
+            {
+                return result;
+            }
+            i = leftEnd;
+            j = rightEnd;
+            continue;
+        }
+        if(left[i] != right[j])
+        {
+            return left[i].unicode() < right[j].unicode() ? -1 : 1;
+        }
+        ++i;
+        ++j;
+    }
+    //The shorter remaining text is smaller.
+    int leftRest = leftLength - i, rightRest = rightLength - j;
+    return leftRest == rightRest ? 0 : (leftRest < rightRest ? -1 : 1);
+}
+
+static SortNumber integerKey(const QChar *line, int length)
+{
+    SortNumber key = {0.0, 0, 0, false, false};
+    int pos = (length > 0 && line[0] == '-') ? 1 : 0, digitEnd = pos;
+    while(digitEnd < length && isDigit(line[digitEnd]))
+    {
+        ++digitEnd;
+    }
+    if(digitEnd == pos)
+    {
+        return key;
+    }
+    //Skip the leading zeros.
+    key.negative = (pos == 1);
+    while(pos < digitEnd - 1 && line[pos] == '0')
+    {
+        ++pos;
+    }
+    key.isNumber = true;
+    key.digitStart = pos;
+    key.digitLength = digitEnd - pos;
+    //Negative zero is zero.
+    if(key.digitLength == 1 && line[pos] == '0')
+    {
+        key.negative = false;
+    }
+    return key;
+}
+
+static SortNumber decimalKey(const QChar *line, int length, char splitter)
+{
+    SortNumber key = {0.0, 0, 0, false, false};
+    int pos = (length > 0 && line[0] == '-') ? 1 : 0, fractions = 0;
+    bool hasDigit = false, hasSplitter = false;
+    for(; pos < length; ++pos)
+    {
+        if(line[pos] == splitter && !hasSplitter)
+        {
+            hasSplitter = true;
+            continue;
+        }
+        if(!isDigit(line[pos]))
+        {
+            break;
+        }
+        key.value = key.value * 10.0 + (line[pos].unicode() - '0');
+        fractions += hasSplitter;
+        hasDigit = true;
+    }
+    if(hasDigit)
+    {
+        key.isNumber = true;
+        key.value /= std::pow(10.0, fractions);
+        if(length > 0 && line[0] == '-')
+        {
+            key.value = -key.value;
+        }
+    }
+    else
+    {
+        key.value = 0.0;
+    }
+    return key;
+}
+
+class SortContext
+{
+public:
+    SortContext(const QString &text, int mode,
+                const KNLineSorter::KeyFunction &keyOf) :
+        m_mode(mode)
+    {
+        //Split the lines, the entire line is the key by default.
+        for(int start = 0; ; )
+        {
+            int end = text.indexOf('\n', start);
+            if(end == -1)
+            {
+                end = text.length();
+            }
+            SortLine line = {start, end - start, start, end - start};
+            if(keyOf)
+            {
+                int keyStart = 0, keyLength = line.length;
+                keyOf(QStringView(text.constData() + start, line.length),
+                      keyStart, keyLength);
+                line.keyStart = start + keyStart;
+                line.keyLength = keyLength;
+            }
+            m_lines.append(line);
+            if(end == text.length())
+            {
+                break;
+            }
+            start = end + 1;
+        }
+        //The case folding keeps the positions.
+        m_keyText = (mode == KNLineSorter::LexicalIgnoreCase) ?
+                    text.toCaseFolded() : text;
+        m_text = m_keyText.constData();
+        //Parse the numbers once.
+        if(mode == KNLineSorter::Integer || mode == KNLineSorter::DecimalComma ||
+                mode == KNLineSorter::DecimalDot)
+        {
+            m_numbers.resize(m_lines.size());
+            for(int i=0; i<m_lines.size(); ++i)
+            {
+                const QChar *line = m_text + m_lines.at(i).keyStart;
+                int length = m_lines.at(i).keyLength;
+                switch(mode)
+                {
+                case KNLineSorter::Integer:
+                    m_numbers[i] = integerKey(line, length);
+                    break;
+                case KNLineSorter::DecimalComma:
+                    m_numbers[i] = decimalKey(line, length, ',');
+                    break;
+                default:
+                    m_numbers[i] = decimalKey(line, length, '.');
+                    break;
+                }
+            }
+        }
+    }
+
+    int lineCount() const
+    {
+        return m_lines.size();
+    }
+
+    const SortLine &line(int index) const
+    {
+        return m_lines.at(index);
+    }
+
+    bool isSame(int left, int right) const
+    {
+        const SortLine &l = m_lines.at(left), &r = m_lines.at(right);
+        return !compareText(m_text + l.start, l.length,
+                            m_text + r.start, r.length);
+    }
+
+    int compare(int left, int right, bool tieBreak) const
+    {
+        //The lines with the same key are ordered by the text for removing the
+        //duplicated lines.
+        int result = compareKey(left, right);
+        if(result || !tieBreak)
+        {
+            return result;
+        }
+        const SortLine &l = m_lines.at(left), &r = m_lines.at(right);
+        return compareText(m_text + l.start, l.length,
+                           m_text + r.start, r.length);
+    }
+
+private:
+    int compareKey(int left, int right) const
+    {
+        const SortLine &l = m_lines.at(left), &r = m_lines.at(right);
+        switch(m_mode)
+        {
+        case KNLineSorter::Natural:
+            return compareNatural(m_text + l.keyStart, l.keyLength,
+                                  m_text + r.keyStart, r.keyLength);
+        case KNLineSorter::Integer:
+        case KNLineSorter::DecimalComma:
+        case KNLineSorter::DecimalDot:
+        {
+            //The numbers are placed before the other lines.
+            const SortNumber &ln = m_numbers.at(left), &rn = m_numbers.at(right);
+            if(ln.isNumber != rn.isNumber)
+            {
+                return ln.isNumber ? -1 : 1;
+            }
+            if(!ln.isNumber)
+            {
+                break;
+            }
+            if(m_mode != KNLineSorter::Integer)
+            {
+                return ln.value == rn.value ? 0 : (ln.value < rn.value ? -1 : 1);
+            }
+            if(ln.negative != rn.negative)
+            {
+                return ln.negative ? -1 : 1;
+            }
+            int result = (ln.digitLength != rn.digitLength) ?
+                        (ln.digitLength < rn.digitLength ? -1 : 1) :
+                        compareText(m_text + l.keyStart + ln.digitStart,
+                                    ln.digitLength,
+                                    m_text + r.keyStart + rn.digitStart,
+                                    rn.digitLength);
+            return ln.negative ? -result : result;
+        }
+        default:
+            break;
+        }
+        return compareText(m_text + l.keyStart, l.keyLength,
+                           m_text + r.keyStart, r.keyLength);
+    }
+
+    QString m_keyText;
+    QVector<SortLine> m_lines;
+    QVector<SortNumber> m_numbers;
+    const QChar *m_text;
+    int m_mode;
+};
+
+template<typename LessThan>
+static void parallelSort(QVector<int> &indexes, LessThan lessThan)
+{
+    int count = indexes.size(),
+            parts = qMin(QThread::idealThreadCount(), count / SORT_TASK_SIZE);
+    if(parts < 2)
+    {
+        std::stable_sort(indexes.begin(), indexes.end(), lessThan);
+        return;
+    }
+    //Sort the parts in parallel.
+    QVector<int> bounds;
+    for(int i=0; i<=parts; ++i)
+    {
+        bounds.append(static_cast<int>(static_cast<qint64>(count) * i / parts));
+    }
+    int *from = indexes.data();
+    QVector<QFuture<void>> tasks;
+    for(int i=0; i<parts; ++i)
+    {
+        int begin = bounds.at(i), end = bounds.at(i + 1);
+        tasks.append(QtConcurrent::run([=]
+        {
+            std::stable_sort(from + begin, from + end, lessThan);
+        }));
+    }
+    for(int i=0; i<tasks.size(); ++i)
+    {
+        tasks[i].waitForFinished();
+    }
+    //Merge the neighbour parts in parallel until only one part is left. The
+    //merge takes the left part first for the same keys, so it is stable.
+    QVector<int> buffer(count);
+    int *to = buffer.data();
+    while(bounds.size() > 2)
+    {
+        QVector<int> mergedBounds;
+        tasks.clear();
+        for(int i=0; i<bounds.size() - 1; i+=2)
+        {
+            int begin = bounds.at(i), middle = bounds.at(i + 1),
+                    end = (i + 2 < bounds.size()) ? bounds.at(i + 2) : middle;
+            mergedBounds.append(begin);
+            tasks.append(QtConcurrent::run([=]
+            {
+                std::merge(from + begin, from + middle, from + middle,
+                           from + end, to + begin, lessThan);
+            }));
+        }
+        mergedBounds.append(count);
+        for(int i=0; i<tasks.size(); ++i)
+        {
+            tasks[i].waitForFinished();
+        }
+        std::swap(from, to);
+        bounds = mergedBounds;
+    }
+    if(from != indexes.data())
+    {
+        indexes = buffer;
+    }
+}
+
+QString KNLineSorter::sort(const QString &text, int mode, int options,
+                           const KeyFunction &keyOf)
+{
+    SortContext context(text, mode, keyOf);
+    QVector<int> indexes(context.lineCount());
+    for(int i=0; i<indexes.size(); ++i)
+    {
+        indexes[i] = i;
+    }
+    //The descending order swaps the keys, the same lines keep their order.
+    bool unique = options & Unique;
+    if(options & Descending)
+    {
+        parallelSort(indexes, [&context, unique](int left, int right)
+        {
+            return context.compare(right, left, unique) < 0;
+        });
+    }
+    else
+    {
+        parallelSort(indexes, [&context, unique](int left, int right)
+        {
+            return context.compare(left, right, unique) < 0;
+        });
+    }
+    //Join the lines, the same line after the previous one is skipped.
+    QString result;
+    result.reserve(text.length());
+    for(int i=0; i<indexes.size(); ++i)
+    {
+        if(unique && i > 0 &&
+                context.isSame(indexes.at(i - 1), indexes.at(i)))
+        {
+            continue;
+        }
+        if(i > 0)
+        {
+            result.append('\n');
+        }
+        const SortLine &line = context.line(indexes.at(i));
+        result.append(text.constData() + line.start, line.length);
+    }
+    return result;
+}
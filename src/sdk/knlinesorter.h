@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) Kreogist Dev Team
+ *
+ * You can redistribute this software and/or modify it under the
+ * terms of the HARERU Software License; either version 1 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * license file for more details.
+ */
+#ifndef KNLINESORTER_H
+#define KNLINESORTER_H
+
+#include <functional>
+
+#include <QString>
+#include <QStringView>
+
+/*!
+ * \brief The KNLineSorter class sorts the lines of a text. The sort key of
+ * each line is prepared once before sorting, then the line indexes are sorted
+ * with a parallel merge sort, no string is created during the comparisons.\n
+ * The sort is stable, the lines with the same key keep their original order in
+ * both directions.
+ */
+class KNLineSorter
+{
+public:
+    enum SortMode
+    {
+        Lexical,
+        LexicalIgnoreCase,
+        Natural,
+        Integer,
+        DecimalComma,
+        DecimalDot
+    };
+
+    enum SortOption
+    {
+        Descending  = 1 << 0,
+        Unique      = 1 << 1
+    };
+
+    typedef std::function<void (QStringView line, int &keyStart,
+                                int &keyLength)> KeyFunction;
+
+    /*!
+     * \brief Sort the lines of a text.\n
+     * The lexical mode compares the UTF-16 code units, the ignore case mode
+     * compares the case folded text, and the natural mode compares the digit
+     * sequences as numbers. The numeric modes sort the lines start with a
+     * number by the value, and put them before the other lines, which are
+     * sorted lexically.
+     * \param text The lines separated by line feeds.
+     * \param mode The sort mode.
+     * \param options The sort options.
+     * \param keyOf The function which finds the sort key range in a line. By
+     * default the entire line is the key. The lines with the same key keep
+     * their order, unless the duplications are removed.
+     * \return The sorted lines separated by line feeds.
+     */
+    static QString sort(const QString &text, int mode, int options = 0,
+                        const KeyFunction &keyOf = KeyFunction());
+};
+
+#endif // KNLINESORTER_H
@@ -0,0 +1,243 @@
+/*
+ * Copyright (C) Kreogist Dev Team
+ *
+ * You can redistribute this software and/or modify it under the
+ * terms of the HARERU Software License; either version 1 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * license file for more details.
+ */
+#include <QAction>
+#include <QApplication>
+#include <QInputDialog>
+#include <QKeyEvent>
+#include <QTextDocument>
+
+#include "kntexteditor.h"
+#include "knuimanager.h"
+#include "knglobal.h"
+
+#include "knmacromenu.h"
+
+#define MAX_RUN_TIMES   (1000000)
+
+KNMacroMenu::KNMacroMenu(QWidget *parent) : QMenu(parent),
+    m_editor(nullptr),
+    m_isRecording(false)
+{
+    //Construct actions.
+    for(int i=0; i<MacroMenuItemCount; ++i)
+    {
+        m_menuItems[i] = new QAction(parentWidget());
+        addAction(m_menuItems[i]);
+    }
+    insertSeparator(m_menuItems[Playback]);
+    //Set the shortcuts.
+    m_menuItems[StartRecording]->setShortcut(QKeySequence(KNG::CTRL | KNG::SHIFT | Qt::Key_R));
+    m_menuItems[Playback]->setShortcut(QKeySequence(KNG::CTRL | KNG::SHIFT | Qt::Key_P));
+    //Link the actions.
+    connect(m_menuItems[StartRecording], &QAction::triggered,
+            this, &KNMacroMenu::onStartRecording);
+    connect(m_menuItems[StopRecording], &QAction::triggered,
+            this, &KNMacroMenu::onStopRecording);
+    connect(m_menuItems[Playback], &QAction::triggered, [=]{ play(1); });
+    connect(m_menuItems[RunMultiple], &QAction::triggered,
+            this, &KNMacroMenu::onRunMultiple);
+    connect(m_menuItems[RunToEnd], &QAction::triggered, [=]{ play(-1); });
+    updateItemsEnabled();
+    //Link the translator.
+    knUi->addTranslate(this, &KNMacroMenu::retranslate);
+}
+
+void KNMacroMenu::setEditor(KNTextEditor *editor)
+{
+    //Record the keys of the new editor.
+    disconnect(m_keyConnection);
+    m_editor = editor;
+    if(m_editor)
+    {
+        m_keyConnection = connect(m_editor, &KNTextEditor::keyPressed,
+                                  this, &KNMacroMenu::onKeyPressed);
+    }
+}
+
+void KNMacroMenu::addRecordAction(QAction *action)
+{
+    //The action is saved as its index in the list.
+    int actionId = m_recordActions.size();
+    m_recordActions.append(action);
+    connect(action, &QAction::triggered, [=]
+    {
+        if(m_isRecording)
+        {
+            m_recordCommands.append({QString(), ActionCommand, actionId, 0});
+        }
+    });
+}
+
+void KNMacroMenu::retranslate()
+{
+    setTitle(tr("&Macro"));
+    m_menuItems[StartRecording]->setText(tr("Start Recording"));
+    m_menuItems[StopRecording]->setText(tr("Stop Recording"));
+    m_menuItems[Playback]->setText(tr("Playback"));
+    m_menuItems[RunMultiple]->setText(tr("Run a Macro Multiple Times..."));
+    m_menuItems[RunToEnd]->setText(tr("Run a Macro Until the End of File"));
+}
+
+void KNMacroMenu::onStartRecording()
+{
+    m_recordCommands.clear();
+    m_isRecording = true;
+    updateItemsEnabled();
+}
+
+void KNMacroMenu::onStopRecording()
+{
+    //The new macro replaces the previous one.
+    m_isRecording = false;
+    m_commands = m_recordCommands;
+    m_recordCommands.clear();
+    updateItemsEnabled();
+}
+
+void KNMacroMenu::onRunMultiple()
+{
+    bool ok = false;
+    int times = QInputDialog::getInt(parentWidget(), tr("Run a Macro Multiple Times"),
+                                     tr("Run times:"), 1, 1, MAX_RUN_TIMES,
+                                     1, &ok);
+    if(ok)
+    {
+        play(times);
+    }
+}
+
+void KNMacroMenu::onKeyPressed(int key, int modifiers, const QString &text)
+{
+    if(!m_isRecording)
+    {
+        return;
+    }
+    //The typed characters are merged into one text command.
+    Qt::KeyboardModifiers keyModifiers(QFlag(modifiers));
+    bool isTyping = !text.isEmpty() && text.at(0).isPrint() &&
+            !(keyModifiers & (Qt::ControlModifier | Qt::AltModifier |
+                              Qt::MetaModifier));
+    if(isTyping)
+    {
+        if(!m_recordCommands.isEmpty() &&
+                m_recordCommands.last().type == TextCommand)
+        {
+            m_recordCommands.last().text.append(text);
+            return;
+        }
+        m_recordCommands.append({text, TextCommand, 0, 0});
+        return;
+    }
+    m_recordCommands.append({text, KeyCommand, key, modifiers});
+}
+
+void KNMacroMenu::play(int times)
+{
+    if(!m_editor || m_isRecording || m_commands.isEmpty())
+    {
+        return;
+    }
+    //Suspend the painting during the playback.
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    m_editor->setUpdatesEnabled(false);
+    //All the runs are in one edit block, so it is one undo step and the
+    //document is laid out once.
+    QTextDocument *document = m_editor->document();
+    int undoSteps = document->availableUndoSteps();
+    QTextCursor group(document);
+    group.beginEditBlock();
+    //When running until the end, stop when the cursor stops moving forward.
+    int remainLines = document->blockCount() + 1;
+    for(int i=0; times < 0 || i < times; ++i)
+    {
+        for(const Command &command : m_commands)
+        {
+            switch(command.type == KeyCommand ? command.id : 0)
+            {
+            case Qt::Key_Up:
+            case Qt::Key_Down:
+            case Qt::Key_PageUp:
+            case Qt::Key_PageDown:
+            case Qt::Key_Home:
+            case Qt::Key_End:
+                //Moving between the lines needs the layout of the edited
+                //lines, close the block before the key.
+                group.endEditBlock();
+                playCommand(command);
+                if(document->availableUndoSteps() > undoSteps)
+                {
+                    group.joinPreviousEditBlock();
+                }
+                else
+                {
+                    group.beginEditBlock();
+                }
+                break;
+            default:
+                playCommand(command);
+                break;
+            }
+        }
+        if(times < 0)
+        {
+            QTextCursor cursor = m_editor->textCursor();
+            int lines = document->blockCount() - cursor.blockNumber();
+            if(cursor.atEnd() || lines >= remainLines)
+            {
+                break;
+            }
+            remainLines = lines;
+        }
+    }
+    group.endEditBlock();
+    //Resume the painting.
+    m_editor->setUpdatesEnabled(true);
+    m_editor->ensureCursorVisible();
+    QApplication::restoreOverrideCursor();
+}
+
+void KNMacroMenu::playCommand(const Command &command)
+{
+    switch(command.type)
+    {
+    case ActionCommand:
+        m_recordActions.at(command.id)->trigger();
+        break;
+    case KeyCommand:
+    {
+        QKeyEvent event(QEvent::KeyPress, command.id,
+                        Qt::KeyboardModifiers(QFlag(command.modifiers)), command.text);
+        QCoreApplication::sendEvent(m_editor, &event);
+        break;
+    }
+    case TextCommand:
+        //Type the characters one by one, the editor may complete the pairs.
+        for(const QChar &c : command.text)
+        {
+            QKeyEvent event(QEvent::KeyPress, c.toUpper().unicode(),
+                            Qt::NoModifier, QString(c));
+            QCoreApplication::sendEvent(m_editor, &event);
+        }
+        break;
+    }
+}
+
+void KNMacroMenu::updateItemsEnabled()
+{
+    bool hasMacro = !m_isRecording && !m_commands.isEmpty();
+    m_menuItems[StartRecording]->setEnabled(!m_isRecording);
+    m_menuItems[StopRecording]->setEnabled(m_isRecording);
+    m_menuItems[Playback]->setEnabled(hasMacro);
+    m_menuItems[RunMultiple]->setEnabled(hasMacro);
+    m_menuItems[RunToEnd]->setEnabled(hasMacro);
+}
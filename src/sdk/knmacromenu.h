@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) Kreogist Dev Team
+ *
+ * You can redistribute this software and/or modify it under the
+ * terms of the HARERU Software License; either version 1 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * license file for more details.
+ */
+#ifndef KNMACROMENU_H
+#define KNMACROMENU_H
+
+#include <QMenu>
+
+class KNTextEditor;
+/*!
+ * \brief The KNMacroMenu class provides the macro recording and playback. The
+ * registered menu actions and the keys pressed in the editor are recorded as a
+ * compact command list, the continuous typed characters are saved as one text
+ * command.\n
+ * The playback does not repaint the editor, and all the runs are one undo
+ * step. The edits are batched in one edit block, the edited lines are only
+ * laid out before a key moves the cursor between the lines.
+ */
+class KNMacroMenu : public QMenu
+{
+    Q_OBJECT
+public:
+    /*!
+     * \brief Construct a KNMacroMenu widget.
+     * \param parent The parent widget.
+     */
+    explicit KNMacroMenu(QWidget *parent = nullptr);
+
+    /*!
+     * \brief Set the text editor which records and plays the macro.
+     * \param editor The text editor pointer.
+     */
+    void setEditor(KNTextEditor *editor);
+
+    /*!
+     * \brief Add an action which could be recorded in the macro.
+     * \param action The action pointer, it should work on the current editor.
+     */
+    void addRecordAction(QAction *action);
+
+private slots:
+    void retranslate();
+    void onStartRecording();
+    void onStopRecording();
+    void onRunMultiple();
+    void onKeyPressed(int key, int modifiers, const QString &text);
+
+private:
+    enum MacroMenuItems
+    {
+        StartRecording,
+        StopRecording,
+        Playback,
+        RunMultiple,
+        RunToEnd,
+        MacroMenuItemCount
+    };
+
+    enum CommandType
+    {
+        ActionCommand,
+        KeyCommand,
+        TextCommand
+    };
+
+    struct Command
+    {
+        QString text;
+        int type;
+        int id;
+        int modifiers;
+    };
+
+    void play(int times);
+    void playCommand(const Command &command);
+    void updateItemsEnabled();
+    QVector<Command> m_commands, m_recordCommands;
+    QVector<QAction *> m_recordActions;
+    QMetaObject::Connection m_keyConnection;
+    QAction *m_menuItems[MacroMenuItemCount];
+    KNTextEditor *m_editor;
+    bool m_isRecording;
+};
+
+#endif // KNMACROMENU_H
@@ -71,6 +71,7 @@ void KNMainWindow::initalize()
     menuBar()->addMenu(m_fileManager->viewMenu());
     menuBar()->addMenu(m_fileManager->codecMenu());
     menuBar()->addMenu(m_fileManager->toolMenu());
+    menuBar()->addMenu(m_fileManager->macroMenu());
     menuBar()->addMenu(new KNRunMenu(this));
     menuBar()->addMenu(m_fileManager->windowsMenu());
     menuBar()->addMenu(new KNHelpMenu(this));
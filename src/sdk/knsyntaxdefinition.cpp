@@ -0,0 +1,1131 @@
+/*
+ * Copyright (C) Kreogist Dev Team
+ *
+ * You can redistribute this software and/or modify it under the
+ * terms of the HARERU Software License; either version 1 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * license file for more details.
+ */
+#include <algorithm>
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QFile>
+#include <QXmlStreamReader>
+
+#include "knsyntaxdefinition.h"
+
+//The default word deliminators of Kate.
+#define DEFAULT_DELIMINATORS    ("\t !%&()*+,-./:;<=>?[\\]^{|}~")
+//The binary format header.
+#define BINARY_MAGIC            (0x4B4E5344)
+#define BINARY_VERSION          (3)
+//The maximum displacement tried for a bucket of the keyword table.
+#define MAX_DISPLACEMENT        (1 << 20)
+//The maximum times the keyword table is enlarged when a bucket is not placed.
+#define MAX_TABLE_GROWS         (8)
+
+struct DefaultStyle
+{
+    const char *name;
+    QRgb foreground;
+    QRgb background;
+    bool bold;
+    bool underline;
+};
+
+//The colors of the default styles, based on the Kate default theme.
+static const DefaultStyle defaultStyles[] =
+{
+    {"dsKeyword", 0, 0, true, false},
+    {"dsControlFlow", 0, 0, true, false},
+    {"dsFunction", 0xFF644A9B, 0, false, false},
+    {"dsVariable", 0xFF0057AE, 0, false, false},
+    {"dsBuiltIn", 0xFF644A9B, 0, true, false},
+    {"dsExtension", 0xFF0095FF, 0, true, false},
+    {"dsPreprocessor", 0xFF006E28, 0, false, false},
+    {"dsAttribute", 0xFF0057AE, 0, false, false},
+    {"dsChar", 0xFF924C9D, 0, false, false},
+    {"dsSpecialChar", 0xFF3DAEE9, 0, false, false},
+    {"dsString", 0xFFBF0303, 0, false, false},
+    {"dsVerbatimString", 0xFFBF0303, 0, false, false},
+    {"dsSpecialString", 0xFFFF5500, 0, false, false},
+    {"dsImport", 0xFFFF5500, 0, false, false},
+    {"dsDataType", 0xFF0057AE, 0, false, false},
+    {"dsDecVal", 0xFFB08000, 0, false, false},
+    {"dsBaseN", 0xFFB08000, 0, false, false},
+    {"dsFloat", 0xFFB08000, 0, false, false},
+    {"dsConstant", 0, 0, true, false},
+    {"dsComment", 0xFF898887, 0, false, false},
+    {"dsDocumentation", 0xFF607880, 0, false, false},
+    {"dsAnnotation", 0xFFCA60CA, 0, false, false},
+    {"dsCommentVar", 0xFF0095FF, 0, false, false},
+    {"dsRegionMarker", 0xFF0057AE, 0xFFE0E9F8, false, false},
+    {"dsInformation", 0xFFB08000, 0, false, false},
+    {"dsWarning", 0xFFBF0303, 0, false, false},
+    {"dsAlert", 0xFFBF0303, 0xFFF7E6E6, true, false},
+    {"dsOthers", 0xFF006E28, 0, false, false},
+    {"dsError", 0xFFBF0303, 0, false, true}
+};
+
+static inline QString attributeOf(const QXmlStreamAttributes &attributes,
+                                  const char *name)
+{
+    return attributes.value(QLatin1String(name)).toString();
+}
+
+static inline bool isTrue(const QString &value)
+{
+    return value == "1" || value.compare("true", Qt::CaseInsensitive) == 0;
+}
+
+static inline ushort foldChar(QChar c, bool insensitive)
+{
+    //Only the ASCII letters need the fast path, most keywords are ASCII.
+    ushort code = c.unicode();
+    if(!insensitive)
+    {
+        return code;
+    }
+    if(code < 128)
+    {
+        return (code >= 'A' && code <= 'Z') ? code + ('a' - 'A') : code;
+    }
+    return c.toLower().unicode();
+}
+
+static inline quint64 keywordHash(const QChar *word, int length,
+                                  bool insensitive)
+{
+    //FNV-1a of the folded characters.
+    quint64 hash = 14695981039346656037ULL;
+    for(int i=0; i<length; ++i)
+    {
+        hash = (hash ^ foldChar(word[i], insensitive)) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+static inline int keywordBucket(quint64 hash, int size)
+{
+    return static_cast<int>((hash >> 32) % static_cast<quint64>(size));
+}
+
+static inline int keywordSlot(quint64 hash, quint32 displacement, int size)
+{
+    //Mix the hash with the displacement by the MurmurHash3 finalizer.
+    hash ^= displacement * 0x9E3779B97F4A7C15ULL;
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDULL;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ULL;
+    hash ^= hash >> 33;
+    return static_cast<int>(hash % static_cast<quint64>(size));
+}
+
+/*!
+ * \brief The KNSyntaxCompiler class reads the Kate syntax files of a language
+ * and the languages it includes, then compiles them into a KNSyntaxDefinition.
+ */
+class KNSyntaxCompiler
+{
+public:
+    KNSyntaxCompiler(KNSyntaxDefinition *definition,
+                     const QHash<QString, QString> &namePathMap) :
+        m_definition(definition),
+        m_namePathMap(namePathMap)
+    {
+    }
+
+    bool compile(const QString &syntaxName);
+
+private:
+    struct RawRule
+    {
+        KNSyntaxDefinition::Rule rule;
+        QString attribute;
+        QString context;
+        QString list;
+        QString include;
+        bool includeAttrib = false;
+    };
+
+    struct RawContext
+    {
+        QString name;
+        QString attribute;
+        QString lineEnd;
+        QString fallthrough;
+        QVector<RawRule> rules;
+        bool hasFallthrough = false;
+        bool dynamic = false;
+    };
+
+    struct Language
+    {
+        QString name;
+        QVector<RawContext> contexts;
+        QHash<QString, int> contextIds;
+        QHash<QString, QStringList> lists;
+        QHash<QString, int> listIds;
+        QHash<QString, int> lowerListIds;
+        QVector<QPair<QString, QTextCharFormat>> itemDatas;
+        QHash<QString, int> attributes;
+        QString additionalDeliminator;
+        QString weakDeliminator;
+        int contextBase = 0;
+        bool caseSensitive = true;
+    };
+
+    struct PendingRule
+    {
+        KNSyntaxDefinition::Rule rule;
+        int include = -1;
+        bool includeAttrib = false;
+    };
+
+    int loadLanguage(const QString &name);
+    void parseContext(QXmlStreamReader &reader, Language &language);
+    void parseItemData(QXmlStreamReader &reader, Language &language);
+    void parseList(QXmlStreamReader &reader, Language &language);
+    int findContext(const QString &name, const Language &language) const;
+    int regionId(const QString &name);
+    KNSyntaxDefinition::ContextSwitch parseSwitch(
+            const QString &text, const Language &language) const;
+    bool compileLanguage(int languageIndex);
+    void flattenContext(int index);
+    static QTextCharFormat defaultStyle(const QString &styleName);
+    KNSyntaxDefinition *m_definition;
+    const QHash<QString, QString> &m_namePathMap;
+    QVector<Language> m_languages;
+    QHash<QString, int> m_languageIds;
+    QVector<QVector<PendingRule>> m_pendingRules;
+    QVector<int> m_flattenState;
+    QHash<QString, int> m_regionIds;
+    int m_contextCount = 0;
+};
+
+bool KNSyntaxCompiler::compile(const QString &syntaxName)
+{
+    //Load the language and all the languages it includes, the first context of
+    //the language is the initial context.
+    if(loadLanguage(syntaxName) != 0 || m_contextCount == 0)
+    {
+        return false;
+    }
+    m_definition->m_contexts.resize(m_contextCount);
+    m_pendingRules.resize(m_contextCount);
+    //Resolve all the names to indexes.
+    for(int i=0; i<m_languages.size(); ++i)
+    {
+        if(!compileLanguage(i))
+        {
+            return false;
+        }
+    }
+    //Flatten the included rules of all the contexts.
+    m_flattenState.fill(0, m_contextCount);
+    for(int i=0; i<m_contextCount; ++i)
+    {
+        flattenContext(i);
+    }
+    return true;
+}
+
+int KNSyntaxCompiler::loadLanguage(const QString &name)
+{
+    //Check whether the language is already loaded.
+    auto languageIter = m_languageIds.find(name);
+    if(languageIter != m_languageIds.end())
+    {
+        return languageIter.value();
+    }
+    QFile syntaxFile(m_namePathMap.value(name));
+    if(!syntaxFile.open(QIODevice::ReadOnly))
+    {
+        return -1;
+    }
+    //Parse the syntax file, the entities in the DTD are expanded by the reader.
+    Language language;
+    language.name = name;
+    QXmlStreamReader reader(&syntaxFile);
+    while(!reader.atEnd())
+    {
+        reader.readNext();
+        if(!reader.isStartElement())
+        {
+            continue;
+        }
+        const auto elementName = reader.name();
+        if(elementName == QLatin1String("list"))
+        {
+            parseList(reader, language);
+        }
+        else if(elementName == QLatin1String("context"))
+        {
+            parseContext(reader, language);
+        }
+        else if(elementName == QLatin1String("itemData"))
+        {
+            parseItemData(reader, language);
+        }
+        else if(elementName == QLatin1String("language") &&
+                m_languages.isEmpty())
+        {
+            //Save the information of the main language.
+            auto attributes = reader.attributes();
+            m_definition->m_name = attributeOf(attributes, "name");
+            m_definition->m_extensions =
+                    attributeOf(attributes, "extensions").split(';');
+            m_definition->m_priority =
+                    attributeOf(attributes, "priority").toInt();
+        }
+        else if(elementName == QLatin1String("keywords"))
+        {
+            auto attributes = reader.attributes();
+            QString caseSensitive = attributeOf(attributes, "casesensitive");
+            language.caseSensitive = caseSensitive.isEmpty() ||
+                    isTrue(caseSensitive);
+            language.additionalDeliminator =
+                    attributeOf(attributes, "additionalDeliminator");
+            language.weakDeliminator =
+                    attributeOf(attributes, "weakDeliminator");
+        }
+    }
+    syntaxFile.close();
+    if(reader.hasError())
+    {
+        return -1;
+    }
+    //Register the language before loading the languages it refers to.
+    int languageIndex = m_languages.size();
+    language.contextBase = m_contextCount;
+    m_contextCount += language.contexts.size();
+    m_languageIds.insert(name, languageIndex);
+    m_languages.append(language);
+    QStringList references;
+    for(const auto &context : qAsConst(language.contexts))
+    {
+        references << context.lineEnd << context.fallthrough;
+        for(const auto &rule : context.rules)
+        {
+            references << rule.context << rule.include;
+        }
+    }
+    for(const auto &reference : qAsConst(references))
+    {
+        int languagePos = reference.indexOf("##");
+        if(languagePos > -1)
+        {
+            loadLanguage(reference.mid(languagePos + 2));
+        }
+    }
+    return languageIndex;
+}
+
+void KNSyntaxCompiler::parseContext(QXmlStreamReader &reader,
+                                    Language &language)
+{
+    auto attributes = reader.attributes();
+    RawContext context;
+    context.name = attributeOf(attributes, "name");
+    context.attribute = attributeOf(attributes, "attribute");
+    context.lineEnd = attributeOf(attributes, "lineEndContext");
+    context.hasFallthrough = isTrue(attributeOf(attributes, "fallthrough"));
+    context.fallthrough = attributeOf(attributes, "fallthroughContext");
+    context.dynamic = isTrue(attributeOf(attributes, "dynamic"));
+    //Parse the rules of the context.
+    while(reader.readNextStartElement())
+    {
+        const auto ruleName = reader.name();
+        auto ruleAttributes = reader.attributes();
+        RawRule raw;
+        auto &rule = raw.rule;
+        rule.string = attributeOf(ruleAttributes, "String");
+        QString char0 = attributeOf(ruleAttributes, "char"),
+                char1 = attributeOf(ruleAttributes, "char1");
+        if(!char0.isEmpty())
+        {
+            rule.char0 = char0.at(0);
+        }
+        if(!char1.isEmpty())
+        {
+            rule.char1 = char1.at(0);
+        }
+        rule.lookAhead = isTrue(attributeOf(ruleAttributes, "lookAhead"));
+        rule.firstNonSpace = isTrue(attributeOf(ruleAttributes,
+                                                "firstNonSpace"));
+        rule.insensitive = isTrue(attributeOf(ruleAttributes, "insensitive"));
+        rule.dynamic = isTrue(attributeOf(ruleAttributes, "dynamic"));
+        rule.beginRegion = regionId(attributeOf(ruleAttributes, "beginRegion"));
+        rule.endRegion = regionId(attributeOf(ruleAttributes, "endRegion"));
+        raw.attribute = attributeOf(ruleAttributes, "attribute");
+        raw.context = attributeOf(ruleAttributes, "context");
+        if(ruleName == QLatin1String("IncludeRules"))
+        {
+            raw.include = raw.context;
+            raw.context.clear();
+            raw.includeAttrib = isTrue(attributeOf(ruleAttributes,
+                                                   "includeAttrib"));
+        }
+        else if(ruleName == QLatin1String("DetectChar"))
+        {
+            rule.type = KNSyntaxDefinition::DetectChar;
+        }
+        else if(ruleName == QLatin1String("Detect2Chars"))
+        {
+            rule.type = KNSyntaxDefinition::Detect2Chars;
+        }
+        else if(ruleName == QLatin1String("AnyChar"))
+        {
+            rule.type = KNSyntaxDefinition::AnyChar;
+        }
+        else if(ruleName == QLatin1String("StringDetect"))
+        {
+            rule.type = KNSyntaxDefinition::StringDetect;
+        }
+        else if(ruleName == QLatin1String("WordDetect"))
+        {
+            rule.type = KNSyntaxDefinition::WordDetect;
+        }
+        else if(ruleName == QLatin1String("RegExpr"))
+        {
+            rule.type = KNSyntaxDefinition::RegExpr;
+            //The greedy option is saved in the pattern options.
+            QRegularExpression::PatternOptions options =
+                    QRegularExpression::NoPatternOption;
+            if(rule.insensitive)
+            {
+                options |= QRegularExpression::CaseInsensitiveOption;
+            }
+            if(isTrue(attributeOf(ruleAttributes, "minimal")))
+            {
+                options |= QRegularExpression::InvertedGreedinessOption;
+            }
+            rule.regExp.setPatternOptions(options);
+        }
+        else if(ruleName == QLatin1String("keyword"))
+        {
+            rule.type = KNSyntaxDefinition::Keyword;
+            raw.list = rule.string;
+        }
+        else if(ruleName == QLatin1String("DetectSpaces"))
+        {
+            rule.type = KNSyntaxDefinition::DetectSpaces;
+        }
+        else if(ruleName == QLatin1String("DetectIdentifier"))
+        {
+            rule.type = KNSyntaxDefinition::DetectIdentifier;
+        }
+        else if(ruleName == QLatin1String("RangeDetect"))
+        {
+            rule.type = KNSyntaxDefinition::RangeDetect;
+        }
+        else if(ruleName == QLatin1String("LineContinue"))
+        {
+            rule.type = KNSyntaxDefinition::LineContinue;
+            if(rule.char0.isNull())
+            {
+                rule.char0 = '\\';
+            }
+        }
+        else
+        {
+            //The rule is not supported, skip it.
+            reader.skipCurrentElement();
+            continue;
+        }
+        context.rules.append(raw);
+        //The child rules are not supported.
+        reader.skipCurrentElement();
+    }
+    language.contextIds.insert(context.name, language.contexts.size());
+    language.contexts.append(context);
+}
+
+void KNSyntaxCompiler::parseItemData(QXmlStreamReader &reader,
+                                     Language &language)
+{
+    auto attributes = reader.attributes();
+    //Start from the default style.
+    QTextCharFormat format =
+            defaultStyle(attributeOf(attributes, "defStyleNum"));
+    QString value = attributeOf(attributes, "color");
+    if(!value.isEmpty())
+    {
+        format.setForeground(QColor(value));
+    }
+    value = attributeOf(attributes, "backgroundColor");
+    if(!value.isEmpty())
+    {
+        format.setBackground(QColor(value));
+    }
+    value = attributeOf(attributes, "bold");
+    if(!value.isEmpty())
+    {
+        format.setFontWeight(isTrue(value) ? QFont::Bold : QFont::Normal);
+    }
+    value = attributeOf(attributes, "italic");
+    if(!value.isEmpty())
+    {
+        format.setFontItalic(isTrue(value));
+    }
+    value = attributeOf(attributes, "underline");
+    if(!value.isEmpty())
+    {
+        format.setFontUnderline(isTrue(value));
+    }
+    language.itemDatas.append(qMakePair(attributeOf(attributes, "name"),
+                                        format));
+}
+
+void KNSyntaxCompiler::parseList(QXmlStreamReader &reader, Language &language)
+{
+    QString listName = attributeOf(reader.attributes(), "name");
+    QStringList items;
+    while(reader.readNextStartElement())
+    {
+        if(reader.name() == QLatin1String("item"))
+        {
+            items.append(reader.readElementText().trimmed());
+        }
+        else
+        {
+            reader.skipCurrentElement();
+        }
+    }
+    language.lists.insert(listName, items);
+}
+
+int KNSyntaxCompiler::regionId(const QString &name)
+{
+    //The folding regions are matched by name in all the languages.
+    if(name.isEmpty())
+    {
+        return -1;
+    }
+    auto regionIter = m_regionIds.find(name);
+    if(regionIter == m_regionIds.end())
+    {
+        regionIter = m_regionIds.insert(name, m_regionIds.size());
+    }
+    return regionIter.value();
+}
+
+int KNSyntaxCompiler::findContext(const QString &name,
+                                  const Language &language) const
+{
+    //Check whether the context is in another language.
+    int languagePos = name.indexOf("##");
+    if(languagePos > -1)
+    {
+        int languageIndex = m_languageIds.value(name.mid(languagePos + 2), -1);
+        if(languageIndex == -1)
+        {
+            return -1;
+        }
+        const Language &target = m_languages.at(languageIndex);
+        //Empty context name means the initial context of the language.
+        if(languagePos == 0)
+        {
+            return target.contexts.isEmpty() ? -1 : target.contextBase;
+        }
+        return findContext(name.left(languagePos), target);
+    }
+    int contextIndex = language.contextIds.value(name, -1);
+    return contextIndex == -1 ? -1 : language.contextBase + contextIndex;
+}
+
+KNSyntaxDefinition::ContextSwitch KNSyntaxCompiler::parseSwitch(
+        const QString &text, const Language &language) const
+{
+    KNSyntaxDefinition::ContextSwitch contextSwitch;
+    //Count the pops at the beginning.
+    int pos = 0;
+    while(text.mid(pos, 4) == QLatin1String("#pop"))
+    {
+        ++contextSwitch.pops;
+        pos += 4;
+    }
+    if(pos < text.size() && text.at(pos) == '!')
+    {
+        ++pos;
+    }
+    QString contextName = text.mid(pos);
+    if(!contextName.isEmpty() && contextName != "#stay")
+    {
+        contextSwitch.push = findContext(contextName, language);
+    }
+    return contextSwitch;
+}
+
+bool KNSyntaxCompiler::compileLanguage(int languageIndex)
+{
+    Language &language = m_languages[languageIndex];
+    //Find the lists used by the insensitive rules of the case sensitive
+    //language, they need the lowercase tables as well.
+    QSet<QString> lowerLists;
+    if(language.caseSensitive)
+    {
+        for(const auto &raw : qAsConst(language.contexts))
+        {
+            for(const auto &rawRule : raw.rules)
+            {
+                if(rawRule.rule.type == KNSyntaxDefinition::Keyword &&
+                        rawRule.rule.insensitive)
+                {
+                    lowerLists.insert(rawRule.list);
+                }
+            }
+        }
+    }
+    //Build the keyword lists.
+    for(auto i=language.lists.constBegin(); i!=language.lists.constEnd(); ++i)
+    {
+        QSet<QString> keywords, lowerKeywords;
+        keywords.reserve(i.value().size());
+        bool buildLower = lowerLists.contains(i.key());
+        for(const auto &item : i.value())
+        {
+            keywords.insert(language.caseSensitive ? item : item.toLower());
+            if(buildLower)
+            {
+                lowerKeywords.insert(item.toLower());
+            }
+        }
+        KNSyntaxDefinition::KeywordTable table;
+        if(!KNSyntaxDefinition::buildKeywordTable(keywords, table))
+        {
+            return false;
+        }
+        language.listIds.insert(i.key(), m_definition->m_keywordTables.size());
+        m_definition->m_keywordTables.append(table);
+        if(buildLower)
+        {
+            if(!KNSyntaxDefinition::buildKeywordTable(lowerKeywords, table))
+            {
+                return false;
+            }
+            language.lowerListIds.insert(i.key(),
+                                         m_definition->m_keywordTables.size());
+            m_definition->m_keywordTables.append(table);
+        }
+    }
+    //Build the formats.
+    for(const auto &itemData : qAsConst(language.itemDatas))
+    {
+        language.attributes.insert(itemData.first,
+                                   m_definition->m_formats.size());
+        m_definition->m_formats.append(itemData.second);
+        m_definition->m_plainFormats.append(
+                    itemData.second.properties().isEmpty());
+    }
+    //Build the deliminators.
+    QVector<bool> deliminators(128, false);
+    QString deliminatorChars = QString(DEFAULT_DELIMINATORS) +
+            language.additionalDeliminator;
+    for(const auto &c : deliminatorChars)
+    {
+        if(c.unicode() < 128)
+        {
+            deliminators[c.unicode()] = true;
+        }
+    }
+    for(const auto &c : qAsConst(language.weakDeliminator))
+    {
+        if(c.unicode() < 128)
+        {
+            deliminators[c.unicode()] = false;
+        }
+    }
+    m_definition->m_deliminators.append(deliminators);
+    //Compile the contexts.
+    for(int i=0; i<language.contexts.size(); ++i)
+    {
+        const RawContext &raw = language.contexts.at(i);
+        int contextIndex = language.contextBase + i;
+        KNSyntaxDefinition::Context &context =
+                m_definition->m_contexts[contextIndex];
+        context.attribute = language.attributes.value(raw.attribute, -1);
+        context.lineEnd = parseSwitch(raw.lineEnd, language);
+        context.hasFallthrough = raw.hasFallthrough &&
+                !raw.fallthrough.isEmpty();
+        context.fallthrough = parseSwitch(raw.fallthrough, language);
+        context.dynamic = raw.dynamic;
+        QVector<PendingRule> &pendingRules = m_pendingRules[contextIndex];
+        pendingRules.reserve(raw.rules.size());
+        for(const auto &rawRule : raw.rules)
+        {
+            PendingRule pending;
+            if(!rawRule.include.isEmpty())
+            {
+                pending.include = findContext(rawRule.include, language);
+                pending.includeAttrib = rawRule.includeAttrib;
+                if(pending.include != -1)
+                {
+                    pendingRules.append(pending);
+                }
+                continue;
+            }
+            pending.rule = rawRule.rule;
+            auto &rule = pending.rule;
+            rule.language = languageIndex;
+            rule.attribute = language.attributes.value(rawRule.attribute, -1);
+            rule.target = parseSwitch(rawRule.context, language);
+            if(rule.type == KNSyntaxDefinition::Keyword)
+            {
+                //The insensitive rules of the case sensitive language use the
+                //lowercase table of the list.
+                rule.keywordList = (rule.insensitive && language.caseSensitive) ?
+                            language.lowerListIds.value(rawRule.list, -1) :
+                            language.listIds.value(rawRule.list, -1);
+                rule.insensitive = rule.insensitive || !language.caseSensitive;
+                if(rule.keywordList == -1)
+                {
+                    continue;
+                }
+            }
+            else if(rule.type == KNSyntaxDefinition::RegExpr && !rule.dynamic)
+            {
+                //Compile the regular expression once.
+                rule.regExp.setPattern(rule.string);
+                if(!rule.regExp.isValid())
+                {
+                    continue;
+                }
+                rule.regExp.optimize();
+                rule.regExpIndex = m_definition->m_regExpCount++;
+            }
+            pendingRules.append(pending);
+        }
+    }
+    return true;
+}
+
+void KNSyntaxCompiler::flattenContext(int index)
+{
+    //Check whether the context is flattened or being flattened.
+    if(m_flattenState.at(index) != 0)
+    {
+        return;
+    }
+    m_flattenState[index] = 1;
+    auto &rules = m_definition->m_contexts[index].rules;
+    for(const auto &pending : qAsConst(m_pendingRules.at(index)))
+    {
+        if(pending.include == -1)
+        {
+            rules.append(pending.rule);
+            continue;
+        }
+        //Ignore the recursive including.
+        flattenContext(pending.include);
+        if(m_flattenState.at(pending.include) != 2)
+        {
+            continue;
+        }
+        const auto &included = m_definition->m_contexts.at(pending.include);
+        int start = rules.size();
+        rules.append(included.rules);
+        if(pending.includeAttrib)
+        {
+            for(int i=start; i<rules.size(); ++i)
+            {
+                if(rules.at(i).attribute == -1)
+                {
+                    rules[i].attribute = included.attribute;
+                }
+            }
+        }
+    }
+    m_flattenState[index] = 2;
+}
+
+QTextCharFormat KNSyntaxCompiler::defaultStyle(const QString &styleName)
+{
+    QTextCharFormat format;
+    for(const auto &style : defaultStyles)
+    {
+        if(styleName == QLatin1String(style.name))
+        {
+            if(style.foreground)
+            {
+                format.setForeground(QColor::fromRgba(style.foreground));
+            }
+            if(style.background)
+            {
+                format.setBackground(QColor::fromRgba(style.background));
+            }
+            if(style.bold)
+            {
+                format.setFontWeight(QFont::Bold);
+            }
+            if(style.underline)
+            {
+                format.setFontUnderline(true);
+            }
+            break;
+        }
+    }
+    return format;
+}
+
+static QDataStream &operator<<(
+        QDataStream &stream,
+        const KNSyntaxDefinition::ContextSwitch &contextSwitch)
+{
+    return stream << qint32(contextSwitch.pops) << qint32(contextSwitch.push);
+}
+
+static QDataStream &operator>>(
+        QDataStream &stream, KNSyntaxDefinition::ContextSwitch &contextSwitch)
+{
+    qint32 pops, push;
+    stream >> pops >> push;
+    contextSwitch.pops = pops;
+    contextSwitch.push = push;
+    return stream;
+}
+
+KNSyntaxDefinition::KNSyntaxDefinition() :
+    m_priority(0),
+    m_regExpCount(0)
+{
+}
+
+bool KNSyntaxDefinition::load(const QString &syntaxName,
+                              const QHash<QString, QString> &namePathMap)
+{
+    //Reset the definition.
+    m_contexts.clear();
+    m_formats.clear();
+    m_plainFormats.clear();
+    m_keywordTables.clear();
+    m_deliminators.clear();
+    m_extensions.clear();
+    m_name.clear();
+    m_priority = 0;
+    m_regExpCount = 0;
+    //Compile the syntax files.
+    KNSyntaxCompiler compiler(this, namePathMap);
+    if(!compiler.compile(syntaxName))
+    {
+        m_contexts.clear();
+        return false;
+    }
+    return true;
+}
+
+QByteArray KNSyntaxDefinition::toBinary() const
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_6);
+    //Write the header.
+    stream << quint32(BINARY_MAGIC) << quint32(BINARY_VERSION)
+           << m_name << m_extensions << qint32(m_priority);
+    //Write the tables.
+    stream << qint32(m_regExpCount) << m_plainFormats << m_deliminators
+           << qint32(m_keywordTables.size());
+    for(const auto &table : m_keywordTables)
+    {
+        stream << table.displacements << table.keywords;
+    }
+    stream << qint32(m_formats.size());
+    for(const auto &format : m_formats)
+    {
+        stream << format;
+    }
+    stream << qint32(m_contexts.size());
+    for(const auto &context : m_contexts)
+    {
+        stream << context.lineEnd << context.fallthrough
+               << qint32(context.attribute) << context.hasFallthrough
+               << context.dynamic << qint32(context.rules.size());
+        for(const auto &rule : context.rules)
+        {
+            //The expression is saved as pattern, it is compiled when used.
+            quint8 flags = (rule.lookAhead ? 1 : 0) |
+                    (rule.firstNonSpace ? 2 : 0) |
+                    (rule.insensitive ? 4 : 0) |
+                    (rule.dynamic ? 8 : 0);
+            stream << rule.string << rule.regExp.pattern()
+                   << qint32(rule.regExp.patternOptions()) << rule.target
+                   << qint32(rule.type) << qint32(rule.attribute)
+                   << qint32(rule.keywordList) << qint32(rule.language)
+                   << qint32(rule.regExpIndex) << qint32(rule.beginRegion)
+                   << qint32(rule.endRegion) << rule.char0 << rule.char1
+                   << flags;
+        }
+    }
+    return data;
+}
+
+bool KNSyntaxDefinition::fromBinary(const QByteArray &data)
+{
+    QDataStream stream(data);
+    stream.setVersion(QDataStream::Qt_5_6);
+    quint32 magic, version;
+    qint32 priority, regExpCount, count;
+    stream >> magic >> version;
+    if(magic != BINARY_MAGIC || version != BINARY_VERSION)
+    {
+        return false;
+    }
+    stream >> m_name >> m_extensions >> priority;
+    m_priority = priority;
+    stream >> regExpCount >> m_plainFormats >> m_deliminators >> count;
+    m_regExpCount = regExpCount;
+    m_keywordTables.resize(count);
+    for(auto &table : m_keywordTables)
+    {
+        stream >> table.displacements >> table.keywords;
+    }
+    stream >> count;
+    m_formats.resize(count);
+    for(int i=0; i<count; ++i)
+    {
+        QTextFormat format;
+        stream >> format;
+        m_formats[i] = format.toCharFormat();
+    }
+    stream >> count;
+    m_contexts.resize(count);
+    for(auto &context : m_contexts)
+    {
+        qint32 attribute, ruleCount;
+        stream >> context.lineEnd >> context.fallthrough >> attribute
+               >> context.hasFallthrough >> context.dynamic >> ruleCount;
+        context.attribute = attribute;
+        context.rules.resize(ruleCount);
+        for(auto &rule : context.rules)
+        {
+            QString pattern;
+            qint32 options, type, ruleAttribute, keywordList, language,
+                    regExpIndex, beginRegion, endRegion;
+            quint8 flags;
+            stream >> rule.string >> pattern >> options >> rule.target
+                   >> type >> ruleAttribute >> keywordList >> language
+                   >> regExpIndex >> beginRegion >> endRegion >> rule.char0
+                   >> rule.char1 >> flags;
+            if(!pattern.isEmpty())
+            {
+                rule.regExp = QRegularExpression(
+                            pattern,
+                            QRegularExpression::PatternOptions(options));
+            }
+            else
+            {
+                rule.regExp.setPatternOptions(
+                            QRegularExpression::PatternOptions(options));
+            }
+            rule.type = type;
+            rule.attribute = ruleAttribute;
+            rule.keywordList = keywordList;
+            rule.language = language;
+            rule.regExpIndex = regExpIndex;
+            rule.beginRegion = beginRegion;
+            rule.endRegion = endRegion;
+            rule.lookAhead = flags & 1;
+            rule.firstNonSpace = flags & 2;
+            rule.insensitive = flags & 4;
+            rule.dynamic = flags & 8;
+        }
+    }
+    if(stream.status() != QDataStream::Ok)
+    {
+        m_contexts.clear();
+        return false;
+    }
+    //The hash identifies the compiled rules, e.g. for the highlight cache.
+    m_hash = QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+    return true;
+}
+
+bool KNSyntaxDefinition::readHeader(const QByteArray &data, QString &name,
+                                    QStringList &extensions, int &priority)
+{
+    QDataStream stream(data);
+    stream.setVersion(QDataStream::Qt_5_6);
+    quint32 magic, version;
+    qint32 languagePriority;
+    stream >> magic >> version;
+    if(magic != BINARY_MAGIC || version != BINARY_VERSION)
+    {
+        return false;
+    }
+    stream >> name >> extensions >> languagePriority;
+    priority = languagePriority;
+    return stream.status() == QDataStream::Ok;
+}
+
+void KNSyntaxDefinition::registerBinary(const char *data, int size)
+{
+    binaryList().append(QByteArray::fromRawData(data, size));
+}
+
+QVector<QByteArray> KNSyntaxDefinition::binaries()
+{
+    return binaryList();
+}
+
+QString KNSyntaxDefinition::name() const
+{
+    return m_name;
+}
+
+QStringList KNSyntaxDefinition::extensions() const
+{
+    return m_extensions;
+}
+
+int KNSyntaxDefinition::priority() const
+{
+    return m_priority;
+}
+
+QByteArray KNSyntaxDefinition::hash() const
+{
+    return m_hash;
+}
+
+bool KNSyntaxDefinition::buildKeywordTable(const QSet<QString> &keywords,
+                                           KeywordTable &table)
+{
+    table = KeywordTable();
+    if(keywords.isEmpty())
+    {
+        return true;
+    }
+    //Enlarge the table when any bucket could not be placed. The keywords with
+    //the same hash could never be placed, the table could not be built.
+    int size = keywords.size();
+    for(int i=0; i<=MAX_TABLE_GROWS; ++i)
+    {
+        if(placeKeywords(keywords, size, table))
+        {
+            return true;
+        }
+        size += (size >> 1) + 1;
+    }
+    table = KeywordTable();
+    return false;
+}
+
+bool KNSyntaxDefinition::placeKeywords(const QSet<QString> &keywords, int size,
+                                       KeywordTable &table)
+{
+    //Use the hash and displace method. The keywords are grouped into buckets,
+    //each bucket finds a displacement which moves all its keywords to the free
+    //slots. The largest buckets are placed first. The slots which hold no
+    //keyword keep the empty string.
+    QVector<QVector<QPair<quint64, QString>>> buckets(size);
+    for(const auto &keyword : keywords)
+    {
+        quint64 hash = keywordHash(keyword.constData(), keyword.size(), false);
+        buckets[keywordBucket(hash, size)].append(qMakePair(hash, keyword));
+    }
+    QVector<int> order(size);
+    for(int i=0; i<size; ++i)
+    {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b)
+    {
+        return buckets.at(a).size() > buckets.at(b).size();
+    });
+    table.displacements.fill(0, size);
+    table.keywords.fill(QString(), size);
+    QVector<bool> used(size, false);
+    QVector<int> slots;
+    for(int bucket : order)
+    {
+        const auto &items = buckets.at(bucket);
+        if(items.isEmpty())
+        {
+            break;
+        }
+        slots.resize(items.size());
+        bool placed = false;
+        for(quint32 displacement = 0;
+            !placed && displacement < MAX_DISPLACEMENT; ++displacement)
+        {
+            //Check whether all the keywords are moved to different free slots.
+            placed = true;
+            for(int i=0; i<items.size() && placed; ++i)
+            {
+                slots[i] = keywordSlot(items.at(i).first, displacement, size);
+                placed = !used.at(slots.at(i));
+                for(int j=0; j<i && placed; ++j)
+                {
+                    placed = slots.at(j) != slots.at(i);
+                }
+            }
+            if(placed)
+            {
+                table.displacements[bucket] = displacement;
+                for(int i=0; i<items.size(); ++i)
+                {
+                    used[slots.at(i)] = true;
+                    table.keywords[slots.at(i)] = items.at(i).second;
+                }
+            }
+        }
+        //No displacement places the bucket, try a larger table.
+        if(!placed)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+QVector<QByteArray> &KNSyntaxDefinition::binaryList()
+{
+    //The list is created on the first use, the registers are static objects.
+    static QVector<QByteArray> list;
+    return list;
+}
+
+bool KNSyntaxDefinition::isValid() const
+{
+    return !m_contexts.isEmpty();
+}
+
+bool KNSyntaxDefinition::isKeyword(int list, const QChar *word, int length,
+                                   bool insensitive) const
+{
+    const KeywordTable &table = m_keywordTables.at(list);
+    int size = table.keywords.size();
+    if(size == 0)
+    {
+        return false;
+    }
+    //Find the only slot which could hold the word.
+    quint64 hash = keywordHash(word, length, insensitive);
+    const QString &keyword = table.keywords.at(
+                keywordSlot(hash, table.displacements.at(
+                                keywordBucket(hash, size)), size));
+    if(keyword.size() != length)
+    {
+        return false;
+    }
+    const QChar *keywordData = keyword.constData();
+    for(int i=0; i<length; ++i)
+    {
+        if(foldChar(word[i], insensitive) != keywordData[i].unicode())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int KNSyntaxDefinition::regExpCount() const
+{
+    return m_regExpCount;
+}
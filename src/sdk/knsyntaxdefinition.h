@@ -0,0 +1,272 @@
+/*
+ * Copyright (C) Kreogist Dev Team
+ *
+ * You can redistribute this software and/or modify it under the
+ * terms of the HARERU Software License; either version 1 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * license file for more details.
+ */
+#ifndef KNSYNTAXDEFINITION_H
+#define KNSYNTAXDEFINITION_H
+
+#include <QHash>
+#include <QRegularExpression>
+#include <QSet>
+#include <QStringList>
+#include <QTextCharFormat>
+#include <QVector>
+
+/*!
+ * \brief The KNSyntaxDefinition class is the compiled form of a Kate syntax
+ * definition. The contexts of the language and all the languages it includes
+ * are stored in one context table. The IncludeRules are flattened into the
+ * rule list of the context, and the context switches are resolved to the
+ * indexes of the table, so the highlighter could run the rules as a state
+ * machine without any name lookup.\n
+ * Each keyword list is saved as a minimal perfect hash table, a word is
+ * checked with one hash probe and one comparison.
+ */
+class KNSyntaxDefinition
+{
+public:
+    enum RuleTypes
+    {
+        DetectChar,
+        Detect2Chars,
+        AnyChar,
+        StringDetect,
+        WordDetect,
+        RegExpr,
+        Keyword,
+        DetectSpaces,
+        DetectIdentifier,
+        RangeDetect,
+        LineContinue
+    };
+
+    struct ContextSwitch
+    {
+        int pops = 0;
+        int push = -1;
+        bool isStay() const { return pops == 0 && push == -1; }
+    };
+
+    struct Rule
+    {
+        QString string;
+        QRegularExpression regExp;
+        ContextSwitch target;
+        int type = DetectChar;
+        int attribute = -1;
+        int keywordList = -1;
+        int language = 0;
+        int regExpIndex = -1;
+        int beginRegion = -1;
+        int endRegion = -1;
+        QChar char0;
+        QChar char1;
+        bool lookAhead = false;
+        bool firstNonSpace = false;
+        bool insensitive = false;
+        bool dynamic = false;
+    };
+
+    struct Context
+    {
+        QVector<Rule> rules;
+        ContextSwitch lineEnd;
+        ContextSwitch fallthrough;
+        int attribute = -1;
+        bool hasFallthrough = false;
+        bool dynamic = false;
+    };
+
+    /*!
+     * \brief Construct an empty KNSyntaxDefinition object.
+     */
+    KNSyntaxDefinition();
+
+    /*!
+     * \brief Compile the syntax definition from the Kate syntax files.
+     * \param syntaxName The language name of the syntax.
+     * \param namePathMap The map from the language name to the file path, it
+     * is used to load the included languages.
+     * \return If the language is compiled, return true.
+     */
+    bool load(const QString &syntaxName,
+              const QHash<QString, QString> &namePathMap);
+
+    /*!
+     * \brief Save the compiled definition to the binary format.
+     * \return The binary data.
+     */
+    QByteArray toBinary() const;
+
+    /*!
+     * \brief Load the compiled definition from the binary format.
+     * \param data The binary data generated by toBinary().
+     * \return If the data is loaded, return true.
+     */
+    bool fromBinary(const QByteArray &data);
+
+    /*!
+     * \brief Read the language information of the binary data without loading
+     * the rules.
+     * \param data The binary data generated by toBinary().
+     * \param name The language name.
+     * \param extensions The file extensions of the language.
+     * \param priority The priority of the extensions.
+     * \return If the data is valid, return true.
+     */
+    static bool readHeader(const QByteArray &data, QString &name,
+                           QStringList &extensions, int &priority);
+
+    /*!
+     * \brief Register a binary definition generated at build time. The data
+     * is not copied, it must be alive during the whole application.
+     * \param data The binary data pointer.
+     * \param size The size of the data.
+     */
+    static void registerBinary(const char *data, int size);
+
+    /*!
+     * \brief Get all the registered binary definitions.
+     * \return The binary data list.
+     */
+    static QVector<QByteArray> binaries();
+
+    /*!
+     * \brief Get the language name of the definition.
+     * \return The language name.
+     */
+    QString name() const;
+
+    /*!
+     * \brief Get the file extensions of the language, e.g. "*.cpp".
+     * \return The extension patterns.
+     */
+    QStringList extensions() const;
+
+    /*!
+     * \brief Get the priority of the language when the extensions conflict.
+     * \return The priority value.
+     */
+    int priority() const;
+
+    /*!
+     * \brief Get the hash of the binary data which the definition is loaded
+     * from.
+     * \return The SHA-1 hash. If the definition is not loaded from the binary
+     * data, return an empty array.
+     */
+    QByteArray hash() const;
+
+    /*!
+     * \brief Check whether the definition contains any context.
+     * \return If the definition could be used, return true.
+     */
+    bool isValid() const;
+
+    /*!
+     * \brief Get the context at the index.
+     * \param index The context index, 0 is the initial context.
+     * \return The context reference.
+     */
+    const Context &context(int index) const
+    {
+        return m_contexts.at(index);
+    }
+
+    /*!
+     * \brief Get the text format of an attribute.
+     * \param attribute The attribute index.
+     * \return The text format.
+     */
+    const QTextCharFormat &format(int attribute) const
+    {
+        return m_formats.at(attribute);
+    }
+
+    /*!
+     * \brief Check whether the attribute does not change the text format.
+     * \param attribute The attribute index.
+     * \return If the attribute is the normal text, return true.
+     */
+    bool isPlainFormat(int attribute) const
+    {
+        return attribute < 0 || m_plainFormats.at(attribute);
+    }
+
+    /*!
+     * \brief Check whether a word is in a keyword list.
+     * \param list The keyword list index.
+     * \param word The characters of the word.
+     * \param length The length of the word.
+     * \param insensitive Whether the word is compared case insensitive.
+     * \return If the word is in the list, return true.
+     */
+    bool isKeyword(int list, const QChar *word, int length,
+                   bool insensitive) const;
+
+    /*!
+     * \brief Check whether a character is a word deliminator of the language.
+     * \param language The language index.
+     * \param c The character.
+     * \return If the character ends a word, return true.
+     */
+    bool isDeliminator(int language, QChar c) const
+    {
+        return c.unicode() < 128 ?
+                    m_deliminators.at(language).at(c.unicode()) :
+                    c.isSpace();
+    }
+
+    /*!
+     * \brief Get the number of the regular expression rules.
+     * \return The rule count, used for preparing the match caches.
+     */
+    int regExpCount() const;
+
+private:
+    friend class KNSyntaxCompiler;
+    struct KeywordTable
+    {
+        //The displacement of each bucket, and the keyword of each slot.
+        QVector<quint32> displacements;
+        QVector<QString> keywords;
+    };
+    static QVector<QByteArray> &binaryList();
+    static bool buildKeywordTable(const QSet<QString> &keywords,
+                                  KeywordTable &table);
+    static bool placeKeywords(const QSet<QString> &keywords, int size,
+                              KeywordTable &table);
+    QString m_name;
+    QStringList m_extensions;
+    QByteArray m_hash;
+    QVector<Context> m_contexts;
+    QVector<QTextCharFormat> m_formats;
+    QVector<bool> m_plainFormats;
+    QVector<KeywordTable> m_keywordTables;
+    QVector<QVector<bool>> m_deliminators;
+    int m_priority;
+    int m_regExpCount;
+};
+
+/*!
+ * \brief The KNSyntaxRegister class registers the binary definition generated
+ * by the syntax compiler. The generated sources create a static instance.
+ */
+class KNSyntaxRegister
+{
+public:
+    KNSyntaxRegister(const char *data, int size)
+    {
+        KNSyntaxDefinition::registerBinary(data, size);
+    }
+};
+
+#endif // KNSYNTAXDEFINITION_H
@@ -10,13 +10,58 @@
  * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
  * license file for more details.
  */
+#include <climits>
+
+#include <QTextDocument>
+#include <QTextLayout>
+#include <QTimer>
+
 #include "kntextblockdata.h"
+#include "knframeprofiler.h"
 
 #include "knsyntaxhighlighter.h"
 
+//The time budget of one highlight slice in milliseconds.
+#define HIGHLIGHT_SLICE     (8)
+//The screens highlighted before and after the viewport in viewport mode.
+#define VIEWPORT_SCREENS    (2)
+//The number of blocks between two state checkpoints.
+#define CHECKPOINT_BLOCKS   (256)
+//The maximum checkpoints scanned back when resyncing the state.
+#define RESYNC_CHECKPOINTS  (16)
+//The blocks highlighted from the initial state when no checkpoint is found.
+#define RESYNC_BLOCKS       (256)
+
+static quint32 highlightStamp = 0;
+
 KNSyntaxHighlighter::KNSyntaxHighlighter(QObject *parent) :
-    QSyntaxHighlighter(parent)
+    QSyntaxHighlighter(parent),
+    m_idleTimer(new QTimer(this)),
+    m_sliceTimer(new QTimer(this)),
+    m_dirtyBlock(-1),
+    m_dirtyEnd(-1),
+    m_blockCount(0),
+    m_viewFirst(-1),
+    m_viewLast(-1),
+    m_windowStart(-1),
+    m_windowEnd(-1),
+    m_regionsBlock(-1),
+    m_stamp(++highlightStamp),
+    m_viewportMode(false),
+    m_fullPending(false)
 {
+    //Continue the deferred blocks when the event loop is idle.
+    m_idleTimer->setSingleShot(true);
+    m_idleTimer->setInterval(0);
+    connect(m_idleTimer, &QTimer::timeout,
+            this, &KNSyntaxHighlighter::onIdleHighlight);
+    //A slice started by the document changes ends with the event loop.
+    m_sliceTimer->setSingleShot(true);
+    m_sliceTimer->setInterval(0);
+    connect(m_sliceTimer, &QTimer::timeout, this, [=]
+    {
+        m_sliceClock.invalidate();
+    });
 }
 
 bool KNSyntaxHighlighter::hasCodeLevel() const
@@ -24,8 +69,150 @@ bool KNSyntaxHighlighter::hasCodeLevel() const
     return false;
 }
 
+void KNSyntaxHighlighter::rehighlightInBackground(int firstBlock,
+                                                  int lastBlock)
+{
+    if(!document())
+    {
+        return;
+    }
+    m_blockCount = document()->blockCount();
+    //The visible blocks are highlighted first from the nearest known state,
+    //then all the blocks are waiting to be highlighted from the top.
+    m_fullPending = firstBlock > 0;
+    if(m_fullPending)
+    {
+        m_dirtyBlock = resyncBlock(firstBlock);
+        m_dirtyEnd = qMax(firstBlock, lastBlock);
+    }
+    else
+    {
+        m_dirtyBlock = 0;
+        m_dirtyEnd = INT_MAX;
+    }
+    onIdleHighlight();
+}
+
+bool KNSyntaxHighlighter::isHighlighting() const
+{
+    return m_dirtyBlock > -1 || m_fullPending;
+}
+
+bool KNSyntaxHighlighter::isViewportMode() const
+{
+    return m_viewportMode;
+}
+
+void KNSyntaxHighlighter::setViewportMode(bool enabled)
+{
+    m_viewportMode = enabled;
+    //Reset the highlighted blocks and the viewport.
+    m_stamp = ++highlightStamp;
+    m_checkpoints.clear();
+    m_dirtyBlock = -1;
+    m_dirtyEnd = -1;
+    m_fullPending = false;
+    m_viewFirst = -1;
+    m_viewLast = -1;
+    m_windowStart = -1;
+    m_windowEnd = -1;
+}
+
+void KNSyntaxHighlighter::setViewport(int firstBlock, int lastBlock)
+{
+    if(!m_viewportMode || !document() ||
+            (firstBlock == m_viewFirst && lastBlock == m_viewLast))
+    {
+        return;
+    }
+    m_viewFirst = firstBlock;
+    m_viewLast = lastBlock;
+    m_blockCount = document()->blockCount();
+    //Calculate the highlight window.
+    int screenBlocks = qMax(1, lastBlock - firstBlock + 1);
+    m_windowStart = qMax(0, firstBlock - VIEWPORT_SCREENS * screenBlocks);
+    m_windowEnd = lastBlock + VIEWPORT_SCREENS * screenBlocks;
+    //Find the first block which is not highlighted in the window.
+    QTextBlock block = document()->findBlockByNumber(m_windowStart);
+    int blockNumber = m_windowStart;
+    while(block.isValid() && blockNumber <= m_windowEnd && isHighlighted(block))
+    {
+        block = block.next();
+        ++blockNumber;
+    }
+    if(!block.isValid() || blockNumber > m_windowEnd)
+    {
+        return;
+    }
+    //When the previous block is not highlighted, its state is unknown.
+    QTextBlock previousBlock = block.previous();
+    if(previousBlock.isValid() && !isHighlighted(previousBlock))
+    {
+        blockNumber = resyncBlock(blockNumber);
+        m_windowStart = qMin(m_windowStart, blockNumber);
+    }
+    //Highlight the window from the block.
+    m_dirtyBlock = blockNumber;
+    m_dirtyEnd = m_windowEnd;
+    onIdleHighlight();
+}
+
+int KNSyntaxHighlighter::takeRegionsChanged()
+{
+    int blockNumber = m_regionsBlock;
+    m_regionsBlock = -1;
+    return blockNumber;
+}
+
+bool KNSyntaxHighlighter::loadCache(const QString &filePath)
+{
+    Q_UNUSED(filePath)
+    return false;
+}
+
+void KNSyntaxHighlighter::saveCache(const QString &filePath)
+{
+    Q_UNUSED(filePath)
+}
+
 void KNSyntaxHighlighter::highlightBlock(const QString &text)
 {
+    KNProfileScope profileScope(KNFrameProfiler::Highlight);
+    KNFrameProfiler::count(KNFrameProfiler::HighlighterCalls);
+    int blockNumber = currentBlock().blockNumber();
+    updateBlockCount(blockNumber);
+    //Start the slice when the first block is highlighted.
+    if(!m_sliceClock.isValid())
+    {
+        m_sliceClock.start();
+        m_sliceTimer->start();
+    }
+    //In viewport mode, the blocks outside the window are skipped.
+    if(m_viewportMode &&
+            (blockNumber < m_windowStart || blockNumber > m_windowEnd))
+    {
+        deferBlock(blockNumber, false);
+        return;
+    }
+    //The block inside the waiting range could not be highlighted before the
+    //first waiting block, the state of its previous block is unknown.
+    if((m_dirtyBlock > -1 && blockNumber > m_dirtyBlock &&
+        blockNumber <= m_dirtyEnd) ||
+            m_sliceClock.hasExpired(HIGHLIGHT_SLICE))
+    {
+        deferBlock(blockNumber, true);
+        return;
+    }
+    if(blockNumber == m_dirtyBlock)
+    {
+        //Move to the next waiting block.
+        m_dirtyBlock = (blockNumber < m_dirtyEnd &&
+                        currentBlock().next().isValid()) ? blockNumber + 1 : -1;
+        if(m_dirtyBlock < 0 && m_fullPending)
+        {
+            m_idleTimer->start();
+        }
+    }
     //Create the user data for the text block.
     auto blockData = static_cast<KNTextBlockData *>(currentBlockUserData());
     if(!blockData)
@@ -37,7 +224,13 @@ void KNSyntaxHighlighter::highlightBlock(const QString &text)
     //Mark the block is changed.
     blockData->onBlockChanged();
     //Process the syntax color.
+    int previousState = currentBlockState();
     syntaxProcess(text, blockData);
+    blockData->highlightStamp = m_stamp;
+    if(m_viewportMode)
+    {
+        updateCheckpoint(blockNumber, previousState);
+    }
 }
 
 void KNSyntaxHighlighter::syntaxProcess(const QString &text,
@@ -46,3 +239,173 @@ void KNSyntaxHighlighter::syntaxProcess(const QString &text,
     Q_UNUSED(text)
     Q_UNUSED(data)
 }
+
+void KNSyntaxHighlighter::setRegionMarks(KNTextBlockData *data,
+                                         const QVector<int> &marks)
+{
+    if(data->regionMarks == marks)
+    {
+        return;
+    }
+    data->regionMarks = marks;
+    //Only notify the first change, the receiver collects all the changes from
+    //the first changed block.
+    int blockNumber = currentBlock().blockNumber();
+    if(m_regionsBlock == -1)
+    {
+        m_regionsBlock = blockNumber;
+        emit regionsChanged();
+        return;
+    }
+    m_regionsBlock = qMin(m_regionsBlock, blockNumber);
+}
+
+void KNSyntaxHighlighter::onIdleHighlight()
+{
+    if(!document())
+    {
+        return;
+    }
+    //Highlight the deferred blocks until the slice runs out.
+    m_sliceClock.start();
+    while(!m_sliceClock.hasExpired(HIGHLIGHT_SLICE))
+    {
+        if(m_dirtyBlock < 0)
+        {
+            //Highlight all the blocks from the top after the visible blocks.
+            if(!m_fullPending)
+            {
+                break;
+            }
+            m_fullPending = false;
+            m_dirtyBlock = 0;
+            m_dirtyEnd = INT_MAX;
+        }
+        QTextBlock block = document()->findBlockByNumber(m_dirtyBlock);
+        if(!block.isValid())
+        {
+            //The document is shorter than the waiting range.
+            m_dirtyBlock = -1;
+            continue;
+        }
+        //The changed states will be cascaded to the following blocks.
+        rehighlightBlock(block);
+    }
+    m_sliceClock.invalidate();
+    if(m_dirtyBlock > -1 || m_fullPending)
+    {
+        m_idleTimer->start();
+    }
+}
+
+void KNSyntaxHighlighter::updateBlockCount(int blockNumber)
+{
+    //The first block highlighted after the document changes is the changed
+    //block, move the tracked blocks after it with the block count changes.
+    int blockCount = document()->blockCount();
+    if(blockCount == m_blockCount)
+    {
+        return;
+    }
+    int offset = blockCount - m_blockCount;
+    m_blockCount = blockCount;
+    //The checkpoints after the block are moved.
+    if(m_checkpoints.size() > blockNumber / CHECKPOINT_BLOCKS)
+    {
+        m_checkpoints.resize(blockNumber / CHECKPOINT_BLOCKS);
+    }
+    if(m_dirtyBlock > blockNumber)
+    {
+        m_dirtyBlock = qMax(blockNumber, m_dirtyBlock + offset);
+    }
+    if(m_dirtyBlock > -1 && m_dirtyEnd > blockNumber && m_dirtyEnd != INT_MAX)
+    {
+        m_dirtyEnd = qMax(qMax(m_dirtyBlock, blockNumber), m_dirtyEnd + offset);
+    }
+}
+
+void KNSyntaxHighlighter::deferBlock(int blockNumber, bool wait)
+{
+    //Keep the previous formats, the state of the block is not changed, so the
+    //highlighter stops cascading to the next block.
+    const auto ranges = currentBlock().layout()->formats();
+    for(const auto &range : ranges)
+    {
+        setFormat(range.start, range.length, range.format);
+    }
+    auto blockData = static_cast<KNTextBlockData *>(currentBlockUserData());
+    if(blockData)
+    {
+        blockData->highlightStamp = 0;
+    }
+    if(!wait)
+    {
+        return;
+    }
+    //Extend the waiting range to the block.
+    if(m_dirtyBlock < 0)
+    {
+        m_dirtyBlock = blockNumber;
+        m_dirtyEnd = blockNumber;
+    }
+    else
+    {
+        m_dirtyBlock = qMin(m_dirtyBlock, blockNumber);
+        m_dirtyEnd = qMax(m_dirtyEnd, blockNumber);
+    }
+    m_idleTimer->start();
+}
+
+void KNSyntaxHighlighter::updateCheckpoint(int blockNumber, int previousState)
+{
+    int state = currentBlockState(),
+            index = blockNumber / CHECKPOINT_BLOCKS;
+    //When the state is changed, the checkpoints after the block are expired.
+    if(state != previousState && m_checkpoints.size() > index)
+    {
+        m_checkpoints.resize(index);
+    }
+    //Save the state of the last block before the checkpoint.
+    if(blockNumber % CHECKPOINT_BLOCKS == CHECKPOINT_BLOCKS - 1)
+    {
+        while(m_checkpoints.size() <= index)
+        {
+            m_checkpoints.append(-1);
+        }
+        m_checkpoints[index] = state;
+    }
+}
+
+bool KNSyntaxHighlighter::isHighlighted(const QTextBlock &block) const
+{
+    auto blockData = static_cast<KNTextBlockData *>(block.userData());
+    return blockData && blockData->highlightStamp == m_stamp;
+}
+
+int KNSyntaxHighlighter::resyncBlock(int blockNumber)
+{
+    //Scan back to the last known checkpoint.
+    int index = qMin(blockNumber / CHECKPOINT_BLOCKS,
+                     m_checkpoints.size()) - 1,
+            limit = index - RESYNC_CHECKPOINTS;
+    while(index > limit && index > -1 && m_checkpoints.at(index) < 0)
+    {
+        --index;
+    }
+    if(index > limit && index > -1)
+    {
+        //Restore the state of the block before the checkpoint.
+        int checkpointBlock = (index + 1) * CHECKPOINT_BLOCKS - 1;
+        document()->findBlockByNumber(checkpointBlock).setUserState(
+                    m_checkpoints.at(index));
+        return checkpointBlock + 1;
+    }
+    //No checkpoint is near the block, guess the block several blocks before is
+    //in the initial state.
+    int startBlock = qMax(0, blockNumber - RESYNC_BLOCKS);
+    if(startBlock > 0)
+    {
+        document()->findBlockByNumber(startBlock - 1).setUserState(-1);
+    }
+    return startBlock;
+}
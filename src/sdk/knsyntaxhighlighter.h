@@ -13,15 +13,29 @@
 #ifndef KNSYNTAXHIGHLIGHTER_H
 #define KNSYNTAXHIGHLIGHTER_H
 
+#include <QElapsedTimer>
 #include <QHash>
+#include <QVector>
 
 #include <QSyntaxHighlighter>
 
+class QTimer;
 class KNTextEdit;
 class KNTextBlockData;
 /*!
  * \brief The KNSyntaxHighlighter class is the default and base syntax
- * highlighter implementation, which manages the format of the file.
+ * highlighter implementation, which manages the format of the file.\n
+ * The highlighting is done in time slices. When a slice runs out of time, the
+ * rest blocks keep their previous formats and states, and they are highlighted
+ * from an idle timer later. The deferred blocks are always highlighted from the
+ * top, so the state of the previous block is known when a block is highlighted.
+ * When the whole document is highlighted, the visible blocks are highlighted
+ * first from a guessed state, and they are corrected by the pass from the top.
+ * Since the states are kept, a change stops cascading as soon as the state of
+ * a block is the same as before.\n
+ * In viewport mode, only the blocks near the viewport are highlighted. The
+ * block states are saved as checkpoints every several blocks, a block far from
+ * the highlighted blocks starts from the nearest checkpoint before it.
  */
 class KNSyntaxHighlighter : public QSyntaxHighlighter
 {
@@ -39,6 +53,72 @@ public:
      */
     virtual bool hasCodeLevel() const;
 
+    /*!
+     * \brief Highlight the whole document in background. The first slice is
+     * highlighted immediately, which covers the visible blocks.
+     * \param firstBlock The first visible block number.
+     * \param lastBlock The last visible block number.
+     */
+    void rehighlightInBackground(int firstBlock = 0, int lastBlock = 0);
+
+    /*!
+     * \brief Check whether any block is waiting to be highlighted in
+     * background.
+     * \return If the background highlighting is not finished, return true.
+     */
+    bool isHighlighting() const;
+
+    /*!
+     * \brief Check whether the highlighter only highlights the blocks near the
+     * viewport.
+     * \return If the viewport mode is enabled, return true.
+     */
+    bool isViewportMode() const;
+
+    /*!
+     * \brief Enable or disable the viewport mode. When the mode is changed,
+     * all the blocks are treated as not highlighted.
+     * \param enabled To enable the viewport mode, set it to true.
+     */
+    void setViewportMode(bool enabled);
+
+    /*!
+     * \brief Set the visible blocks in viewport mode. The blocks within several
+     * screens around the viewport will be highlighted.
+     * \param firstBlock The first visible block number.
+     * \param lastBlock The last visible block number.
+     */
+    void setViewport(int firstBlock, int lastBlock);
+
+    /*!
+     * \brief Get the first block whose folding region markers are changed
+     * since the last call, and reset the changed state.
+     * \return The first changed block number. If no marker is changed, return
+     * -1.
+     */
+    int takeRegionsChanged();
+
+    /*!
+     * \brief Load the highlight cache of the file before the document is set.
+     * \param filePath The file path of the document.
+     * \return If the cache is loaded, return true.
+     */
+    virtual bool loadCache(const QString &filePath);
+
+    /*!
+     * \brief Save the highlight result of the document as the cache of the
+     * file. The document should be the same as the file on the disk.
+     * \param filePath The file path of the document.
+     */
+    virtual void saveCache(const QString &filePath);
+
+signals:
+    /*!
+     * \brief When the folding region markers of a block is changed after the
+     * last takeRegionsChanged() call, this signal is emitted once.
+     */
+    void regionsChanged();
+
 protected:
     /*!
      * \brief Reimplemented from QSyntaxHighlighter::highlightBlock().
@@ -52,7 +132,40 @@ protected:
      */
     virtual void syntaxProcess(const QString &text, KNTextBlockData *data);
 
+    /*!
+     * \brief Update the folding region markers of the block.
+     * \param data The data pointer of the current block.
+     * \param marks The region markers found in the block.
+     */
+    void setRegionMarks(KNTextBlockData *data, const QVector<int> &marks);
+
+    /*!
+     * \brief Check whether a block is highlighted by the highlighter.
+     * \param block The text block.
+     * \return If the block has the latest highlight result, return true.
+     */
+    bool isHighlighted(const QTextBlock &block) const;
+
+private slots:
+    void onIdleHighlight();
+
 private:
+    void updateBlockCount(int blockNumber);
+    void deferBlock(int blockNumber, bool wait);
+    void updateCheckpoint(int blockNumber, int previousState);
+    int resyncBlock(int blockNumber);
+    QElapsedTimer m_sliceClock;
+    QVector<int> m_checkpoints;
+    QTimer *m_idleTimer, *m_sliceTimer;
+    //The range of the blocks which are waiting to be highlighted, the first
+    //block is -1 when all the blocks are highlighted.
+    int m_dirtyBlock, m_dirtyEnd;
+    int m_blockCount;
+    int m_viewFirst, m_viewLast, m_windowStart, m_windowEnd;
+    //The first block whose region markers are changed, -1 when none changed.
+    int m_regionsBlock;
+    quint32 m_stamp;
+    bool m_viewportMode, m_fullPending;
 };
 
 #endif // KNSYNTAXHIGHLIGHTER_H
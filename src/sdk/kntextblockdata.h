@@ -15,6 +15,8 @@
 
 #include <QMutex>
 #include <QTextBlockUserData>
+#include <QTextLayout>
+#include <QVector>
 
 /*!
  * \brief The KNTextBlockData class provides all the data for the KNTextEdit to
@@ -24,7 +26,7 @@ class KNTextBlockData : public QTextBlockUserData
 {
 public:
     KNTextBlockData() { }
-    ~KNTextBlockData() { }
+    ~KNTextBlockData() { qDeleteAll(segmentLayouts); }
 
     struct MarkBlock
     {
@@ -52,8 +54,21 @@ public:
     int level = 0;
     int levelMargin = 0;
     bool isFold = false;
-    //Vertical cursor caches.
-    int verticalTextPos = 0;
+    //The folding region markers in match order, a begin is saved as the
+    //region id + 1, an end is saved as -(region id + 1).
+    QVector<int> regionMarks;
+    //The format runs as start, length and attribute triples, only recorded for
+    //the highlight cache.
+    QVector<int> formatRuns;
+    //The highlighter which highlighted the block, 0 means not highlighted.
+    quint32 highlightStamp = 0;
+    //The horizontal segments of a long block, the start and the x position of
+    //each segment. Only the shaped segments have a layout.
+    QVector<int> segmentStarts;
+    QVector<qreal> segmentX;
+    QVector<QTextLayout *> segmentLayouts;
+    int segmentLength = 0;
+    int shapedSegments = 0;
 
     void lockQuickSearch() { lock.lock(); }
     void unlockQuickSearch() { lock.unlock(); }
@@ -26,17 +26,24 @@
 #include <QFileInfo>
 #include <QDir>
 #include <QTextCodec>
+#include <QtMath>
 #include <QtConcurrent/QtConcurrent>
 
+#include "kncaseconverter.h"
 #include "kntextblockdata.h"
 #include "knglobal.h"
 #include "kntexteditorpanel.h"
 #include "kncodesyntaxhighlighter.h"
 #include "knuimanager.h"
 #include "kndocumentlayout.h"
+#include "knframeprofiler.h"
 
 #include "kntexteditor.h"
 
+//The documents larger than this size only highlight the blocks near the
+//viewport.
+#define VIEWPORT_HIGHLIGHT_SIZE (4194304)
+
 QTextCodec *codecFromName(const char *name)
 {
     return QTextCodec::codecForName(name);
@@ -201,24 +208,44 @@ KNTextEditor::KNTextEditor(const QString &titleName,
                            QWidget *parent, KNSyntaxHighlighter *highlighter,
                            bool linkWithGlobal) :
     QPlainTextEdit(parent),
+    m_columnAnchorBlock(-1),
+    m_columnCaretBlock(-1),
     m_vStartSpacePos(-1),
     m_vEndSpacePos(-1),
-    m_verticalSelect(false),
+    m_columnMaxWidth(-1),
+    m_columnMode(false),
     m_quickSearchSense(Qt::CaseInsensitive),
     m_quickSearchCode(0),
     m_showResults(false),
     m_filePath(QString()),
     m_codecName(codec.toLatin1()),
     m_panel(new KNTextEditorPanel(this)),
+    m_layout(nullptr),
     m_highlighter(nullptr),
-    m_editorOptions(HighlightCursor | CursorDisplay | LineNumberDisplay)
-{
+    m_foldTimer(new QTimer(this)),
+    m_editorOptions(HighlightCursor | CursorDisplay | LineNumberDisplay),
+    m_tileBlockCount(1),
+    m_foldBlockCount(1),
+    m_foldBlock(-1),
+    m_hasFold(false)
+{
+    //Use the editor document layout for the document.
+    QTextDocument *editorDocument = new QTextDocument(this);
+    m_layout = new KNDocumentLayout(editorDocument);
+    editorDocument->setDocumentLayout(m_layout);
+    setDocument(editorDocument);
+    m_tileCache.setBudget(knGlobal->tileCacheBudget() << 10);
     //Set properties.
     setAcceptDrops(false);
     setFrameStyle(QFrame::NoFrame);
     setCursorWidth(0);
     //Configure the extra selections.
     m_currentLine.format.setBackground(QColor(232, 232, 255, 160));
+    //Match the folding ranges after the changes are highlighted.
+    m_foldTimer->setSingleShot(true);
+    m_foldTimer->setInterval(0);
+    connect(m_foldTimer, &QTimer::timeout,
+            this, &KNTextEditor::updateFoldRanges);
     //Update the viewport margins.
     updateViewportMargins();
     if(linkWithGlobal)
@@ -229,6 +256,7 @@ KNTextEditor::KNTextEditor(const QString &titleName,
         onEditorFontChanged();
         onResultDisplayChange(knGlobal->isSearchResultShown());
         onAlignLeftChange(knGlobal->isAlignLeft());
+        m_layout->setLongLineThreshold(knGlobal->longLineThreshold());
         //Link the cursor painting signals.
         addLink(connect(knGlobal->cursorTimer(), &QTimer::timeout,
                         this, &KNTextEditor::onCursorUpdate));
@@ -252,6 +280,8 @@ KNTextEditor::KNTextEditor(const QString &titleName,
             this, &KNTextEditor::onCursorPositionChanged);
     connect(this, &KNTextEditor::textChanged,
             this, &KNTextEditor::onTextChanged);
+    connect(editorDocument, &QTextDocument::contentsChange,
+            this, &KNTextEditor::onContentsChange);
     //Based on the parameter set information.
     if(filePath.isEmpty())
     {
@@ -275,27 +305,38 @@ KNTextEditor::KNTextEditor(const QString &titleName,
     setTextCursor(tc);
 }
 
+KNTextEditor::~KNTextEditor()
+{
+    //Save the highlight result when the document is the same as the file.
+    if(m_highlighter && !m_filePath.isEmpty() && !document()->isModified())
+    {
+        m_highlighter->saveCache(m_filePath);
+    }
+}
+
 void drawFoldMark(QPainter *painter, QRect buttonRect, KNTextBlockData *data)
 {
     //Draw the rect.
     painter->fillRect(buttonRect, QColor(243, 243, 243));
     painter->drawRect(buttonRect);
+    int foldY = (buttonRect.height() >> 1) + buttonRect.y();
+    int foldX = buttonRect.x() + 2;
+    //Draw a central line across the rect.
+    painter->drawLine(foldX, foldY, foldX + buttonRect.width() - 4, foldY);
     if(data->isFold)
     {
-        ;
-    }
-    else
-    {
-        int foldY = (buttonRect.height() >> 1) + buttonRect.y();
-        int foldX = buttonRect.x() + 2;
-        //Draw a central line across the rect.
-        painter->drawLine(foldX, foldY, foldX + buttonRect.width() - 4, foldY);
+        //Draw a plus for the folded range.
+        int centerX = (buttonRect.width() >> 1) + buttonRect.x();
+        int foldTop = buttonRect.y() + 2;
+        painter->drawLine(centerX, foldTop,
+                          centerX, foldTop + buttonRect.height() - 4);
     }
 }
 
 void KNTextEditor::paintSidebar(QPainter *painter, int lineNumWidth,
                                 int markWidth, int foldWidth)
 {
+    KNProfileScope profileScope(KNFrameProfiler::PaintSidebar);
     //Update the painter.
     painter->setFont(font());
     //Paint from the first visible block.
@@ -311,6 +352,12 @@ void KNTextEditor::paintSidebar(QPainter *painter, int lineNumWidth,
     bool drawLineNum = (m_editorOptions & LineNumberDisplay);
     while(block.isValid() && area.y() < height())
     {
+        //Skip the folded blocks.
+        if(!block.isVisible())
+        {
+            block = block.next();
+            continue;
+        }
         //Fetch the block area.
         area = blockBoundingGeometry(block).translated(contentOffset());
         //Check the block number.
@@ -358,6 +405,11 @@ void KNTextEditor::paintSidebar(QPainter *painter, int lineNumWidth,
         foldSize = qMax(foldSize, 2);
         //Draw the center line.
         int hCenter = foldX + (foldSize >> 1);
+        if(!data)
+        {
+            block = block.next();
+            continue;
+        }
         if(data->level)
         {
             painter->drawLine(hCenter, area.y(), hCenter, area.bottom());
@@ -408,6 +460,8 @@ void KNTextEditor::resizeEvent(QResizeEvent *event)
 
 void KNTextEditor::keyPressEvent(QKeyEvent *event)
 {
+    emit keyPressed(event->key(), static_cast<int>(event->modifiers()),
+                    event->text());
     //Shortcut overrides.
     if(event == QKeySequence::Undo) { undo(); event->accept(); return; }
     else if(event == QKeySequence::Redo) { redo(); event->accept(); return; }
@@ -420,8 +474,8 @@ void KNTextEditor::keyPressEvent(QKeyEvent *event)
     {
     case Qt::Key_Escape:
     {
-        //Clear the extra text cursor.
-        clearExtraCursor();
+        //Leave the column mode.
+        clearColumnMode();
         //Update viewport.
         viewport()->update();
         //Update the cursor.
@@ -438,35 +492,19 @@ void KNTextEditor::keyPressEvent(QKeyEvent *event)
         }
         else if(event->modifiers() == Qt::NoModifier)
         {
-            //Check whether we are in extra selection mode.
-            if(isExtraCursorEnabled())
+            //Check whether we are in column mode.
+            if(isColumnMode())
             {
-                int tabSpacing = knGlobal->tabSpacing();
-                auto tc = textCursor();
-                const int insBlock = tc.blockNumber();
-                tc.beginEditBlock();
-                QTextCursor refCursor;
-                //Indent all the extra cursor.
-                for(int i=0; i<m_extraCursors.size(); ++i)
-                {
-                    //Indent the cursor.
-                    auto cc = m_extraCursors.at(i);
-                    insertTabAt(cc, tabSpacing);
-                    cc.setPosition(cc.selectionEnd());
-                    if(insBlock == cc.blockNumber())
-                    {
-                        refCursor = cc;
-                    }
-                    m_extraCursors.replace(i, cc);
-                }
-                tc.endEditBlock();
-                //If vertical mode is enabled, update the position.
-                if(m_verticalSelect)
+                //Insert the same tab text to all the lines of the rectangle.
+                int tabSpacing = knGlobal->tabSpacing(),
+                        left = qMin(m_vStartSpacePos, m_vEndSpacePos);
+                QString tabText = "\t";
+                if(knGlobal->replaceTab())
                 {
-                    //Update the vertical position.
-                    m_vStartSpacePos = spacePosition(refCursor.block(), refCursor.positionInBlock(), tabSpacing);
-                    m_vEndSpacePos = m_vStartSpacePos;
+                    tabText = QString(cellTabSpacing(left, tabSpacing) - left,
+                                      ' ');
                 }
+                columnReplace(QStringList(tabText));
             }
             else
             {
@@ -505,22 +543,24 @@ void KNTextEditor::keyPressEvent(QKeyEvent *event)
         //Alt + Shift + Up / Down: Block select to up / down.
         if(event->modifiers() == (KNG::ALT | KNG::SHIFT))
         {
-            //Check whether the text editor in vertical mode or not.
-            if(!isVerticalEnabled())
+            //Check whether the text editor in column mode or not.
+            if(!isColumnMode())
             {
-                enterVerticalMode();
+                enterColumnMode();
             }
             //Move the cursor one row down or up.
             event->setModifiers(Qt::NoModifier);
             //Do the event.
             QPlainTextEdit::keyPressEvent(event);
-            //Append the new text cursor.
-            appendVerticalCursor(textCursor());
+            //Extend the rectangle to the line of the cursor.
+            m_columnCaretBlock = textCursor().blockNumber();
+            m_columnMaxWidth = -1;
+            moveColumnCaret();
             event->accept();
             return;
         }
         //Cancel the selection.
-        clearExtraCursor();
+        clearColumnMode();
         //Ctrl + Up / Down: Vertical Scroll Up / Down
         if(event->modifiers() == KNG::CTRL)
         {
@@ -584,6 +624,15 @@ void KNTextEditor::keyPressEvent(QKeyEvent *event)
             event->accept();
             return;
         }
+        //The plain text edit could not find the column inside a long block,
+        //move to the next or previous line through the segments.
+        if(!(event->modifiers() & (KNG::CTRL | KNG::ALT | KNG::META)) &&
+                moveLongBlockCursor(event->key() == Qt::Key_Up,
+                                    event->modifiers().testFlag(KNG::SHIFT)))
+        {
+            event->accept();
+            return;
+        }
         break;
     /*
      * Key maps:
@@ -600,217 +649,55 @@ void KNTextEditor::keyPressEvent(QKeyEvent *event)
         //Alt + Shift + Left / Right: Block select to left / right.
         if(event->modifiers() == (KNG::ALT | KNG::SHIFT))
         {
-            if(!isVerticalEnabled())
+            if(!isColumnMode())
             {
-                enterVerticalMode();
+                enterColumnMode();
             }
-            int tabSpacing = knGlobal->tabSpacing();
-            //Move all the extra cursors one character to its left or right.
+            //Move the caret column of the rectangle.
             if(event->key() == Qt::Key_Left)
             {
-                //Check the vertical end pos reaches limit.
-                if(m_vEndSpacePos > 0)
-                {
-                    //Reduce 1 position.
-                    --m_vEndSpacePos;
-                    //Update all the cursors.
-                    for(int i=0; i<m_extraCursors.size(); ++i)
-                    {
-                        auto cc = m_extraCursors.at(i);
-                        auto block = cc.block();
-                        //Move the cursor to the new position.
-                        cc.setPosition(block.position() + textPosition(block, m_vEndSpacePos, tabSpacing),
-                                       QTextCursor::KeepAnchor);
-                        m_extraCursors.replace(i, cc);
-                    }
-                }
-                //Check whether the move could move to next block.
-                auto cc = textCursor();
-                if(cc.positionInBlock() > 0)
-                {
-                    //Move the cursor one row down or up.
-                    event->setModifiers(Qt::NoModifier);
-                    //Do the event.
-                    QPlainTextEdit::keyPressEvent(event);
-                }
+                m_vEndSpacePos = qMax(0, m_vEndSpacePos - 1);
             }
-            else
+            else if(m_vEndSpacePos < columnMaxWidth())
             {
-                //Loop and increase the space position.
-                int expectEndPos = m_vEndSpacePos + 1, actualEndPos = -1;
-                for(int i=0; i<m_extraCursors.size(); ++i)
-                {
-                    auto cc = m_extraCursors.at(i);
-                    //Check the real position.
-                    auto block = cc.block();
-                    //Calculate the text position.
-                    int blockEndPos = textPosition(block, expectEndPos, tabSpacing);
-                    //Update actual end position.
-                    actualEndPos = qMax(actualEndPos, blockEndPos);
-                    //Update the position.
-                    cc.setPosition(block.position() + blockEndPos, QTextCursor::KeepAnchor);
-                    m_extraCursors.replace(i, cc);
-                }
-                //Update the end position.
-                m_vEndSpacePos = actualEndPos;
-                //Check whether the move could move to next block.
-                auto cc = textCursor();
-                if(cc.positionInBlock() < cc.block().length() - 1)
-                {
-                    //Move the cursor one row down or up.
-                    event->setModifiers(Qt::NoModifier);
-                    //Do the event.
-                    QPlainTextEdit::keyPressEvent(event);
-                }
+                ++m_vEndSpacePos;
             }
-            //Update extra selections.
-            updateExtraSelections();
+            moveColumnCaret();
             event->accept();
             return;
         }
         //Or else, cacnel the selection.
-        clearExtraCursor();
+        clearColumnMode();
         break;
     }
     case Qt::Key_Backspace:
-        if(isExtraCursorEnabled())
+    case Qt::Key_Delete:
+        if(isColumnMode())
         {
-            if(m_verticalSelect)
+            //Remove the rectangle, or the characters next to the column.
+            if(m_vStartSpacePos != m_vEndSpacePos)
             {
-                QTextCursor tc = textCursor();
-                tc.beginEditBlock();
-                const int insBlock = tc.blockNumber();
-                //Loop for all the cursors, if they reach the left most
-                //position, stop delete.
-                for(int i=0; i<m_extraCursors.size(); ++i)
-                {
-                    //Check whether the extra cursors works.
-                    auto cc = m_extraCursors.at(i);
-                    if(cc.positionInBlock() > 0)
-                    {
-                        cc.deletePreviousChar();
-                        m_extraCursors.replace(i, cc);
-                        if(cc.blockNumber() == insBlock)
-                        {
-                            //Update the vertical selection value.
-                            m_vStartSpacePos = spacePosition(cc.block(), cc.positionInBlock(), knGlobal->tabSpacing());
-                            m_vEndSpacePos = m_vStartSpacePos;
-                        }
-                    }
-                }
-                tc.endEditBlock();
-                //Update extra selections.
-                updateExtraSelections();
-                event->accept();
-                return;
+                columnReplace(QStringList(QString()));
             }
-        }
-        break;
-    case Qt::Key_Delete:
-        if(isExtraCursorEnabled())
-        {
-            if(m_verticalSelect)
+            else
             {
-                QTextCursor tc = textCursor();
-                tc.beginEditBlock();
-                const int insBlock = tc.blockNumber();
-                //Loop for all the cursors, if they reach the left most
-                //position, stop delete.
-                for(int i=0; i<m_extraCursors.size(); ++i)
-                {
-                    //Check whether the extra cursors works.
-                    auto cc = m_extraCursors.at(i);
-                    if(cc.positionInBlock() != cc.block().length() - 1)
-                    {
-                        cc.deleteChar();
-                        m_extraCursors.replace(i, cc);
-                        if(cc.blockNumber() == insBlock)
-                        {
-                            //Update the vertical selection value.
-                            m_vStartSpacePos = spacePosition(cc.block(), cc.positionInBlock(), knGlobal->tabSpacing());
-                            m_vEndSpacePos = m_vStartSpacePos;
-                        }
-                    }
-                }
-                tc.endEditBlock();
-                //Update extra selections.
-                updateExtraSelections();
-                event->accept();
-                return;
+                columnDelete(event->key() == Qt::Key_Backspace);
             }
+            event->accept();
+            return;
         }
         break;
     default:
     {
         //Check column status.
-        if(isExtraCursorEnabled())
+        if(isColumnMode())
         {
             //Check whether the key press event is selection.
             QString text = event->text();
             if(!text.isEmpty() && (text.at(0).isPrint()))
             {
-                QTextCursor tc = textCursor();
-                tc.beginEditBlock();
-                //Check veritical selection is enabled.
-                if(m_verticalSelect)
-                {
-                    //Loop and find the cursor number.
-                    const int insBlock = tc.blockNumber(),
-                            tabSpacing = knGlobal->tabSpacing();
-                    int insTextPos = qMin(m_vStartSpacePos, m_vEndSpacePos),
-                            currentId = -1;
-                    //Insert the for each line.
-                    for(int i=0; i<m_extraCursors.size(); ++i)
-                    {
-                        auto cc = m_extraCursors.at(i);
-                        QString patchedText = text;
-                        int cursorTextPos = cc.positionInBlock();
-                        if(cc.hasSelection())
-                        {
-                            cursorTextPos = cc.selectionStart() - cc.block().position();
-                        }
-                        //Convert the cursor text pos into space position.
-                        cursorTextPos = spacePosition(cc.block(), cursorTextPos, tabSpacing);
-                        //Check the row selection.
-                        if(cursorTextPos < insTextPos)
-                        {
-                            //Fill the space to the block
-                            patchedText.prepend(QString(insTextPos - cursorTextPos, ' '));
-                            cc.insertText(patchedText);
-                            cc.movePosition(QTextCursor::EndOfBlock, QTextCursor::MoveAnchor);
-                        }
-                        else
-                        {
-                            //Check the text cursor position.
-                            cc.insertText(patchedText);
-                            cc.movePosition(QTextCursor::NextCharacter, QTextCursor::MoveAnchor, patchedText.size());
-                        }
-                        m_extraCursors.replace(i, cc);
-                        //Check the cc position.
-                        if(cc.blockNumber() == insBlock)
-                        {
-                            currentId = i;
-                        }
-                    }
-                    //Check current id.
-                    if(currentId != -1)
-                    {
-                        auto cc = m_extraCursors.at(currentId);
-                        //Update the current position.
-                        tc.setPosition(cc.position());
-                        //Also update the vertical select parameter.
-                        m_vStartSpacePos = spacePosition(cc.block(), cc.positionInBlock(), knGlobal->tabSpacing());
-                        m_vEndSpacePos = m_vStartSpacePos;
-                    }
-                }
-                else
-                {
-                    //Just insert the text and update the cursor.
-                    ;
-                }
-                tc.endEditBlock();
-                //Update the extra selection.
-                updateExtraSelections();
+                //Replace the rectangle with the text.
+                columnReplace(QStringList(text));
                 event->accept();
                 return;
             }
@@ -821,7 +708,7 @@ void KNTextEditor::keyPressEvent(QKeyEvent *event)
     //Do original key press event.
     QPlainTextEdit::keyPressEvent(event);
     //Check the copy validation.
-    if(isExtraCursorEnabled())
+    if(isColumnMode())
     {
         //Check whether the column mates the current offset.
         emit copyAvailable(true);
@@ -836,12 +723,29 @@ void KNTextEditor::mousePressEvent(QMouseEvent *event)
         //Check the event modifier.
         if(event->modifiers() == Qt::NoModifier)
         {
-            //Clear the cursor.
-            clearExtraCursor();
+            //Clear the column selection.
+            clearColumnMode();
         }
     }
     //Do the original event.
     QPlainTextEdit::mousePressEvent(event);
+    //Fix the cursor position when clicking on a long block.
+    if(event->button() == Qt::LeftButton)
+    {
+        moveToLongBlockPos(event->pos(),
+                           event->modifiers().testFlag(KNG::SHIFT));
+    }
+}
+
+void KNTextEditor::mouseMoveEvent(QMouseEvent *event)
+{
+    //Do the original event.
+    QPlainTextEdit::mouseMoveEvent(event);
+    //Fix the selection when dragging on a long block.
+    if(event->buttons() & Qt::LeftButton)
+    {
+        moveToLongBlockPos(event->pos(), true);
+    }
 }
 
 static void fillBackground(QPainter *p, const QRectF &rect, QBrush brush, const QRectF &gradientRect = QRectF())
@@ -863,6 +767,7 @@ static void fillBackground(QPainter *p, const QRectF &rect, QBrush brush, const
 
 void KNTextEditor::paintEvent(QPaintEvent *event)
 {
+    KNProfileScope profileScope(KNFrameProfiler::PaintEditor);
     Q_ASSERT(qobject_cast<QPlainTextDocumentLayout*>(document()->documentLayout()));
     //Update the cursor position.
     QPainter painter(viewport());
@@ -895,8 +800,26 @@ void KNTextEditor::paintEvent(QPaintEvent *event)
     painter.setClipRect(er);
     QAbstractTextDocumentLayout::PaintContext context = getPaintContext();
     painter.setPen(context.palette.text().color());
+    //The cached bands are rendered at the current offset and width.
+    m_tileCache.setGeometry(viewportRect.width(), offset.x());
+    int liveBand = -1;
     while (block.isValid())
     {
+        //Blit the entire band from the tile cache when it is possible.
+        int band = block.blockNumber() / TILE_BAND_BLOCKS;
+        if(band != liveBand)
+        {
+            if(paintBand(&painter, block, offset, context))
+            {
+                if (offset.y() > viewportRect.height())
+                {
+                    break;
+                }
+                continue;
+            }
+            //The blocks of the band have to be painted one by one.
+            liveBand = band;
+        }
         QRectF r = blockBoundingRect(block).translated(offset);
         QTextLayout *layout = block.layout();
         if (!block.isVisible())
@@ -915,7 +838,8 @@ void KNTextEditor::paintEvent(QPaintEvent *event)
                 contentsRect.setWidth(qMax(r.width(), maximumWidth));
                 fillBackground(&painter, contentsRect, bg);
             }
-            QVector<QTextLayout::FormatRange> selections;
+            //The marks are painted under the selections.
+            QVector<QTextLayout::FormatRange> selections = markSelections(block);
             int blpos = block.position();
             int bllen = block.length();
             for (int i = 0; i < context.selections.size(); ++i)
@@ -939,6 +863,8 @@ void KNTextEditor::paintEvent(QPaintEvent *event)
                     // a position to specify the line. that's more convenience in usage.
                     QTextLayout::FormatRange o;
                     QTextLine l = layout->lineForTextPosition(range.cursor.position() - blpos);
+                    if (!l.isValid())
+                        continue;
                     o.start = l.textStart();
                     o.length = l.textLength();
                     if (o.start + o.length == bllen - 1)
@@ -948,7 +874,16 @@ void KNTextEditor::paintEvent(QPaintEvent *event)
                 }
             }
             //Draw the text using block layout.
-            layout->draw(&painter, offset, selections, er);
+            KNFrameProfiler::count(KNFrameProfiler::BlocksPainted);
+            if(m_layout->isLongBlock(block))
+            {
+                //Only draw the segments in the viewport.
+                paintLongBlock(&painter, block, offset, selections, er);
+            }
+            else
+            {
+                layout->draw(&painter, offset, selections, er);
+            }
         }
         offset.ry() += r.height();
         if (offset.y() > viewportRect.height())
@@ -966,14 +901,20 @@ void KNTextEditor::paintEvent(QPaintEvent *event)
     int filter = (CursorDisplay | CursorVisible);
     if((m_editorOptions & filter) == filter)
     {
-        //Draw the extra cursors.
-        QVector<QTextCursor> cursors;
-        cursors.append(textCursor());
-        const QVector<QTextCursor> &renderList = isExtraCursorEnabled() ? m_extraCursors : cursors;
+        //Draw the cursors of all the visible rows in column mode.
+        QVector<QTextCursor> renderList;
+        if(isColumnMode())
+        {
+            renderList = visibleColumnCursors();
+        }
+        else
+        {
+            renderList.append(textCursor());
+        }
         for(int i=0; i<renderList.size(); ++i)
         {
             //Draw the current text cursor.
-            QRect cr = cursorRect(renderList.at(i));
+            QRect cr = textCursorRect(renderList.at(i));
             if(overwriteMode())
             {
                 cr = QRect(cr.x(), cr.bottom() - 1, cr.width(), knUi->height(1));
@@ -1009,8 +950,12 @@ void KNTextEditor::scrollContentsBy(int dx, int dy)
 {
     //Directly update the scroll result.
     QPlainTextEdit::scrollContentsBy(dx, dy);
-    //Update the current selection.
-    updateExtraSelections();
+    //Only the quick search results and the column selection are related to the
+    //visible area.
+    if((!m_quickSearchKeyword.isEmpty() && m_showResults) || isColumnMode())
+    {
+        updateExtraSelections();
+    }
 }
 
 void KNTextEditor::onBlockCountChanged(int newBlockCount)
@@ -1048,17 +993,30 @@ void KNTextEditor::updatePanelArea(const QRect &rect, int dy)
     {
         onBlockCountChanged(blockCount());
     }
+    //Highlight the blocks around the viewport.
+    updateHighlightViewport();
 }
 
 void KNTextEditor::onCursorPositionChanged()
 {
+    //The plain text edit scrolls to the block start of a long block, scroll to
+    //the cursor after it.
+    if(m_layout->isLongBlock(textCursor().block()))
+    {
+        QTimer::singleShot(0, this, &KNTextEditor::ensureLongCursorVisible);
+    }
+    //Show the cursor when it is moved into a folded range.
+    if(m_hasFold && !textCursor().block().isVisible())
+    {
+        unfoldBlock(textCursor().block());
+    }
     //Highlight the current line.
     updateExtraSelections();
     //Emit the signal.
     auto tc = textCursor();
     int posBegin=tc.blockNumber(), posEnd=tc.positionInBlock(),
             selLength = -1, selLines = -1;
-    if(!isExtraCursorEnabled())
+    if(!isColumnMode())
     {
         int selEnd = tc.selectionEnd(), selStart = tc.selectionStart();
         tc.setPosition(selEnd);
@@ -1102,6 +1060,7 @@ void KNTextEditor::onEditorFontChanged()
     //Update the tab stop distance ASAP.
     setTabStopDistance(knGlobal->tabSpacing() *
                        fontMetrics().averageCharWidth());
+    m_tileCache.clear();
 }
 
 void KNTextEditor::onWrapModeChange(bool wrap)
@@ -1109,6 +1068,7 @@ void KNTextEditor::onWrapModeChange(bool wrap)
     //Set the wrap mode.
     setWordWrapMode(wrap ? QTextOption::WrapAtWordBoundaryOrAnywhere :
                            QTextOption::NoWrap);
+    m_tileCache.clear();
 }
 
 void KNTextEditor::onResultDisplayChange(bool showResult)
@@ -1126,6 +1086,53 @@ void KNTextEditor::onAlignLeftChange(bool showLeft)
     auto option = document()->defaultTextOption();
     option.setAlignment(showLeft ? Qt::AlignLeft : Qt::AlignRight);
     document()->setDefaultTextOption(option);
+    m_tileCache.clear();
+}
+
+void KNTextEditor::onContentsChange(int position, int charsRemoved,
+                                    int charsAdded)
+{
+    //Remove the bands of the changed blocks. The highlighter format changes
+    //are also notified here.
+    int lastPosition = document()->characterCount() - 1,
+            startBand = document()->findBlock(
+                qMin(position, lastPosition)).blockNumber() / TILE_BAND_BLOCKS;
+    if(document()->blockCount() != m_tileBlockCount)
+    {
+        //The blocks after the change are moved to the other bands.
+        m_tileBlockCount = document()->blockCount();
+        m_tileCache.remove(startBand);
+    }
+    else
+    {
+        m_tileCache.remove(startBand, document()->findBlock(
+                               qMin(position + charsAdded, lastPosition)).blockNumber()
+                           / TILE_BAND_BLOCKS);
+    }
+    //The folding ranges after the change are moved.
+    if(document()->blockCount() != m_foldBlockCount)
+    {
+        m_foldBlockCount = document()->blockCount();
+        if(!m_folding.isEmpty())
+        {
+            int blockNumber = document()->findBlock(
+                        qMin(position, lastPosition)).blockNumber();
+            m_foldBlock = (m_foldBlock == -1) ? blockNumber :
+                                                qMin(m_foldBlock, blockNumber);
+            m_foldTimer->start();
+        }
+    }
+    //The rows of the rectangle may be changed.
+    if(isColumnMode() && charsRemoved != charsAdded)
+    {
+        m_columnMaxWidth = -1;
+    }
+    //The marks after the change are moved. The format changes of the
+    //highlighter keep the length, the marks are left at their positions.
+    if(charsRemoved != charsAdded && m_marks.count())
+    {
+        m_marks.remap(position, charsRemoved, charsAdded);
+    }
 }
 
 void KNTextEditor::quickSearchUi(const QTextBlock &block)
@@ -1403,8 +1410,283 @@ void KNTextEditor::insertTabAt(QTextCursor &tc, int tabSpacing)
     }
 }
 
+void KNTextEditor::paintLongBlock(
+        QPainter *painter, const QTextBlock &block, const QPointF &offset,
+        const QVector<QTextLayout::FormatRange> &selections, const QRect &clip)
+{
+    //Only shape and draw the segments intersect with the clip area.
+    qreal right = clip.right() - offset.x();
+    int count = m_layout->segmentCount(block);
+    for(int i=m_layout->segmentAt(block, clip.left() - offset.x());
+        i<count && m_layout->segmentX(block, i) <= right; ++i)
+    {
+        QTextLayout *layout = m_layout->segmentLayout(block, i);
+        int segmentStart = m_layout->segmentStart(block, i),
+            segmentEnd = segmentStart + layout->text().length();
+        //Move the selections inside the segment.
+        QVector<QTextLayout::FormatRange> ranges;
+        for(const auto &range : selections)
+        {
+            int start = qMax(range.start, segmentStart),
+                end = qMin(range.start + range.length, segmentEnd);
+            if(start < end)
+            {
+                QTextLayout::FormatRange segmentRange;
+                segmentRange.start = start - segmentStart;
+                segmentRange.length = end - start;
+                segmentRange.format = range.format;
+                ranges.append(segmentRange);
+            }
+        }
+        layout->draw(painter,
+                     offset + QPointF(m_layout->segmentX(block, i), 0),
+                     ranges, clip);
+    }
+}
+
+bool KNTextEditor::paintBand(
+        QPainter *painter, QTextBlock &block, QPointF &offset,
+        const QAbstractTextDocumentLayout::PaintContext &context)
+{
+    //Find the first block of the band, which may start above the viewport.
+    int band = block.blockNumber() / TILE_BAND_BLOCKS;
+    QTextBlock bandBlock = document()->findBlockByNumber(band * TILE_BAND_BLOCKS),
+            lastBlock = bandBlock, bandEnd = bandBlock;
+    qreal bandTop = offset.y(), bandHeight = 0.0;
+    for(QTextBlock i = bandBlock; i.isValid() && i != block; i = i.next())
+    {
+        bandTop -= blockBoundingRect(i).height();
+    }
+    //Long blocks and block backgrounds are painted directly.
+    for(int i=0; i<TILE_BAND_BLOCKS && bandEnd.isValid(); ++i)
+    {
+        if(m_layout->isLongBlock(bandEnd)
+                || bandEnd.blockFormat().background() != Qt::NoBrush)
+        {
+            return false;
+        }
+        bandHeight += blockBoundingRect(bandEnd).height();
+        lastBlock = bandEnd;
+        bandEnd = bandEnd.next();
+    }
+    //Avoid caching a huge band of wrapped lines.
+    if(bandHeight <= 0.0 || bandHeight > (viewport()->height() << 2))
+    {
+        return false;
+    }
+    //The band is painted directly when any selection is inside it.
+    int bandStart = bandBlock.position(),
+            bandStop = lastBlock.position() + lastBlock.length();
+    //The current line highlight is painted under the text, the opaque band
+    //image would cover it.
+    if(m_editorOptions & HighlightCursor)
+    {
+        int cursorPos = textCursor().position();
+        if(cursorPos >= bandStart && cursorPos < bandStop)
+        {
+            return false;
+        }
+    }
+    for(int i=0; i<context.selections.size(); ++i)
+    {
+        const QTextCursor &cursor = context.selections.at(i).cursor;
+        if(cursor.hasSelection())
+        {
+            if(cursor.selectionStart() < bandStop
+                    && cursor.selectionEnd() > bandStart)
+            {
+                return false;
+            }
+        }
+        else if(context.selections.at(i).format.hasProperty(
+                    QTextFormat::FullWidthSelection)
+                && cursor.position() >= bandStart
+                && cursor.position() < bandStop)
+        {
+            return false;
+        }
+    }
+    //Render the band when it is not cached or out of date, the marks of the
+    //band are part of the image.
+    quint64 stamp = KNTileCache::bandStamp(bandBlock) ^
+            m_marks.stamp(bandStart, bandStop);
+    const QImage *image = m_tileCache.band(band, stamp);
+    QImage rendered;
+    if(!image)
+    {
+        qreal ratio = devicePixelRatioF();
+        rendered = QImage(QSize(viewport()->width(), qCeil(bandHeight)) * ratio,
+                          QImage::Format_RGB32);
+        rendered.setDevicePixelRatio(ratio);
+        rendered.fill(viewport()->palette().color(viewport()->backgroundRole()));
+        QPainter bandPainter(&rendered);
+        bandPainter.setPen(context.palette.text().color());
+        qreal y = 0.0;
+        for(QTextBlock i = bandBlock; i.isValid() && i != bandEnd; i = i.next())
+        {
+            if(i.isVisible())
+            {
+                i.layout()->draw(&bandPainter, QPointF(offset.x(), y),
+                                 markSelections(i));
+                y += blockBoundingRect(i).height();
+            }
+        }
+        bandPainter.end();
+        m_tileCache.insert(band, stamp, rendered);
+        image = &rendered;
+    }
+    painter->drawImage(QPointF(0, bandTop), *image);
+    //Move to the block after the band.
+    block = bandEnd;
+    offset.setY(bandTop + bandHeight);
+    return true;
+}
+
+QVector<QTextLayout::FormatRange> KNTextEditor::markSelections(
+        const QTextBlock &block) const
+{
+    QVector<QTextLayout::FormatRange> selections;
+    int position = block.position(), length = block.length();
+    const auto marks = m_marks.marks(position, position + length);
+    for(const KNTextMarks::Mark &mark : marks)
+    {
+        //Clip the mark to the block.
+        QTextLayout::FormatRange range;
+        range.start = qMax(mark.start - position, 0);
+        range.length = qMin(mark.start + mark.length - position, length)
+                - range.start;
+        range.format = knGlobal->markFormat(mark.style);
+        selections.append(range);
+    }
+    return selections;
+}
+
+void KNTextEditor::moveToLongBlockPos(const QPoint &pos, bool keepAnchor)
+{
+    //The plain text edit only hit tests the lines of a block, the position
+    //inside a long block has to be find through its segments.
+    QTextBlock block = cursorForPosition(pos).block();
+    if(!m_layout->isLongBlock(block))
+    {
+        return;
+    }
+    qreal x = pos.x() -
+            blockBoundingGeometry(block).translated(contentOffset()).left();
+    //Update the text cursor.
+    QTextCursor tc = textCursor();
+    tc.setPosition(block.position() + m_layout->hitTestLongBlock(block, x),
+                   keepAnchor ? QTextCursor::KeepAnchor :
+                                QTextCursor::MoveAnchor);
+    setTextCursor(tc);
+}
+
+bool KNTextEditor::moveLongBlockCursor(bool up, bool keepAnchor)
+{
+    //Find the visible block above or below the cursor.
+    QTextCursor tc = textCursor();
+    QTextBlock block = tc.block(), target = up ? block.previous() : block.next();
+    while(target.isValid() && !target.isVisible())
+    {
+        target = up ? target.previous() : target.next();
+    }
+    bool isLong = m_layout->isLongBlock(block);
+    if(!target.isValid() || (!isLong && !m_layout->isLongBlock(target)))
+    {
+        return false;
+    }
+    //Get the x position of the cursor.
+    qreal x = 0.0;
+    if(isLong)
+    {
+        x = m_layout->cursorToXLongBlock(block, tc.positionInBlock());
+    }
+    else
+    {
+        //Moving between the wrapped lines is done by the plain text edit.
+        QTextLayout *layout = block.layout();
+        QTextLine line = layout->lineForTextPosition(tc.positionInBlock());
+        if(line.isValid())
+        {
+            if(up ? line.lineNumber() > 0 :
+                    line.lineNumber() < layout->lineCount() - 1)
+            {
+                return false;
+            }
+            x = line.cursorToX(tc.positionInBlock());
+        }
+    }
+    //Find the position at the same x in the target block.
+    int position = 0;
+    if(m_layout->isLongBlock(target))
+    {
+        position = m_layout->hitTestLongBlock(target, x);
+    }
+    else
+    {
+        //Make sure the target block is laid out.
+        blockBoundingRect(target);
+        QTextLayout *layout = target.layout();
+        if(layout->lineCount())
+        {
+            position = layout->lineAt(up ? layout->lineCount() - 1 : 0)
+                    .xToCursor(x);
+        }
+    }
+    tc.setPosition(target.position() + position,
+                   keepAnchor ? QTextCursor::KeepAnchor :
+                                QTextCursor::MoveAnchor);
+    setTextCursor(tc);
+    return true;
+}
+
+QRect KNTextEditor::textCursorRect(const QTextCursor &cursor)
+{
+    //The cursor rect of the plain text edit could not find the cursor inside a
+    //long block.
+    QTextBlock block = cursor.block();
+    if(!m_layout->isLongBlock(block))
+    {
+        return cursorRect(cursor);
+    }
+    QRectF blockRect = blockBoundingGeometry(block).translated(contentOffset());
+    return QRectF(blockRect.left() +
+                  m_layout->cursorToXLongBlock(block, cursor.positionInBlock()),
+                  blockRect.top(), 1, blockRect.height()).toRect();
+}
+
+void KNTextEditor::ensureLongCursorVisible()
+{
+    QTextCursor tc = textCursor();
+    QTextBlock block = tc.block();
+    if(!m_layout->isLongBlock(block) || !block.isVisible())
+    {
+        return;
+    }
+    //Scroll to the line of the block.
+    QRect visible = viewport()->rect(), cr = textCursorRect(tc);
+    if(cr.top() < visible.top())
+    {
+        verticalScrollBar()->setValue(block.firstLineNumber());
+        cr = textCursorRect(tc);
+    }
+    else if(cr.bottom() > visible.bottom())
+    {
+        verticalScrollBar()->setValue(
+                    block.firstLineNumber() + 1 -
+                    visible.height() / qMax(1, cr.height()));
+        cr = textCursorRect(tc);
+    }
+    //Scroll to the cursor inside the block.
+    if(cr.left() < visible.left() || cr.right() > visible.right())
+    {
+        horizontalScrollBar()->setValue(horizontalScrollBar()->value() +
+                                        cr.center().x() - visible.center().x());
+    }
+}
+
 void KNTextEditor::updateExtraSelections()
 {
+    KNProfileScope profileScope(KNFrameProfiler::ExtraSelections);
     //Construct the selection list.
     QList<QTextEdit::ExtraSelection> selections;
     //Current lines.
@@ -1418,21 +1700,24 @@ void KNTextEditor::updateExtraSelections()
     if(!m_connections.isEmpty())
     {
         //No need to maintain extra selection in this case.
-        //Column selections.
-        if(isExtraCursorEnabled())
+        //Column selections, only the visible rows are selected.
+        if(isColumnMode())
         {
             //Construct the format.
             QTextCharFormat format;
             format.setBackground(palette().brush(QPalette::Highlight));
             format.setForeground(palette().brush(QPalette::HighlightedText));
-            //Construct the block start.
-            for(auto cc : m_extraCursors)
+            const auto cursors = visibleColumnCursors();
+            for(const auto &cc : cursors)
             {
                 //Construct the selection.
-                QTextEdit::ExtraSelection selection;
-                selection.cursor = cc;
-                selection.format = format;
-                selections.append(selection);
+                if(cc.hasSelection())
+                {
+                    QTextEdit::ExtraSelection selection;
+                    selection.cursor = cc;
+                    selection.format = format;
+                    selections.append(selection);
+                }
             }
         }
 
@@ -1474,11 +1759,21 @@ void KNTextEditor::updateExtraSelections()
         }
     }
 
+    KNFrameProfiler::count(KNFrameProfiler::SelectionsProcessed,
+                           selections.size());
     setExtraSelections(selections);
 }
 
 void KNTextEditor::updateHighlighter(KNSyntaxHighlighter *highlighter)
 {
+    //The folding ranges are matched by the new highlighter.
+    m_folding.clear();
+    m_foldBlock = -1;
+    m_foldBlockCount = document()->blockCount();
+    if(m_hasFold)
+    {
+        updateFoldVisibility(0, document()->blockCount() - 1);
+    }
     //Check the previous highlighter.
     if(m_highlighter)
     {
@@ -1501,12 +1796,34 @@ void KNTextEditor::updateHighlighter(KNSyntaxHighlighter *highlighter)
     //Check whether the highlighter is null.
     if(m_highlighter)
     {
-        //Update the panel based on the highlighter.
-        m_panel->setShowFold(m_highlighter->hasCodeLevel());
+        //Update the panel based on the highlighter. Only the visible part of
+        //the large document is highlighted, the ranges could not be matched
+        //from the markers of the highlighted blocks, so it could not be folded.
+        bool viewportMode =
+                document()->characterCount() > VIEWPORT_HIGHLIGHT_SIZE;
+        m_panel->setShowFold(m_highlighter->hasCodeLevel() && !viewportMode);
         onBlockCountChanged(document()->blockCount());
         //Configure the highlighter.
+        connect(m_highlighter, &KNSyntaxHighlighter::regionsChanged,
+                this, [=]{ m_foldTimer->start(); });
+        if(!m_filePath.isEmpty())
+        {
+            //Reuse the highlight result of the last time the file is opened.
+            m_highlighter->loadCache(m_filePath);
+        }
         m_highlighter->setDocument(document());
-        m_highlighter->rehighlight();
+        if(viewportMode)
+        {
+            m_highlighter->setViewportMode(true);
+            updateHighlightViewport();
+        }
+        else
+        {
+            //Highlight the visible blocks before the others.
+            int firstBlock, lastBlock;
+            visibleBlockRange(firstBlock, lastBlock);
+            m_highlighter->rehighlightInBackground(firstBlock, lastBlock);
+        }
     }
     else
     {
@@ -1515,52 +1832,401 @@ void KNTextEditor::updateHighlighter(KNSyntaxHighlighter *highlighter)
     }
 }
 
-int KNTextEditor::spacePosition(const QTextBlock &block, int textPos,
-                                int tabSpacing)
+void KNTextEditor::updateHighlightViewport()
 {
-    //Based on the position and the characters, calculate the current characters.
-    int column = 0;
-    QString &&blockText = block.text();
-    for (int i=0; i<textPos; ++i)
+    if(!m_highlighter || !m_highlighter->isViewportMode())
     {
-        //Check whether the iteration is \t.
-        if(blockText.at(i) == '\t')
-        {
-            //Find the nearest variable.
-            column = cellTabSpacing(column, tabSpacing);
-            continue;
-        }
-        //Simply increase a char.
-        column += charAsianWidth(blockText.at(i));
+        return;
     }
-    return column;
+    int firstBlock, lastBlock;
+    visibleBlockRange(firstBlock, lastBlock);
+    m_highlighter->setViewport(firstBlock, lastBlock);
 }
 
-int KNTextEditor::textPosition(const QTextBlock &block, int spacePos,
-                               int tabSpacing)
+void KNTextEditor::visibleBlockRange(int &firstBlock, int &lastBlock)
 {
-    //For empty checking.
-    if(spacePos == 0)
-    {
-        return 0;
-    }
-    //Loop and reduce the space pos, until it down to 0, then that is the space
-    //pos.
-    QString &&blockText = block.text();
-    for (int i=0; i<blockText.size(); ++i)
+    //Find the last block in the viewport.
+    QTextBlock block = firstVisibleBlock(), visibleBlock = block;
+    firstBlock = block.blockNumber();
+    qreal top = blockBoundingGeometry(block).translated(contentOffset()).top();
+    while(block.isValid() && top < viewport()->height())
     {
-        int charWidth = blockText.at(i) == '\t' ? tabSpacing : charAsianWidth(blockText.at(i));
-        spacePos -= charWidth;
-        if(spacePos <= 0)
-        {
-            return i + 1;
-        }
+        visibleBlock = block;
+        top += blockBoundingRect(block).height();
+        block = block.next();
     }
-    //Or else, it should be the end of the string.
-    return blockText.size();
+    lastBlock = visibleBlock.blockNumber();
 }
 
-QString KNTextEditor::textLevelString(int spaceLevel, int tabSpacing)
+void KNTextEditor::toggleFoldAt(int y)
+{
+    //Find the visible block at the position.
+    QTextBlock block = firstVisibleBlock();
+    qreal top = blockBoundingGeometry(block).translated(contentOffset()).top();
+    while(block.isValid())
+    {
+        qreal bottom = top + blockBoundingRect(block).height();
+        if(block.isVisible() && y >= top && y < bottom)
+        {
+            break;
+        }
+        if(top > viewport()->height())
+        {
+            return;
+        }
+        top = bottom;
+        block = block.next();
+    }
+    int rangeIndex = block.isValid() ? m_folding.rangeAt(block.blockNumber())
+                                     : -1;
+    if(rangeIndex == -1)
+    {
+        return;
+    }
+    setFolded(rangeIndex, !isFolded(rangeIndex));
+}
+
+void KNTextEditor::addMarks(const QVector<KNTextMarks::Mark> &marks,
+                            bool bookmarkLine)
+{
+    m_marks.add(marks);
+    if(bookmarkLine && !marks.isEmpty())
+    {
+        //Walk through the blocks along the sorted marks.
+        QTextBlock block = document()->begin();
+        for(const KNTextMarks::Mark &mark : marks)
+        {
+            while(block.isValid() &&
+                  block.position() + block.length() <= mark.start)
+            {
+                block = block.next();
+            }
+            if(!block.isValid())
+            {
+                break;
+            }
+            KNTextBlockData *data = blockData(block);
+            if(!data)
+            {
+                data = new KNTextBlockData;
+                block.setUserData(data);
+            }
+            data->hasBookmark = true;
+        }
+        m_panel->update();
+    }
+    viewport()->update();
+}
+
+void KNTextEditor::clearMarks()
+{
+    m_marks.clear();
+    viewport()->update();
+}
+
+void KNTextEditor::foldAll()
+{
+    setAllFolded(true);
+}
+
+void KNTextEditor::unfoldAll()
+{
+    setAllFolded(false);
+}
+
+void KNTextEditor::foldCurrentLevel()
+{
+    //Fold the innermost range which is still expanded.
+    const auto indexes = m_folding.rangesContaining(textCursor().blockNumber());
+    for(int i=indexes.size() - 1; i>-1; --i)
+    {
+        if(!isFolded(indexes.at(i)))
+        {
+            setFolded(indexes.at(i), true);
+            return;
+        }
+    }
+}
+
+void KNTextEditor::unfoldCurrentLevel()
+{
+    const auto indexes = m_folding.rangesContaining(textCursor().blockNumber());
+    for(int i=indexes.size() - 1; i>-1; --i)
+    {
+        if(isFolded(indexes.at(i)))
+        {
+            setFolded(indexes.at(i), false);
+            return;
+        }
+    }
+}
+
+void KNTextEditor::updateFoldRanges()
+{
+    if(!m_highlighter)
+    {
+        return;
+    }
+    //Match the ranges again from the first block whose region markers are
+    //changed or moved.
+    int firstBlock = m_highlighter->takeRegionsChanged();
+    bool moved = m_foldBlock != -1;
+    if(moved)
+    {
+        firstBlock = (firstBlock == -1) ? m_foldBlock :
+                                          qMin(firstBlock, m_foldBlock);
+        m_foldBlock = -1;
+    }
+    if(firstBlock == -1 || m_highlighter->isViewportMode())
+    {
+        return;
+    }
+    //Only the blocks of the folded ranges which are matched again may change
+    //the visibility. The moved ranges are not checked by the fold state, their
+    //start blocks are out of date.
+    int hideStart = document()->blockCount(), hideEnd = -1;
+    if(m_hasFold)
+    {
+        foldedSpan(firstBlock, !moved, hideStart, hideEnd);
+    }
+    m_folding.rebuild(document(), firstBlock);
+    if(m_hasFold)
+    {
+        foldedSpan(firstBlock, true, hideStart, hideEnd);
+        if(hideEnd != -1)
+        {
+            updateFoldVisibility(hideStart, hideEnd);
+        }
+    }
+    m_panel->update();
+}
+
+void KNTextEditor::foldedSpan(int firstBlock, bool checkFold, int &start,
+                              int &end)
+{
+    for(int i=0; i<m_folding.count(); ++i)
+    {
+        const KNCodeFolding::Range &range = m_folding.range(i);
+        if(range.end >= firstBlock && (!checkFold || isFolded(i)))
+        {
+            start = qMin(start, range.start + 1);
+            end = qMax(end, range.end);
+        }
+    }
+}
+
+void KNTextEditor::setAllFolded(bool fold)
+{
+    if(!m_folding.count())
+    {
+        return;
+    }
+    //Update the fold state of all the range starts, then update the visibility
+    //in one pass.
+    for(QTextBlock block = document()->begin(); block.isValid();
+        block = block.next())
+    {
+        auto data = blockData(block);
+        if(data)
+        {
+            data->isFold = fold && data->levelMargin > 0;
+        }
+    }
+    updateFoldVisibility(0, document()->blockCount() - 1);
+    if(fold && !textCursor().block().isVisible())
+    {
+        //Move the cursor out of the folded blocks.
+        QTextCursor tc = textCursor();
+        tc.setPosition(document()->findBlockByNumber(
+                           m_folding.range(m_folding.rangesContaining(
+                                               tc.blockNumber()).first()).start).position());
+        setTextCursor(tc);
+    }
+}
+
+void KNTextEditor::setFolded(int rangeIndex, bool fold)
+{
+    const KNCodeFolding::Range &range = m_folding.range(rangeIndex);
+    QTextBlock startBlock = document()->findBlockByNumber(range.start);
+    auto data = blockData(startBlock);
+    if(!data || data->isFold == fold)
+    {
+        return;
+    }
+    data->isFold = fold;
+    //Only the blocks of the range are changed. The outermost range at the
+    //block covers all the other ranges start at the block.
+    const KNCodeFolding::Range &outerRange =
+            m_folding.range(m_folding.rangeAt(range.start));
+    updateFoldVisibility(range.start + 1, outerRange.end);
+    if(fold && !textCursor().block().isVisible())
+    {
+        //Move the cursor to the end of the folded block.
+        QTextCursor tc = textCursor();
+        tc.setPosition(startBlock.position() + startBlock.length() - 1);
+        setTextCursor(tc);
+    }
+}
+
+bool KNTextEditor::isFolded(int rangeIndex)
+{
+    auto data = blockData(document()->findBlockByNumber(
+                              m_folding.range(rangeIndex).start));
+    return data && data->isFold;
+}
+
+void KNTextEditor::updateFoldVisibility(int firstBlock, int lastBlock)
+{
+    //Find the folded ranges before the first block which cover it.
+    int hideEnd = -1;
+    const auto indexes = m_folding.rangesContaining(firstBlock);
+    for(int index : indexes)
+    {
+        const KNCodeFolding::Range &range = m_folding.range(index);
+        if(range.start < firstBlock && isFolded(index))
+        {
+            hideEnd = qMax(hideEnd, range.end);
+        }
+    }
+    //Sweep the blocks, the folded ranges start in the blocks are added when
+    //their start blocks are passed.
+    int rangeIndex = m_folding.lowerBound(firstBlock), rangeCount = m_folding.count(),
+            dirtyStart = -1, dirtyEnd = -1;
+    bool hasFold = false;
+    QTextBlock block = document()->findBlockByNumber(firstBlock);
+    for(int blockNumber = firstBlock;
+        block.isValid() && blockNumber <= lastBlock;
+        ++blockNumber, block = block.next())
+    {
+        bool visible = blockNumber > hideEnd;
+        if(block.isVisible() != visible)
+        {
+            block.setVisible(visible);
+            if(dirtyStart == -1)
+            {
+                dirtyStart = block.position();
+            }
+            dirtyEnd = block.position() + block.length();
+        }
+        hasFold = hasFold || !visible;
+        if(rangeIndex < rangeCount &&
+                m_folding.range(rangeIndex).start == blockNumber)
+        {
+            auto data = blockData(block);
+            bool folded = data && data->isFold;
+            while(rangeIndex < rangeCount &&
+                  m_folding.range(rangeIndex).start == blockNumber)
+            {
+                if(folded)
+                {
+                    hideEnd = qMax(hideEnd, m_folding.range(rangeIndex).end);
+                }
+                ++rangeIndex;
+            }
+        }
+    }
+    //Only a full sweep knows whether any block is still hidden.
+    if(firstBlock == 0 && !block.isValid())
+    {
+        m_hasFold = hasFold;
+    }
+    else
+    {
+        m_hasFold = m_hasFold || hasFold;
+    }
+    //Relayout all the changed blocks at once.
+    if(dirtyStart != -1)
+    {
+        document()->markContentsDirty(dirtyStart, dirtyEnd - dirtyStart);
+        viewport()->update();
+        m_panel->update();
+    }
+}
+
+void KNTextEditor::unfoldBlock(const QTextBlock &block)
+{
+    //Unfold all the folded ranges which hide the block.
+    const auto indexes = m_folding.rangesContaining(block.blockNumber());
+    int firstBlock = -1, lastBlock = -1;
+    for(int index : indexes)
+    {
+        const KNCodeFolding::Range &range = m_folding.range(index);
+        auto data = blockData(document()->findBlockByNumber(range.start));
+        if(range.start < block.blockNumber() && data && data->isFold)
+        {
+            data->isFold = false;
+            if(firstBlock == -1)
+            {
+                firstBlock = range.start + 1;
+            }
+            lastBlock = qMax(lastBlock, range.end);
+        }
+    }
+    if(firstBlock == -1)
+    {
+        //The block is hidden by a range which no longer exists.
+        updateFoldVisibility(0, document()->blockCount() - 1);
+        return;
+    }
+    updateFoldVisibility(firstBlock, lastBlock);
+}
+
+int KNTextEditor::spacePosition(const QTextBlock &block, int textPos,
+                                int tabSpacing)
+{
+    return spacePosition(block.text(), textPos, tabSpacing);
+}
+
+int KNTextEditor::spacePosition(const QString &blockText, int textPos,
+                                int tabSpacing)
+{
+    //Based on the position and the characters, calculate the current characters.
+    int column = 0;
+    for (int i=0; i<textPos; ++i)
+    {
+        //Check whether the iteration is \t.
+        if(blockText.at(i) == '\t')
+        {
+            //Find the nearest variable.
+            column = cellTabSpacing(column, tabSpacing);
+            continue;
+        }
+        //Simply increase a char.
+        column += charAsianWidth(blockText.at(i));
+    }
+    return column;
+}
+
+int KNTextEditor::textPosition(const QTextBlock &block, int spacePos,
+                               int tabSpacing)
+{
+    return textPosition(block.text(), spacePos, tabSpacing);
+}
+
+int KNTextEditor::textPosition(const QString &blockText, int spacePos,
+                               int tabSpacing)
+{
+    //For empty checking.
+    if(spacePos == 0)
+    {
+        return 0;
+    }
+    //Loop and reduce the space pos, until it down to 0, then that is the space
+    //pos.
+    for (int i=0; i<blockText.size(); ++i)
+    {
+        int charWidth = blockText.at(i) == '\t' ? tabSpacing : charAsianWidth(blockText.at(i));
+        spacePos -= charWidth;
+        if(spacePos <= 0)
+        {
+            return i + 1;
+        }
+    }
+    //Or else, it should be the end of the string.
+    return blockText.size();
+}
+
+QString KNTextEditor::textLevelString(int spaceLevel, int tabSpacing)
 {
     if(knGlobal->replaceTab())
     {
@@ -1574,6 +2240,11 @@ QString KNTextEditor::textLevelString(int spaceLevel, int tabSpacing)
     return QString(tabLevel, '\t') + QString(remainSpaces, ' ');
 }
 
+int KNTextEditor::charWidth(const QChar &c)
+{
+    return charAsianWidth(c);
+}
+
 int KNTextEditor::cellTabSpacing(int spacePos, int tabSpacing)
 {
     int nc = (spacePos / tabSpacing) * tabSpacing;
@@ -1591,10 +2262,10 @@ QString KNTextEditor::codecName() const
 
 QString KNTextEditor::selectedText() const
 {
-    //If we have extra cursors, we have to generate the column text.
-    if(isExtraCursorEnabled())
+    //In column mode, we have to generate the column text.
+    if(isColumnMode())
     {
-        return extraCursorText();
+        return columnText();
     }
     //Or just extract from the current text cursor.
     return textCursor().selectedText();
@@ -1746,7 +2417,7 @@ void KNTextEditor::moveCurrentBlockDown()
 void KNTextEditor::undo()
 {
     //Clear the column selection.
-    clearExtraCursor();
+    clearColumnMode();
     //Do undo.
     QPlainTextEdit::undo();
 }
@@ -1754,7 +2425,7 @@ void KNTextEditor::undo()
 void KNTextEditor::redo()
 {
     //Clear the column selection.
-    clearExtraCursor();
+    clearColumnMode();
     //Do redo.
     QPlainTextEdit::redo();
 }
@@ -1762,24 +2433,11 @@ void KNTextEditor::redo()
 void KNTextEditor::cut()
 {
     //Check column selection.
-    if(isExtraCursorEnabled())
+    if(isColumnMode())
     {
-        //Do extra cursor copy.
-        extraCursorCopy();
-        QTextCursor tc = textCursor();
-        tc.beginEditBlock();
-        //Remove all these column.
-        for(int i=0; i<m_extraCursors.size(); ++i)
-        {
-            auto cc = m_extraCursors.at(i);
-            //Remove the selection.
-            tc.setPosition(m_extraCursors.at(i).selectionStart());
-            tc.setPosition(m_extraCursors.at(i).selectionEnd(), QTextCursor::KeepAnchor);
-            tc.removeSelectedText();
-            cc.setPosition(tc.position());
-            m_extraCursors.replace(i, cc);
-        }
-        tc.endEditBlock();
+        //Copy and remove the rectangle.
+        columnCopy();
+        columnReplace(QStringList(QString()));
         return;
     }
     //Do original cut.
@@ -1789,10 +2447,10 @@ void KNTextEditor::cut()
 void KNTextEditor::copy()
 {
     //Check column selection.
-    if(isExtraCursorEnabled())
+    if(isColumnMode())
     {
         //Do column copy.
-        extraCursorCopy();
+        columnCopy();
         return;
     }
     //Do original copy.
@@ -1802,56 +2460,20 @@ void KNTextEditor::copy()
 void KNTextEditor::paste()
 {
     //Check column selection.
-    if(isExtraCursorEnabled())
+    if(isColumnMode())
     {
-        //Do extra cursor paste here.
-        auto textLines = knGlobal->clipboardText().split('\n');
-        //Check the line length.
-        if(textLines.size() > m_extraCursors.size())
-        {
-            textLines = textLines.mid(0, textLines.size());
-        }
-        //Check whether the text is in vertical mode.
-        if(m_verticalSelect)
+        //Paste the lines to the rows of the rectangle one by one.
+        const QStringList textLines = knGlobal->clipboardText().split('\n');
+        columnReplace(textLines);
+        //The rectangle is kept only when all the lines are in the same length.
+        for(int i=1; i<textLines.size(); ++i)
         {
-            //Check whether the text lines are all the same.
-            int initLength = textLines.at(0).length();
-            bool keepVerticalMode = true;
-            for(int i=1; i<textLines.size(); ++i)
-            {
-                if(textLines.at(i).size() != initLength)
-                {
-                    keepVerticalMode = false;
-                    break;
-                }
-            }
-            //Check the vertical mode.
-            if(!keepVerticalMode)
+            if(textLines.at(i).size() != textLines.at(0).size())
             {
-                m_verticalSelect = false;
+                clearColumnMode();
+                break;
             }
         }
-        //Sort the cursor.
-        std::sort(m_extraCursors.begin(), m_extraCursors.end(),
-                  [=](const QTextCursor &a, const QTextCursor &b)
-        {
-            //Check the block number.
-            return a.blockNumber() < b.blockNumber();
-        });
-        //Now insert the content.
-        int textLineNum = 0;
-        for(int i=0; i<m_extraCursors.size(); ++i)
-        {
-            auto cc = m_extraCursors.at(i);
-            //Insert the text to the cursor.
-            cc.insertText(textLines.at(textLineNum));
-            cc.setPosition(cc.selectionEnd());
-            m_extraCursors.replace(i, cc);
-            //Move the text line number to the next one.
-            textLineNum = ((textLineNum + 1) == textLines.size()) ? 0 : (textLineNum + 1);
-        }
-        //Update the extra cursors.
-        updateExtraSelections();
         return;
     }
     //Do original paste.
@@ -1974,129 +2596,241 @@ void KNTextEditor::updateViewportMargins()
     setViewportMargins(m_panel->width(), 0, 0, 0);
 }
 
-void KNTextEditor::extraCursorCopy()
+void KNTextEditor::columnCopy()
 {
     //Set the column text to clipboard.
-    knGlobal->copyText(extraCursorText());
+    knGlobal->copyText(columnText());
 }
 
-QString KNTextEditor::extraCursorText() const
+QString KNTextEditor::columnText() const
 {
+    int tabSpacing = knGlobal->tabSpacing(),
+            left = qMin(m_vStartSpacePos, m_vEndSpacePos),
+            right = qMax(m_vStartSpacePos, m_vEndSpacePos),
+            firstBlock = qMin(m_columnAnchorBlock, m_columnCaretBlock),
+            lastBlock = qMax(m_columnAnchorBlock, m_columnCaretBlock);
     QStringList columnText;
-    columnText.reserve(m_extraCursors.size());
-    for(auto cc : m_extraCursors)
+    columnText.reserve(lastBlock - firstBlock + 1);
+    QTextBlock block = document()->findBlockByNumber(firstBlock);
+    for(int i=firstBlock; i<=lastBlock && block.isValid();
+        ++i, block = block.next())
     {
-        columnText.append(cc.selectedText());
+        QString blockText = block.text();
+        int start = textPosition(blockText, left, tabSpacing);
+        columnText.append(blockText.mid(
+                              start,
+                              textPosition(blockText, right, tabSpacing) - start));
     }
     //Set the selection text.
     return columnText.join("\n");
 }
 
-
-void KNTextEditor::clearExtraCursor()
+void KNTextEditor::clearColumnMode()
 {
-    if(!isExtraCursorEnabled())
+    if(!isColumnMode())
     {
         return;
     }
-    //Reset the vertical selection mode.
-    m_verticalSelect = false;
-    //Update the current cursor position.
-    auto tc = textCursor();
-    for(auto cc : m_extraCursors)
-    {
-        if(cc.blockNumber() == tc.blockNumber())
-        {
-            tc.setPosition(cc.position());
-            break;
-        }
-    }
-    //Clear the extra cursors.
-    m_extraCursors.clear();
-    //Update the text cursor.
-    setTextCursor(tc);
+    //The text cursor is already at the caret of the rectangle.
+    m_columnMode = false;
     //Update the extra selections, which also update the editor.
     updateExtraSelections();
+    viewport()->update();
 }
 
-void KNTextEditor::enterVerticalMode()
+void KNTextEditor::enterColumnMode()
 {
-    //Enter the extra cursor mode.
-    m_verticalSelect = true;
-    m_extraCursors.clear();
     int tabSpacing = knGlobal->tabSpacing();
-    //Check whether the text cursor is already contains selection.
-    auto currentCursor = textCursor();
-    if(currentCursor.hasSelection())
-    {
-        //Check whether the text cursor is at start or the end of the selection.
-        bool atStart = currentCursor.position() == currentCursor.selectionStart();
-        //Calculate the vertical start position.
-        QTextCursor refCursor = textCursor();
-        refCursor.setPosition(atStart ? currentCursor.selectionEnd() : currentCursor.selectionStart());
-        m_vStartSpacePos = spacePosition(refCursor.block(), refCursor.positionInBlock(), tabSpacing);
-        //Calculate the current end position.
-        refCursor.setPosition(atStart ? currentCursor.selectionStart() : currentCursor.selectionEnd());
-        m_vEndSpacePos = spacePosition(refCursor.block(), refCursor.positionInBlock(), tabSpacing);
-        auto doc = document();
-        //Update all the block during the selection.
-        refCursor.setPosition(currentCursor.selectionStart());
-        int blockStart = refCursor.blockNumber();
-        refCursor.setPosition(currentCursor.selectionEnd());
-        int blockEnd = refCursor.blockNumber();
-        for(int i = qMin(blockStart, blockEnd),
-             iMax = qMax(blockStart, blockEnd); i <= iMax; ++i)
-        {
-            auto block = doc->findBlockByNumber(i);
-            refCursor.setPosition(block.position() + textPosition(block, m_vEndSpacePos, tabSpacing));
-            appendVerticalCursor(refCursor);
-        }
-        return;
-    }
-    //Set the vertical space position.
-    m_vStartSpacePos = spacePosition(
-                textCursor().block(), textCursor().positionInBlock(),
-                knGlobal->tabSpacing());
-    m_vEndSpacePos = m_vStartSpacePos;
-    //Append the vertical text cursor.
-    appendVerticalCursor(textCursor());
+    //The rectangle is from the anchor to the position of the text cursor.
+    QTextCursor tc = textCursor(), anchorCursor = tc;
+    anchorCursor.setPosition(tc.anchor());
+    m_columnAnchorBlock = anchorCursor.blockNumber();
+    m_vStartSpacePos = spacePosition(anchorCursor.block(),
+                                     anchorCursor.positionInBlock(), tabSpacing);
+    m_columnCaretBlock = tc.blockNumber();
+    m_vEndSpacePos = spacePosition(tc.block(), tc.positionInBlock(),
+                                   tabSpacing);
+    m_columnMaxWidth = -1;
+    m_columnMode = true;
+    //The rectangle is displayed as extra selections.
+    tc.clearSelection();
+    setTextCursor(tc);
 }
 
-bool KNTextEditor::isExtraCursorEnabled() const
+bool KNTextEditor::isColumnMode() const
 {
-    return !m_extraCursors.isEmpty();
+    return m_columnMode;
 }
 
-bool KNTextEditor::isVerticalEnabled() const
+void KNTextEditor::moveColumnCaret()
 {
-    return m_verticalSelect && isExtraCursorEnabled();
+    //Move the text cursor to the caret of the rectangle.
+    QTextBlock block = document()->findBlockByNumber(m_columnCaretBlock);
+    QTextCursor tc = textCursor();
+    tc.setPosition(block.position() + textPosition(block, m_vEndSpacePos,
+                                                   knGlobal->tabSpacing()));
+    setTextCursor(tc);
+    //Update the rectangle.
+    updateExtraSelections();
+}
+
+int KNTextEditor::columnMaxWidth()
+{
+    //Reuse the width until the rows or the text are changed.
+    if(m_columnMaxWidth > -1)
+    {
+        return m_columnMaxWidth;
+    }
+    int tabSpacing = knGlobal->tabSpacing(), maxWidth = 0,
+            lastBlock = qMax(m_columnAnchorBlock, m_columnCaretBlock);
+    QTextBlock block = document()->findBlockByNumber(
+                qMin(m_columnAnchorBlock, m_columnCaretBlock));
+    for(int i=block.blockNumber(); i<=lastBlock && block.isValid();
+        ++i, block = block.next())
+    {
+        QString blockText = block.text();
+        maxWidth = qMax(maxWidth, spacePosition(blockText, blockText.size(),
+                                                tabSpacing));
+    }
+    m_columnMaxWidth = maxWidth;
+    return maxWidth;
 }
 
-void KNTextEditor::appendVerticalCursor(QTextCursor cursor)
+QVector<QTextCursor> KNTextEditor::visibleColumnCursors() const
 {
-    //Search the cursor in the list.
-    int cursorBlock = cursor.blockNumber();
-    for(auto tc : m_extraCursors)
+    QVector<QTextCursor> cursors;
+    int tabSpacing = knGlobal->tabSpacing(),
+            firstBlock = qMin(m_columnAnchorBlock, m_columnCaretBlock),
+            lastBlock = qMax(m_columnAnchorBlock, m_columnCaretBlock);
+    //Only the rows in the viewport are needed.
+    QTextBlock block = firstVisibleBlock();
+    if(block.blockNumber() < firstBlock)
+    {
+        block = document()->findBlockByNumber(firstBlock);
+    }
+    qreal top = blockBoundingGeometry(block).translated(contentOffset()).top(),
+            viewportHeight = viewport()->height();
+    for(int i=block.blockNumber(); i<=lastBlock && block.isValid()
+        && top < viewportHeight; ++i, block = block.next())
     {
-        if(tc.blockNumber() == cursorBlock)
+        if(block.isVisible())
         {
-            return;
+            //Select from the anchor column to the caret column.
+            QString blockText = block.text();
+            QTextCursor cc(block);
+            cc.setPosition(block.position() + textPosition(
+                               blockText, m_vStartSpacePos, tabSpacing));
+            cc.setPosition(block.position() + textPosition(
+                               blockText, m_vEndSpacePos, tabSpacing),
+                           QTextCursor::KeepAnchor);
+            cursors.append(cc);
         }
+        top += blockBoundingRect(block).height();
     }
-    //Extract the block data.
-    const QTextBlock &block = cursor.block();
-    auto data = blockData(block);
-    data->verticalTextPos =
-            textPosition(block, m_vStartSpacePos, knGlobal->tabSpacing());
-    //Select from the vertical text pos to the current position.
-    int endPosition = cursor.position();
-    cursor.setPosition(block.position() + data->verticalTextPos);
-    cursor.setPosition(endPosition, QTextCursor::KeepAnchor);
-    cursor.setKeepPositionOnInsert(true);
-    //Append the cursor.
-    m_extraCursors.append(cursor);
-    //Update extra selections.
-    updateExtraSelections();
+    return cursors;
+}
+
+void KNTextEditor::columnReplace(const QStringList &texts)
+{
+    int tabSpacing = knGlobal->tabSpacing(),
+            left = qMin(m_vStartSpacePos, m_vEndSpacePos),
+            right = qMax(m_vStartSpacePos, m_vEndSpacePos),
+            firstBlock = qMin(m_columnAnchorBlock, m_columnCaretBlock),
+            lastBlock = qMax(m_columnAnchorBlock, m_columnCaretBlock),
+            caretColumn = left, textIndex = 0;
+    //All the rows are changed in one edit block, which is also one undo step.
+    m_columnMaxWidth = -1;
+    QTextCursor tc = textCursor();
+    tc.beginEditBlock();
+    QTextBlock block = document()->findBlockByNumber(firstBlock);
+    for(int i=firstBlock; i<=lastBlock && block.isValid();
+        ++i, block = block.next())
+    {
+        //The texts are used in turn.
+        QString text = texts.at(textIndex);
+        textIndex = (textIndex + 1 == texts.size()) ? 0 : (textIndex + 1);
+        QString blockText = block.text();
+        int start = textPosition(blockText, left, tabSpacing),
+                end = textPosition(blockText, right, tabSpacing);
+        if(!text.isEmpty())
+        {
+            //Fill the spaces to the lines shorter than the column.
+            int startColumn = spacePosition(blockText, start, tabSpacing);
+            if(startColumn < left)
+            {
+                text.prepend(QString(left - startColumn, ' '));
+            }
+        }
+        if(start != end || !text.isEmpty())
+        {
+            tc.setPosition(block.position() + start);
+            tc.setPosition(block.position() + end, QTextCursor::KeepAnchor);
+            if(text.isEmpty())
+            {
+                tc.removeSelectedText();
+            }
+            else
+            {
+                tc.insertText(text);
+            }
+        }
+        //Calculate the new column from the caret row.
+        if(i == m_columnCaretBlock && !text.isEmpty())
+        {
+            caretColumn = spacePosition(block.text(), start + text.size(),
+                                        tabSpacing);
+        }
+    }
+    tc.endEditBlock();
+    //The rectangle becomes a column at the end of the inserted text.
+    m_vStartSpacePos = caretColumn;
+    m_vEndSpacePos = caretColumn;
+    moveColumnCaret();
+}
+
+void KNTextEditor::columnDelete(bool backward)
+{
+    int tabSpacing = knGlobal->tabSpacing(), column = m_vEndSpacePos,
+            firstBlock = qMin(m_columnAnchorBlock, m_columnCaretBlock),
+            lastBlock = qMax(m_columnAnchorBlock, m_columnCaretBlock),
+            caretColumn = backward ? qMax(0, column - 1) : column;
+    m_columnMaxWidth = -1;
+    QTextCursor tc = textCursor();
+    tc.beginEditBlock();
+    QTextBlock block = document()->findBlockByNumber(firstBlock);
+    for(int i=firstBlock; i<=lastBlock && block.isValid();
+        ++i, block = block.next())
+    {
+        QString blockText = block.text();
+        int pos = textPosition(blockText, column, tabSpacing);
+        //Skip the lines which do not reach the column.
+        if(spacePosition(blockText, pos, tabSpacing) < column)
+        {
+            continue;
+        }
+        if(backward)
+        {
+            if(pos == 0)
+            {
+                continue;
+            }
+            tc.setPosition(block.position() + pos);
+            tc.deletePreviousChar();
+            if(i == m_columnCaretBlock)
+            {
+                caretColumn = spacePosition(blockText, pos - 1, tabSpacing);
+            }
+        }
+        else if(pos < blockText.size())
+        {
+            tc.setPosition(block.position() + pos);
+            tc.deleteChar();
+        }
+    }
+    tc.endEditBlock();
+    m_vStartSpacePos = caretColumn;
+    m_vEndSpacePos = caretColumn;
+    moveColumnCaret();
 }
 
 QString KNTextEditor::filePath() const
@@ -2173,7 +2907,7 @@ KNTextBlockData *KNTextEditor::currentBlockData()
 
 bool KNTextEditor::canCopy() const
 {
-    return isExtraCursorEnabled() ?
+    return isColumnMode() ?
                 true :
                 textCursor().hasSelection();
 }
@@ -2234,6 +2968,7 @@ void KNTextEditor::setSymbolDisplayMode(int mode)
     }
     //Update the default text options.
     document()->setDefaultTextOption(option);
+    m_tileCache.clear();
 }
 
 void KNTextEditor::syncWithStatusBar()
@@ -2274,26 +3009,10 @@ void KNTextEditor::indentCursor()
         tc.setKeepPositionOnInsert(true);
         auto startBlock = document()->findBlock(tc.selectionStart()),
                 endBlock = document()->findBlock(tc.selectionEnd());
-        if(startBlock.blockNumber() != endBlock.blockNumber())
+        if(startBlock != endBlock)
         {
-            tc.beginEditBlock();
             //Indent all lines.
-            for(int i=startBlock.blockNumber(); i<=endBlock.blockNumber(); ++i)
-            {
-                //Fetch the current block.
-                auto b = document()->findBlockByNumber(i);
-                //Calculate the space pos.
-                int textStart = firstNonSpacePos(b),
-                    spaceLevel = spacePosition(b, textStart, tabSpacing);
-                //Insert the level text.
-                tc.setPosition(b.position());
-                tc.setPosition(b.position() + textStart,
-                               QTextCursor::KeepAnchor);
-                tc.removeSelectedText();
-                tc.insertText(textLevelString(spaceLevel + tabSpacing,
-                                               tabSpacing));
-            }
-            tc.endEditBlock();
+            indentBlocks(startBlock, endBlock, tabSpacing);
             return;
         }
     }
@@ -2313,35 +3032,13 @@ void KNTextEditor::unindentCursor()
     int tabSpacing = knGlobal->tabSpacing();
     if(tc.hasSelection())
     {
-        //Start tab inserting.
-        tc.beginEditBlock();
-        tc.setKeepPositionOnInsert(true);
         auto startBlock = document()->findBlock(tc.selectionStart()),
                 endBlock = document()->findBlock(tc.selectionEnd());
-        if(startBlock.blockNumber() != endBlock.blockNumber())
+        if(startBlock != endBlock)
         {
-            //Indent all lines.
-            for(int i=startBlock.blockNumber(); i<=endBlock.blockNumber(); ++i)
-            {
-                //Fetch the current block.
-                auto b = document()->findBlockByNumber(i);
-                //Calculate the space pos.
-                int textStart = firstNonSpacePos(b),
-                    spaceLevel = spacePosition(b, textStart, tabSpacing) -
-                        tabSpacing;
-                if(spaceLevel < 0)
-                {
-                    spaceLevel = 0;
-                }
-                //Insert the level text.
-                tc.setPosition(b.position());
-                tc.setPosition(b.position() + textStart,
-                                      QTextCursor::KeepAnchor);
-                tc.removeSelectedText();
-                tc.insertText(textLevelString(spaceLevel, tabSpacing));
-            }
+            //Unindent all lines.
+            indentBlocks(startBlock, endBlock, -tabSpacing);
         }
-        tc.endEditBlock();
         return;
     }
     //If we don't have selection, check whether the position is at content.
@@ -2369,81 +3066,142 @@ void KNTextEditor::unindentCursor()
     }
 }
 
+void KNTextEditor::indentBlocks(const QTextBlock &startBlock,
+                                const QTextBlock &endBlock, int levelDelta)
+{
+    struct IndentEdit
+    {
+        QString text;
+        int position;
+        int removed;
+    };
+    int tabSpacing = knGlobal->tabSpacing();
+    //Calculate the new leading spaces of all the blocks in one pass, only the
+    //different part of the leading spaces is recorded.
+    QVector<IndentEdit> edits;
+    int blockPos = startBlock.position();
+    for(QTextBlock block = startBlock; block.isValid(); block = block.next())
+    {
+        QString blockText = block.text();
+        int textStart = 0;
+        while(textStart < blockText.size() &&
+              (blockText.at(textStart) == ' ' ||
+               blockText.at(textStart) == '\t'))
+        {
+            ++textStart;
+        }
+        QString levelText = textLevelString(
+                    qMax(0, spacePosition(blockText, textStart, tabSpacing) +
+                         levelDelta), tabSpacing);
+        int same = 0;
+        while(same < textStart && same < levelText.size() &&
+              blockText.at(same) == levelText.at(same))
+        {
+            ++same;
+        }
+        if(same < textStart || same < levelText.size())
+        {
+            edits.append({levelText.mid(same), blockPos + same,
+                          textStart - same});
+        }
+        if(block == endBlock)
+        {
+            break;
+        }
+        blockPos += block.length();
+    }
+    if(edits.isEmpty())
+    {
+        return;
+    }
+    //Apply the edits from the end in one edit block, so the positions of the
+    //previous edits are not changed, and the document only reports one change.
+    QTextCursor tc(document());
+    tc.beginEditBlock();
+    for(int i=edits.size() - 1; i>-1; --i)
+    {
+        const IndentEdit &indentEdit = edits.at(i);
+        tc.setPosition(indentEdit.position);
+        tc.setPosition(indentEdit.position + indentEdit.removed,
+                       QTextCursor::KeepAnchor);
+        tc.insertText(indentEdit.text);
+    }
+    tc.endEditBlock();
+}
+
 void KNTextEditor::convertSelectCase(int letterCase)
 {
-    //Extract the selection text.
     auto tc = textCursor();
     if(!tc.hasSelection())
     {
         return;
     }
-    tc.beginEditBlock();
-    int startPos = tc.selectionStart(), endPos = tc.selectionEnd();
-    //Convert the string into target cases.
-    QString selectedText = tc.selectedText();
-    switch(letterCase)
+    int startPos = tc.selectionStart(), endPos = tc.selectionEnd(),
+            lengthDelta = 0;
+    if(letterCase == Random)
     {
-    case Upper:
-        selectedText = selectedText.toUpper();
-        break;
-    case Lower:
-        selectedText = selectedText.toLower();
-        break;
-    case Proper:
-    {
-        QStringList parts = selectedText.split(' ');
-        for(int i=0; i<parts.size(); ++i)
+        //WTF is this?
+        std::srand(std::time(0));
+    }
+    //Convert the selection block by block from the end, so the positions of
+    //the previous blocks are not changed by the edits. Only the changed range
+    //of each block is replaced.
+    QTextCursor editCursor(document());
+    bool edited = false;
+    QTextBlock block = document()->findBlock(endPos),
+            firstBlock = document()->findBlock(startPos);
+    while(block.isValid() && block.blockNumber() >= firstBlock.blockNumber())
+    {
+        int blockPos = block.position(),
+                segmentStart = qMax(startPos, blockPos) - blockPos,
+                segmentEnd = qMin(endPos, blockPos + block.length() - 1) -
+                blockPos;
+        if(segmentEnd > segmentStart)
         {
-            if(parts.at(i).length() > 0)
+            QString blockText = block.text();
+            QStringView segment = QStringView(blockText).mid(
+                        segmentStart, segmentEnd - segmentStart);
+            QString converted = KNCaseConverter::convert(segment, letterCase);
+            //Find the common prefix and suffix.
+            qsizetype prefix = 0, suffix = 0,
+                    sameLength = qMin<qsizetype>(segment.size(),
+                                                   converted.size());
+            while(prefix < sameLength &&
+                  segment.at(prefix) == converted.at(prefix))
             {
-                //Prepare the buffer.
-                QString properPart;
-                properPart.reserve(parts[i].size());
-                //Reaplce the parts.
-                properPart.append(parts[i][0].toUpper());
-                properPart.append(parts[i].mid(1).toLower());
-                //Replace the original string.
-                parts[i] = properPart;
+                ++prefix;
             }
-        }
-        selectedText = parts.join(" ");
-        break;
-    }
-    case Reverse:
-    {
-        //Check letter by letter, reverse it.
-        for(int i=0; i<selectedText.size(); ++i)
-        {
-            if(selectedText.at(i).isUpper())
+            while(suffix < sameLength - prefix &&
+                  segment.at(segment.size() - suffix - 1) ==
+                  converted.at(converted.size() - suffix - 1))
             {
-                selectedText[i] = selectedText[i].toLower();
-                continue;
+                ++suffix;
             }
-            if(selectedText.at(i).isLower())
+            if(prefix < segment.size() || prefix < converted.size())
             {
-                selectedText[i] = selectedText[i].toUpper();
+                if(!edited)
+                {
+                    edited = true;
+                    editCursor.beginEditBlock();
+                }
+                editCursor.setPosition(blockPos + segmentStart + prefix);
+                editCursor.setPosition(blockPos + segmentEnd - suffix,
+                                       QTextCursor::KeepAnchor);
+                editCursor.insertText(converted.mid(
+                                          prefix,
+                                          converted.size() - prefix - suffix));
+                lengthDelta += converted.size() - segment.size();
             }
         }
-        break;
+        block = block.previous();
     }
-    case Random:
+    if(edited)
     {
-        //WTF is this?
-        std::srand(std::time(0));
-        for(int i=0; i<selectedText.size(); ++i)
-        {
-            selectedText[i] = (std::rand() & 1) ?
-                        selectedText[i].toLower() :
-                        selectedText[i].toUpper();
-        }
-        break;
+        editCursor.endEditBlock();
     }
-    }
-    //Remove the previous text.
-    tc.insertText(selectedText);
+    //Select the converted text.
     tc.setPosition(startPos);
-    tc.setPosition(endPos, QTextCursor::KeepAnchor);
-    tc.endEditBlock();
+    tc.setPosition(endPos + lengthDelta, QTextCursor::KeepAnchor);
     setTextCursor(tc);
 }
 
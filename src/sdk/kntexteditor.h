@@ -17,14 +17,19 @@
 #include <QFuture>
 #include <QJsonObject>
 
+#include "kncodefolding.h"
+#include "kntextmarks.h"
 #include "kntextsearcher.h"
+#include "kntilecache.h"
 
 #include <QPlainTextEdit>
 
 class QTextCodec;
+class QTimer;
 class KNSyntaxHighlighter;
 class KNTextBlockData;
 class KNTextEditorPanel;
+class KNDocumentLayout;
 /*!
  * \brief The KNTextEditor class provides the text edit and view widget.
  */
@@ -69,6 +74,7 @@ public:
                           QWidget *parent = nullptr,
                           KNSyntaxHighlighter *highlighter = nullptr,
                           bool linkWithGlobal = true);
+    ~KNTextEditor();
 
     /*!
      * \brief Draw the side bar panel.
@@ -171,6 +177,13 @@ public:
      */
     static int cellTabSpacing(int spacePos, int tabSpacing);
 
+    /*!
+     * \brief Get the display width of a character in spaces.
+     * \param c The character.
+     * \return The CJK ideographs take 2 spaces, the others take 1 space.
+     */
+    static int charWidth(const QChar &c);
+
     /*!
      * \brief Get the file codec name.
      * \return The codec name of the current file.
@@ -229,6 +242,25 @@ public:
      */
     void moveCurrentBlockDown();
 
+    /*!
+     * \brief Fold or unfold the range starts at the block at a position.
+     * \param y The y position in the viewport coordinate.
+     */
+    void toggleFoldAt(int y);
+
+    /*!
+     * \brief Add the marks of the text. The marked text is painted with the
+     * mark format of its style.
+     * \param marks The marks sorted by the start position.
+     * \param bookmarkLine Whether the lines of the marks are bookmarked.
+     */
+    void addMarks(const QVector<KNTextMarks::Mark> &marks, bool bookmarkLine);
+
+    /*!
+     * \brief Remove all the marks of the text.
+     */
+    void clearMarks();
+
 signals:
     /*!
      * \brief When the title of the document is changed, this signal is emitted.
@@ -257,6 +289,15 @@ signals:
      */
     void overwriteModeChange(bool isOverwrite);
 
+    /*!
+     * \brief When a key is pressed in the editor, this signal is emitted
+     * before the key is processed.
+     * \param key The key code.
+     * \param modifiers The keyboard modifiers.
+     * \param text The text generated by the key.
+     */
+    void keyPressed(int key, int modifiers, const QString &text);
+
     /*!
      * \brief When read-only state is change, this signal is emitted.
      * \param isReadOnly If the editor is read-only, this is true.
@@ -424,6 +465,26 @@ public slots:
      */
     void updateExtraSelections();
 
+    /*!
+     * \brief Fold all the code ranges of the document.
+     */
+    void foldAll();
+
+    /*!
+     * \brief Unfold all the code ranges of the document.
+     */
+    void unfoldAll();
+
+    /*!
+     * \brief Fold the innermost unfolded range at the cursor.
+     */
+    void foldCurrentLevel();
+
+    /*!
+     * \brief Unfold the innermost folded range at the cursor.
+     */
+    void unfoldCurrentLevel();
+
 protected:
     /*!
      * \brief Reimplemented from QPlainTextEdit::resizeEvent().
@@ -440,6 +501,11 @@ protected:
      */
     void mousePressEvent(QMouseEvent *event) override;
 
+    /*!
+     * \brief Reimplemented from QPlainTextEdit::mouseMoveEvent().
+     */
+    void mouseMoveEvent(QMouseEvent *event) override;
+
     /*!
      * \brief Reimplemented from QPlainTextEdit::paintEvent().
      */
@@ -461,6 +527,7 @@ private slots:
     void onWrapModeChange(bool wrap);
     void onResultDisplayChange(bool showResult);
     void onAlignLeftChange(bool showLeft);
+    void onContentsChange(int position, int charsRemoved, int charsAdded);
     bool quickSearchForward(const QTextCursor &cursor);
     bool quickSearchBackward(const QTextCursor &cursor);
 
@@ -473,26 +540,58 @@ private:
         HighlightCursor    = 1 << 3,
     };
     void insertTabAt(QTextCursor &tc, int tabSpacing);
+    void paintLongBlock(QPainter *painter, const QTextBlock &block,
+                        const QPointF &offset,
+                        const QVector<QTextLayout::FormatRange> &selections,
+                        const QRect &clip);
+    bool paintBand(QPainter *painter, QTextBlock &block, QPointF &offset,
+                   const QAbstractTextDocumentLayout::PaintContext &context);
+    void moveToLongBlockPos(const QPoint &pos, bool keepAnchor);
+    bool moveLongBlockCursor(bool up, bool keepAnchor);
+    QRect textCursorRect(const QTextCursor &cursor);
+    void ensureLongCursorVisible();
+    QVector<QTextLayout::FormatRange> markSelections(const QTextBlock &block) const;
     void quickSearchUi(const QTextBlock &block);
     void quickSearchCheck(const QTextBlock &block);
     void updateHighlighter(KNSyntaxHighlighter *highlighter = nullptr);
+    void updateHighlightViewport();
+    void visibleBlockRange(int &firstBlock, int &lastBlock);
+    void updateFoldRanges();
+    void foldedSpan(int firstBlock, bool checkFold, int &start, int &end);
+    void setAllFolded(bool fold);
+    void setFolded(int rangeIndex, bool fold);
+    bool isFolded(int rangeIndex);
+    void updateFoldVisibility(int firstBlock, int lastBlock);
+    void unfoldBlock(const QTextBlock &block);
     QString textLevelString(int spaceLevel, int tabSpacing);
+    void indentBlocks(const QTextBlock &startBlock, const QTextBlock &endBlock,
+                      int levelDelta);
     static int spacePosition(const QTextBlock &block, int textPos,
                              int tabSpacing);
+    static int spacePosition(const QString &blockText, int textPos,
+                             int tabSpacing);
     static int textPosition(const QTextBlock &block, int spacePos,
                             int tabSpacing);
+    static int textPosition(const QString &blockText, int spacePos,
+                            int tabSpacing);
     void setFilePath(const QString &filePath);
     void updateViewportMargins();
-    void extraCursorCopy();
-    QString extraCursorText() const;
-    void clearExtraCursor();
-    void enterVerticalMode();
-    bool isExtraCursorEnabled() const;
-    bool isVerticalEnabled() const;
-    void appendVerticalCursor(QTextCursor cursor);
-    QVector<QTextCursor> m_extraCursors;
-    int m_vStartSpacePos, m_vEndSpacePos;
-    bool m_verticalSelect;
+    //Column mode, the rectangle is from the anchor block to the caret block,
+    //and from the start space position to the end space position.
+    void columnCopy();
+    QString columnText() const;
+    void clearColumnMode();
+    void enterColumnMode();
+    bool isColumnMode() const;
+    void moveColumnCaret();
+    int columnMaxWidth();
+    QVector<QTextCursor> visibleColumnCursors() const;
+    void columnReplace(const QStringList &texts);
+    void columnDelete(bool backward);
+    //The maximum width of the rows is -1 when the rows or the text are changed.
+    int m_columnAnchorBlock, m_columnCaretBlock,
+        m_vStartSpacePos, m_vEndSpacePos, m_columnMaxWidth;
+    bool m_columnMode;
 
     QScopedPointer<KNTextSearcher> m_quickSearchPrev, m_quickSearchNext;
     QFuture<void> m_futurePrev, m_futureNext;
@@ -504,11 +603,19 @@ private:
     QList<QMetaObject::Connection> m_connections;
     QTextEdit::ExtraSelection m_currentLine;
 
+    KNTileCache m_tileCache;
+    KNCodeFolding m_folding;
+    KNTextMarks m_marks;
     QString m_filePath;
     QByteArray m_codecName;
     KNTextEditorPanel *m_panel;
+    KNDocumentLayout *m_layout;
     KNSyntaxHighlighter *m_highlighter;
-    int m_editorOptions;
+    QTimer *m_foldTimer;
+    //The first block moved by the line changes since the folding ranges are
+    //matched, -1 when no block is moved.
+    int m_editorOptions, m_tileBlockCount, m_foldBlockCount, m_foldBlock;
+    bool m_hasFold;
 
 };
 
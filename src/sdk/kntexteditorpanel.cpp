@@ -12,6 +12,7 @@
  */
 #include <QFontDatabase>
 #include <QFontMetrics>
+#include <QMouseEvent>
 #include <QPainter>
 
 #include "knuimanager.h"
@@ -47,6 +48,21 @@ void KNTextEditorPanel::paintEvent(QPaintEvent *event)
                          m_showFold ? knUi->width(FOLD_WIDTH) : 0);
 }
 
+void KNTextEditorPanel::mousePressEvent(QMouseEvent *event)
+{
+    //Toggle the fold when clicking on the fold area.
+    int foldX = m_lineNumberWidth + (m_showMarks ? knUi->width(MARK_WIDTH) : 0)
+            + knUi->width(2);
+    if(m_showFold && event->button() == Qt::LeftButton &&
+            event->pos().x() >= foldX)
+    {
+        KNTextEditor *editor = static_cast<KNTextEditor *>(parentWidget());
+        editor->toggleFoldAt(event->pos().y());
+        return;
+    }
+    QWidget::mousePressEvent(event);
+}
+
 bool KNTextEditorPanel::showFold() const
 {
     return m_showFold;
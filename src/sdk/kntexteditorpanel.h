@@ -78,6 +78,11 @@ protected:
      */
     void paintEvent(QPaintEvent *event);
 
+    /*!
+     * \brief Reimplemented from QWidget::mousePressEvent().
+     */
+    void mousePressEvent(QMouseEvent *event);
+
 private:
     int m_lineNumberWidth;
     bool m_showMarks, m_showFold;
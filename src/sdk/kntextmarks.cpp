@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) Kreogist Dev Team
+ *
+ * You can redistribute this software and/or modify it under the
+ * terms of the HARERU Software License; either version 1 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * license file for more details.
+ */
+#include "kntextmarks.h"
+
+static inline bool markLessThan(const KNTextMarks::Mark &left,
+                                const KNTextMarks::Mark &right)
+{
+    if(left.start != right.start)
+    {
+        return left.start < right.start;
+    }
+    return left.length == right.length ?
+                left.style < right.style : left.length < right.length;
+}
+
+KNTextMarks::KNTextMarks() :
+    m_gapIndex(0),
+    m_gapOffset(0)
+{
+}
+
+void KNTextMarks::add(const QVector<Mark> &marks)
+{
+    if(marks.isEmpty())
+    {
+        return;
+    }
+    flushGap();
+    //Merge the sorted marks, the duplicated marks are only kept once.
+    QVector<Mark> merged;
+    merged.reserve(m_marks.size() + marks.size());
+    auto i = m_marks.constBegin(), j = marks.constBegin();
+    while(i != m_marks.constEnd() || j != marks.constEnd())
+    {
+        const Mark &mark = (j == marks.constEnd() ||
+                            (i != m_marks.constEnd() && markLessThan(*i, *j))) ?
+                    *(i++) : *(j++);
+        if(!merged.isEmpty() && !markLessThan(merged.last(), mark))
+        {
+            continue;
+        }
+        merged.append(mark);
+    }
+    m_marks = merged;
+    updateMaxEnds(0);
+}
+
+void KNTextMarks::clear()
+{
+    m_marks.clear();
+    m_maxEnds.clear();
+    m_gapIndex = 0;
+    m_gapOffset = 0;
+}
+
+int KNTextMarks::count() const
+{
+    return m_marks.size();
+}
+
+bool KNTextMarks::remap(int position, int charsRemoved, int charsAdded)
+{
+    //The marks end before the change are not changed.
+    int first = firstOverlap(position), last = first,
+            changeEnd = position + charsRemoved;
+    if(first == m_marks.size())
+    {
+        return false;
+    }
+    //The marks start after the change are moved, move the gap to them.
+    while(last < m_marks.size() && markStart(last) < changeEnd)
+    {
+        ++last;
+    }
+    moveGap(last);
+    //Remove the marks whose text is changed.
+    int current = first;
+    for(int i=first; i<last; ++i)
+    {
+        const Mark &mark = m_marks.at(i);
+        if(mark.start + mark.length <= position)
+        {
+            m_marks[current++] = mark;
+        }
+    }
+    bool removed = current < last;
+    if(removed)
+    {
+        m_marks.remove(current, last - current);
+        m_maxEnds.remove(current, last - current);
+        m_gapIndex = current;
+    }
+    m_gapOffset += charsAdded - charsRemoved;
+    //Update the maximum ends of the kept marks. The maximum ends of the moved
+    //marks are the same as before, until the ends of the removed marks are
+    //passed.
+    int end = first > 0 ? maxEnd(first - 1) : 0;
+    for(int i=first; i<m_marks.size(); ++i)
+    {
+        end = qMax(end, markStart(i) + m_marks.at(i).length);
+        if(i >= m_gapIndex && end == maxEnd(i))
+        {
+            break;
+        }
+        m_maxEnds[i] = end - (i < m_gapIndex ? 0 : m_gapOffset);
+    }
+    return removed;
+}
+
+QVector<KNTextMarks::Mark> KNTextMarks::marks(int from, int to) const
+{
+    QVector<Mark> result;
+    for(int i=firstOverlap(from); i<m_marks.size() && markStart(i) < to; ++i)
+    {
+        Mark mark = m_marks.at(i);
+        mark.start = markStart(i);
+        if(mark.start + mark.length > from)
+        {
+            result.append(mark);
+        }
+    }
+    return result;
+}
+
+quint64 KNTextMarks::stamp(int from, int to) const
+{
+    quint64 stamp = 0;
+    for(int i=firstOverlap(from); i<m_marks.size() && markStart(i) < to; ++i)
+    {
+        const Mark &mark = m_marks.at(i);
+        int start = markStart(i);
+        if(start + mark.length > from)
+        {
+            stamp = (stamp ^ static_cast<quint64>(start - from))
+                    * 1099511628211ULL;
+            stamp = (stamp ^ static_cast<quint64>(mark.length))
+                    * 1099511628211ULL;
+            stamp = (stamp ^ static_cast<quint64>(mark.style + 1))
+                    * 1099511628211ULL;
+        }
+    }
+    return stamp;
+}
+
+int KNTextMarks::firstOverlap(int from) const
+{
+    //The first mark whose maximum end is after the position, the maximum ends
+    //after the gap are still increasing with the offset.
+    int low = 0, high = m_marks.size();
+    while(low < high)
+    {
+        int middle = (low + high) >> 1;
+        if(maxEnd(middle) > from)
+        {
+            high = middle;
+        }
+        else
+        {
+            low = middle + 1;
+        }
+    }
+    return low;
+}
+
+void KNTextMarks::moveGap(int index)
+{
+    //Apply the offset to the marks between the gaps, the marks after the gap
+    //still keep the offset.
+    if(m_gapOffset == 0)
+    {
+        m_gapIndex = index;
+        return;
+    }
+    for(int i=m_gapIndex; i<index; ++i)
+    {
+        m_marks[i].start += m_gapOffset;
+        m_maxEnds[i] += m_gapOffset;
+    }
+    for(int i=index; i<m_gapIndex; ++i)
+    {
+        m_marks[i].start -= m_gapOffset;
+        m_maxEnds[i] -= m_gapOffset;
+    }
+    m_gapIndex = index;
+}
+
+void KNTextMarks::flushGap()
+{
+    moveGap(m_marks.size());
+    m_gapIndex = 0;
+    m_gapOffset = 0;
+}
+
+void KNTextMarks::updateMaxEnds(int from)
+{
+    m_maxEnds.resize(m_marks.size());
+    int maxEnd = from > 0 ? m_maxEnds.at(from - 1) : 0;
+    for(int i=from; i<m_marks.size(); ++i)
+    {
+        const Mark &mark = m_marks.at(i);
+        maxEnd = qMax(maxEnd, mark.start + mark.length);
+        m_maxEnds[i] = maxEnd;
+    }
+}
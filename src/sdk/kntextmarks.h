@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) Kreogist Dev Team
+ *
+ * You can redistribute this software and/or modify it under the
+ * terms of the HARERU Software License; either version 1 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * license file for more details.
+ */
+#ifndef KNTEXTMARKS_H
+#define KNTEXTMARKS_H
+
+#include <QVector>
+
+/*!
+ * \def MARK_STYLE_COUNT
+ * The number of the mark styles could be used to mark the text.
+ */
+#define MARK_STYLE_COUNT    (5)
+
+/*!
+ * \brief The KNTextMarks class keeps the marked text ranges of a document. The
+ * marks are saved as document positions sorted by the start, together with the
+ * maximum end position of all the marks before each mark. The maximum ends are
+ * increasing, so the marks overlapping a range are found with one binary
+ * search, no text cursor is created for any mark.\n
+ * The marks are not attached to the document, the positions have to be moved
+ * by calling remap() when the document is changed. The move is applied lazily:
+ * the marks from the gap index are moved by the gap offset when they are read,
+ * a change only moves the gap to the marks near it, so the continuous edits at
+ * one place do not touch the other marks.
+ */
+class KNTextMarks
+{
+public:
+    struct Mark
+    {
+        int start;
+        int length;
+        int style;
+    };
+
+    /*!
+     * \brief Construct an empty KNTextMarks object.
+     */
+    KNTextMarks();
+
+    /*!
+     * \brief Add the marks to the document. The marks which already exist are
+     * ignored.
+     * \param marks The new marks, sorted by the start position.
+     */
+    void add(const QVector<Mark> &marks);
+
+    /*!
+     * \brief Remove all the marks.
+     */
+    void clear();
+
+    /*!
+     * \brief Get the number of the marks.
+     * \return The mark count.
+     */
+    int count() const;
+
+    /*!
+     * \brief Move the marks after a document change. The marks after the
+     * change are moved, the marks whose text is changed are removed.
+     * \param position The position of the change.
+     * \param charsRemoved The number of the removed characters.
+     * \param charsAdded The number of the added characters.
+     * \return If any mark is removed, return true.
+     */
+    bool remap(int position, int charsRemoved, int charsAdded);
+
+    /*!
+     * \brief Find all the marks overlapping a range of the document.
+     * \param from The start position of the range.
+     * \param to The end position of the range, it is not included.
+     * \return The marks sorted by the start position.
+     */
+    QVector<Mark> marks(int from, int to) const;
+
+    /*!
+     * \brief Calculate the stamp of the marks overlapping a range. The stamp
+     * only depends on the positions relative to the range start.
+     * \param from The start position of the range.
+     * \param to The end position of the range, it is not included.
+     * \return The stamp of the marks, 0 for no mark.
+     */
+    quint64 stamp(int from, int to) const;
+
+private:
+    inline int markStart(int index) const
+    {
+        return m_marks.at(index).start +
+                (index < m_gapIndex ? 0 : m_gapOffset);
+    }
+    inline int maxEnd(int index) const
+    {
+        return m_maxEnds.at(index) + (index < m_gapIndex ? 0 : m_gapOffset);
+    }
+    int firstOverlap(int from) const;
+    void moveGap(int index);
+    void flushGap();
+    void updateMaxEnds(int from);
+    QVector<Mark> m_marks;
+    QVector<int> m_maxEnds;
+    int m_gapIndex, m_gapOffset;
+};
+
+#endif // KNTEXTMARKS_H
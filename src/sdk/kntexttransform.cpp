@@ -0,0 +1,334 @@
+/*
+ * Copyright (C) Kreogist Dev Team
+ *
+ * You can redistribute this software and/or modify it under the
+ * terms of the HARERU Software License; either version 1 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * license file for more details.
+ */
+#include <QTextBlock>
+#include <QTextCursor>
+#include <QThread>
+#include <QtConcurrent/QtConcurrent>
+
+#include "kntexteditor.h"
+
+#include "kntexttransform.h"
+
+//The minimum characters transformed by one task.
+#define TRANSFORM_TASK_SIZE (65536)
+
+static QString mapPart(const QString &text, int from, int to,
+                       const KNTextTransform::LineFunction &func,
+                       const QString &separator)
+{
+    QString result;
+    result.reserve(to - from);
+    int lineStart = from;
+    while(true)
+    {
+        int lineEnd = text.indexOf('\n', lineStart);
+        if(lineEnd == -1 || lineEnd > to)
+        {
+            lineEnd = to;
+        }
+        result.append(func(QStringView(text.constData() + lineStart,
+                                       lineEnd - lineStart)));
+        if(lineEnd == to)
+        {
+            return result;
+        }
+        result.append(separator);
+        lineStart = lineEnd + 1;
+    }
+}
+
+KNTextTransform::KNTextTransform(KNTextEditor *editor) :
+    m_editor(editor),
+    m_start(0),
+    m_selection(false)
+{
+    QTextCursor tc = editor->textCursor();
+    if(!tc.hasSelection())
+    {
+        //The plain text replaces the non-breaking spaces and the line
+        //separators, use the raw text the same as the selected text.
+        m_text = editor->document()->toRawText();
+        m_text.replace(QChar::ParagraphSeparator, '\n');
+        return;
+    }
+    //Expand the selection to the whole lines. The line which the selection
+    //ends at its start is not included.
+    auto doc = editor->document();
+    QTextBlock startBlock = doc->findBlock(tc.selectionStart()),
+            endBlock = doc->findBlock(tc.selectionEnd());
+    if(endBlock != startBlock && endBlock.position() == tc.selectionEnd())
+    {
+        endBlock = endBlock.previous();
+    }
+    m_selection = true;
+    m_start = startBlock.position();
+    tc.setPosition(m_start);
+    tc.setPosition(endBlock.position() + endBlock.length() - 1,
+                   QTextCursor::KeepAnchor);
+    m_text = tc.selectedText();
+    m_text.replace(QChar::ParagraphSeparator, '\n');
+}
+
+const QString &KNTextTransform::text() const
+{
+    return m_text;
+}
+
+bool KNTextTransform::isSelection() const
+{
+    return m_selection;
+}
+
+bool KNTextTransform::apply(const QString &result)
+{
+    if(m_editor->isReadOnly())
+    {
+        return false;
+    }
+    //Find the common prefix and suffix.
+    int oldLength = m_text.length(), newLength = result.length(),
+            maxPrefix = qMin(oldLength, newLength), prefix = 0, suffix = 0;
+    while(prefix < maxPrefix && m_text.at(prefix) == result.at(prefix))
+    {
+        ++prefix;
+    }
+    if(prefix == oldLength && prefix == newLength)
+    {
+        return false;
+    }
+    while(suffix < maxPrefix - prefix &&
+          m_text.at(oldLength - 1 - suffix) == result.at(newLength - 1 - suffix))
+    {
+        ++suffix;
+    }
+    //Replace the changed part in one edit block.
+    QTextCursor tc = m_editor->textCursor();
+    tc.beginEditBlock();
+    tc.setPosition(m_start + prefix);
+    tc.setPosition(m_start + oldLength - suffix, QTextCursor::KeepAnchor);
+    tc.insertText(result.mid(prefix, newLength - prefix - suffix));
+    tc.endEditBlock();
+    //Keep the transformed lines selected.
+    if(m_selection)
+    {
+        tc.setPosition(m_start);
+        tc.setPosition(m_start + newLength, QTextCursor::KeepAnchor);
+        m_editor->setTextCursor(tc);
+    }
+    m_text = result;
+    return true;
+}
+
+QString KNTextTransform::mapLines(const QString &text,
+                                  const LineFunction &func,
+                                  const QString &separator)
+{
+    //Split the text at the line ends, the last part ends at the text end.
+    int taskSize = qMax(TRANSFORM_TASK_SIZE,
+                        text.length() / qMax(1, QThread::idealThreadCount()));
+    QVector<int> partEnds;
+    for(int partStart = 0; partStart <= text.length(); )
+    {
+        int partEnd = text.length();
+        if(partEnd - partStart > taskSize)
+        {
+            int lineEnd = text.indexOf('\n', partStart + taskSize);
+            if(lineEnd != -1)
+            {
+                partEnd = lineEnd;
+            }
+        }
+        partEnds.append(partEnd);
+        partStart = partEnd + 1;
+    }
+    if(partEnds.size() == 1)
+    {
+        return mapPart(text, 0, text.length(), func, separator);
+    }
+    //Transform the parts in parallel.
+    QVector<QFuture<QString>> tasks;
+    int partStart = 0;
+    for(int partEnd : qAsConst(partEnds))
+    {
+        tasks.append(QtConcurrent::run([&text, &func, &separator,
+                                       partStart, partEnd]
+        {
+            return mapPart(text, partStart, partEnd, func, separator);
+        }));
+        partStart = partEnd + 1;
+    }
+    QString result;
+    result.reserve(text.length());
+    for(int i=0; i<tasks.size(); ++i)
+    {
+        if(i)
+        {
+            result.append(separator);
+        }
+        result.append(tasks[i].result());
+    }
+    return result;
+}
+
+bool KNTextTransform::removeLines(KNTextEditor *editor,
+                                  const LineFilter &isRemoved)
+{
+    if(editor->isReadOnly())
+    {
+        return false;
+    }
+    //Find the selected lines, or the entire document.
+    auto doc = editor->document();
+    QTextCursor tc = editor->textCursor();
+    QTextBlock block = doc->firstBlock(), endBlock = doc->lastBlock();
+    if(tc.hasSelection())
+    {
+        block = doc->findBlock(tc.selectionStart());
+        endBlock = doc->findBlock(tc.selectionEnd());
+        if(endBlock != block && endBlock.position() == tc.selectionEnd())
+        {
+            endBlock = endBlock.previous();
+        }
+    }
+    //Find the runs of the removed lines in one pass, the start and the end
+    //position of each run are saved in pairs.
+    QVector<int> runs;
+    bool inRun = false;
+    int blockPos = block.position();
+    while(true)
+    {
+        int blockEnd = blockPos + block.length() - 1;
+        if(isRemoved(block.text()))
+        {
+            if(inRun)
+            {
+                runs.last() = blockEnd;
+            }
+            else
+            {
+                runs.append(blockPos);
+                runs.append(blockEnd);
+                inRun = true;
+            }
+        }
+        else
+        {
+            inRun = false;
+        }
+        if(block == endBlock)
+        {
+            break;
+        }
+        blockPos += block.length();
+        block = block.next();
+    }
+    if(runs.isEmpty())
+    {
+        return false;
+    }
+    //Remove the runs from the end with their line ends. The run at the end of
+    //the document is removed with the line end before it.
+    int textEnd = doc->characterCount() - 1;
+    tc.beginEditBlock();
+    for(int i=runs.size() - 2; i>-1; i-=2)
+    {
+        int start = runs.at(i), end = runs.at(i + 1);
+        if(end < textEnd)
+        {
+            ++end;
+        }
+        else if(start > 0)
+        {
+            --start;
+        }
+        tc.setPosition(start);
+        tc.setPosition(end, QTextCursor::KeepAnchor);
+        tc.removeSelectedText();
+    }
+    tc.endEditBlock();
+    return true;
+}
+
+QString KNTextTransform::tabToSpace(QStringView line, int tabSpacing)
+{
+    QString result;
+    result.reserve(static_cast<int>(line.size()));
+    int column = 0;
+    for(int i=0; i<line.size(); ++i)
+    {
+        //Check whether the iteration is \t.
+        if(line.at(i) == '\t')
+        {
+            int tabEnd = KNTextEditor::cellTabSpacing(column, tabSpacing);
+            result.append(QString(tabEnd - column, ' '));
+            column = tabEnd;
+            continue;
+        }
+        //Simply increase a char.
+        result.append(line.at(i));
+        column += 1;
+    }
+    return result;
+}
+
+QString KNTextTransform::spaceToTab(QStringView line, int tabSpacing,
+                                    bool leading)
+{
+    QString result;
+    result.reserve(static_cast<int>(line.size()));
+    int column = 0, spaces = 0;
+    for(int i=0; i<line.size(); ++i)
+    {
+        QChar c = line.at(i);
+        if(c == ' ')
+        {
+            //Replace the spaces when they reach a tab stop.
+            ++spaces;
+            ++column;
+            if(column % tabSpacing == 0)
+            {
+                result.append(spaces > 1 ? QString("\t") : QString(" "));
+                spaces = 0;
+            }
+            continue;
+        }
+        if(c == '\t')
+        {
+            //The spaces in the cell of the tab are covered by the tab.
+            spaces = 0;
+            result.append(c);
+            column = KNTextEditor::cellTabSpacing(column, tabSpacing);
+            continue;
+        }
+        result.append(QString(spaces, ' '));
+        spaces = 0;
+        if(leading)
+        {
+            //Keep the rest of the line.
+            result.append(line.mid(i).toString());
+            return result;
+        }
+        result.append(c);
+        ++column;
+    }
+    result.append(QString(spaces, ' '));
+    return result;
+}
+
+bool KNTextTransform::transformLines(KNTextEditor *editor,
+                                     const LineFunction &func,
+                                     const QString &separator)
+{
+    KNTextTransform transform(editor);
+    return transform.apply(mapLines(transform.text(), func, separator));
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) Kreogist Dev Team
+ *
+ * You can redistribute this software and/or modify it under the
+ * terms of the HARERU Software License; either version 1 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * license file for more details.
+ */
+#ifndef KNTEXTTRANSFORM_H
+#define KNTEXTTRANSFORM_H
+
+#include <functional>
+
+#include <QString>
+#include <QStringView>
+
+class KNTextEditor;
+/*!
+ * \brief The KNTextTransform class applies a bulk transform to the text of an
+ * editor. It takes a snapshot of the lines in the selection, or the entire
+ * document when nothing is selected, and the transform result is written back
+ * as one replacement of the changed part in a single undo step. The document
+ * is only laid out and highlighted once, no matter how many lines are changed.
+ * \n
+ * The lines of the snapshot are separated by line feeds.
+ */
+class KNTextTransform
+{
+public:
+    typedef std::function<QString (QStringView)> LineFunction;
+    typedef std::function<bool (const QString &)> LineFilter;
+
+    /*!
+     * \brief Take the snapshot of the editor text.
+     * \param editor The text editor.
+     */
+    explicit KNTextTransform(KNTextEditor *editor);
+
+    /*!
+     * \brief Get the snapshot text.
+     * \return The text of the whole lines to be transformed.
+     */
+    const QString &text() const;
+
+    /*!
+     * \brief Check whether the snapshot is the selected lines.
+     * \return If the selection is transformed, return true.
+     */
+    bool isSelection() const;
+
+    /*!
+     * \brief Write the transform result back to the editor. Only the part
+     * between the common prefix and suffix of the snapshot and the result is
+     * replaced.
+     * \param result The transformed text.
+     * \return If the text is changed, return true.
+     */
+    bool apply(const QString &result);
+
+    /*!
+     * \brief Call a function on every line of a text and join the results. The
+     * text is split into parts at the line ends, the parts are transformed in
+     * parallel.
+     * \param text The text to transform.
+     * \param func The line function, it must not depend on the other lines.
+     * \param separator The separator to join the results.
+     * \return The joined result.
+     */
+    static QString mapLines(const QString &text, const LineFunction &func,
+                            const QString &separator = QString("\n"));
+
+    /*!
+     * \brief Transform every line of the editor with a line function.
+     * \param editor The text editor.
+     * \param func The line function.
+     * \param separator The separator to join the results.
+     * \return If the text is changed, return true.
+     */
+    static bool transformLines(KNTextEditor *editor, const LineFunction &func,
+                               const QString &separator = QString("\n"));
+
+    /*!
+     * \brief Remove the lines of the selection, or the entire document, which
+     * are accepted by a filter. The lines are checked in one pass in order, and
+     * each run of the continuous removed lines is deleted as one range in a
+     * single undo step. The block data of the kept lines is not changed.
+     * \param editor The text editor.
+     * \param isRemoved The filter which returns true for the removed lines. It
+     * is called from the first line to the last line.
+     * \return If any line is removed, return true.
+     */
+    static bool removeLines(KNTextEditor *editor, const LineFilter &isRemoved);
+
+    /*!
+     * \brief Replace the tabs of a line with the spaces to the next tab stops.
+     * \param line The line text.
+     * \param tabSpacing The spacing of the tab stops.
+     * \return The converted line.
+     */
+    static QString tabToSpace(QStringView line, int tabSpacing);
+
+    /*!
+     * \brief Replace the spaces which end at the tab stops with the tabs. A
+     * single space before a tab stop is kept.
+     * \param line The line text.
+     * \param tabSpacing The spacing of the tab stops.
+     * \param leading Only replace the spaces before the first non-space
+     * character.
+     * \return The converted line.
+     */
+    static QString spaceToTab(QStringView line, int tabSpacing, bool leading);
+
+private:
+    QString m_text;
+    KNTextEditor *m_editor;
+    int m_start;
+    bool m_selection;
+};
+
+#endif // KNTEXTTRANSFORM_H
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) Kreogist Dev Team
+ *
+ * You can redistribute this software and/or modify it under the
+ * terms of the HARERU Software License; either version 1 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * license file for more details.
+ */
+#include <QTextBlock>
+
+#include "kntilecache.h"
+
+KNTileCache::KNTileCache() :
+    m_offsetX(0.0),
+    m_width(0)
+{
+}
+
+void KNTileCache::setBudget(int budget)
+{
+    m_bands.setMaxCost(budget);
+}
+
+void KNTileCache::setGeometry(int width, qreal offsetX)
+{
+    //Check whether the geometry is changed.
+    if(m_width == width && qFuzzyCompare(m_offsetX + 1.0, offsetX + 1.0))
+    {
+        return;
+    }
+    m_width = width;
+    m_offsetX = offsetX;
+    m_bands.clear();
+}
+
+quint64 KNTileCache::bandStamp(const QTextBlock &block)
+{
+    //Mix the revisions, lengths and visibilities of all the blocks in the band.
+    quint64 stamp = 14695981039346656037ULL;
+    QTextBlock current = block;
+    for(int i=0; i<TILE_BAND_BLOCKS && current.isValid(); ++i)
+    {
+        stamp = (stamp ^ static_cast<quint64>(current.revision()))
+                * 1099511628211ULL;
+        stamp = (stamp ^ static_cast<quint64>(current.length()))
+                * 1099511628211ULL;
+        stamp = (stamp ^ static_cast<quint64>(current.isVisible()))
+                * 1099511628211ULL;
+        current = current.next();
+    }
+    return stamp;
+}
+
+const QImage *KNTileCache::band(int band, quint64 stamp) const
+{
+    BandImage *bandImage = m_bands.object(band);
+    if(!bandImage || bandImage->stamp != stamp)
+    {
+        return nullptr;
+    }
+    return &bandImage->image;
+}
+
+void KNTileCache::insert(int band, quint64 stamp, const QImage &image)
+{
+    //The cost of the image is counted in kilobytes.
+    BandImage *bandImage = new BandImage;
+    bandImage->image = image;
+    bandImage->stamp = stamp;
+#if QT_VERSION_MAJOR > 5
+    int cost = static_cast<int>(image.sizeInBytes() >> 10);
+#else
+    int cost = image.byteCount() >> 10;
+#endif
+    m_bands.insert(band, bandImage, qMax(1, cost));
+}
+
+void KNTileCache::remove(int fromBand, int toBand)
+{
+    const auto bands = m_bands.keys();
+    for(int band : bands)
+    {
+        if(band >= fromBand && (toBand == -1 || band <= toBand))
+        {
+            m_bands.remove(band);
+        }
+    }
+}
+
+void KNTileCache::clear()
+{
+    m_bands.clear();
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) Kreogist Dev Team
+ *
+ * You can redistribute this software and/or modify it under the
+ * terms of the HARERU Software License; either version 1 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * license file for more details.
+ */
+#ifndef KNTILECACHE_H
+#define KNTILECACHE_H
+
+#include <QCache>
+#include <QImage>
+
+/*!
+ * \def TILE_BAND_BLOCKS
+ * The number of text blocks in one band of the tile cache.
+ */
+#define TILE_BAND_BLOCKS    (32)
+
+class QTextBlock;
+/*!
+ * \brief The KNTileCache class keeps the rendered images of the text editor
+ * bands. A band is a strip of TILE_BAND_BLOCKS continuous text blocks. Each
+ * band image is stamped with the revisions and visibilities of its blocks, a
+ * band is only reused when the stamp is not changed.\n
+ * The images are rendered at one horizontal offset and viewport width, the
+ * cache is cleared when any of them is changed.
+ */
+class KNTileCache
+{
+public:
+    /*!
+     * \brief Construct a KNTileCache object.
+     */
+    KNTileCache();
+
+    /*!
+     * \brief Set the memory budget of the cache.
+     * \param budget The memory budget in kilobytes.
+     */
+    void setBudget(int budget);
+
+    /*!
+     * \brief Set the geometry of the band images. When the geometry is
+     * changed, all the cached images will be removed.
+     * \param width The viewport width in pixels.
+     * \param offsetX The horizontal content offset.
+     */
+    void setGeometry(int width, qreal offsetX);
+
+    /*!
+     * \brief Get the revision stamp of the band.
+     * \param block The first block of the band.
+     * \return The stamp calculated from the revisions of the band blocks.
+     */
+    static quint64 bandStamp(const QTextBlock &block);
+
+    /*!
+     * \brief Find the cached band image.
+     * \param band The band index.
+     * \param stamp The current revision stamp of the band.
+     * \return The band image. If the band is not cached or out of date, return
+     * nullptr.
+     */
+    const QImage *band(int band, quint64 stamp) const;
+
+    /*!
+     * \brief Insert a rendered band image into the cache.
+     * \param band The band index.
+     * \param stamp The revision stamp of the band.
+     * \param image The rendered image.
+     */
+    void insert(int band, quint64 stamp, const QImage &image);
+
+    /*!
+     * \brief Remove the bands from one band to another.
+     * \param fromBand The first band index.
+     * \param toBand The last band index. -1 means all the bands after the
+     * first band.
+     */
+    void remove(int fromBand, int toBand = -1);
+
+    /*!
+     * \brief Remove all the cached images.
+     */
+    void clear();
+
+private:
+    struct BandImage
+    {
+        QImage image;
+        quint64 stamp;
+    };
+    QCache<int, BandImage> m_bands;
+    qreal m_offsetX;
+    int m_width;
+};
+
+#endif // KNTILECACHE_H
@@ -19,6 +19,7 @@
 #include "kntexteditor.h"
 #include "kndocumentmap.h"
 #include "knfolderpanel.h"
+#include "knframemonitor.h"
 
 #include "knviewmenu.h"
 
@@ -26,14 +27,19 @@ KNViewMenu::KNViewMenu(QWidget *parent) :
     QMenu(parent),
     m_mapDockWidget(new QDockWidget(parent)),
     m_folderDockWidget(new QDockWidget(parent)),
+    m_monitorDockWidget(new QDockWidget(parent)),
     m_docMap(new KNDocumentMap(this)),
-    m_folderPanel(new KNFolderPanel(this))
+    m_folderPanel(new KNFolderPanel(this)),
+    m_frameMonitor(new KNFrameMonitor(this)),
+    m_editor(nullptr)
 {
     //Add dock widgets.
     knGlobal->mainWindow()->addDockWidget(Qt::RightDockWidgetArea, m_mapDockWidget);
     m_mapDockWidget->setWidget(m_docMap);
     knGlobal->mainWindow()->addDockWidget(Qt::LeftDockWidgetArea, m_folderDockWidget);
     m_folderDockWidget->setWidget(m_folderPanel);
+    knGlobal->mainWindow()->addDockWidget(Qt::BottomDockWidgetArea, m_monitorDockWidget);
+    m_monitorDockWidget->setWidget(m_frameMonitor);
     //Construct the actions.
     for(int i=0; i<ViewMenuItemCount; ++i)
     {
@@ -90,6 +96,7 @@ KNViewMenu::KNViewMenu(QWidget *parent) :
     addAction(m_menuItems[TextDirectionLTR]);
     addSeparator();
     addAction(m_menuItems[Monitoring]);
+    addAction(m_menuItems[FrameMonitor]);
     //Link the translator.
     knUi->addTranslate(this, &KNViewMenu::retranslate);
     //Change action states.
@@ -100,6 +107,8 @@ KNViewMenu::KNViewMenu(QWidget *parent) :
     m_menuItems[ShowAllChars]->setCheckable(true);
     m_menuItems[WordWrap]->setCheckable(true);
     m_menuItems[FolderPanel]->setCheckable(true);
+    m_menuItems[DocumentMap]->setCheckable(true);
+    m_menuItems[FrameMonitor]->setCheckable(true);
     //Set the shortcut of the menu.
     m_menuItems[FullScreen]->setShortcut(QKeySequence::FullScreen);
     m_menuItems[ZoomIn]->setShortcut(QKeySequence::ZoomIn);
@@ -149,11 +158,20 @@ KNViewMenu::KNViewMenu(QWidget *parent) :
     connect(m_menuItems[Summary], &QAction::triggered, this, &KNViewMenu::requireToShowSummary);
     connect(m_menuItems[FolderPanel], &QAction::triggered, m_folderDockWidget, &QDockWidget::setVisible);
     connect(m_folderDockWidget, &QDockWidget::visibilityChanged, m_menuItems[FolderPanel], &QAction::setChecked);
+    connect(m_menuItems[DocumentMap], &QAction::triggered, m_mapDockWidget, &QDockWidget::setVisible);
+    connect(m_mapDockWidget, &QDockWidget::visibilityChanged, m_menuItems[DocumentMap], &QAction::setChecked);
+    connect(m_menuItems[FrameMonitor], &QAction::triggered, m_monitorDockWidget, &QDockWidget::setVisible);
+    connect(m_monitorDockWidget, &QDockWidget::visibilityChanged, m_menuItems[FrameMonitor], &QAction::setChecked);
     connect(m_menuItems[TextDirectionRTL], &QAction::triggered, [=]{ knGlobal->setAlignLeft(false); });
     connect(m_menuItems[TextDirectionLTR], &QAction::triggered, [=]{ knGlobal->setAlignLeft(true); });
+    connect(m_menuItems[FoldAll], &QAction::triggered, [=]{ if(m_editor) { m_editor->foldAll(); } });
+    connect(m_menuItems[UnfoldAll], &QAction::triggered, [=]{ if(m_editor) { m_editor->unfoldAll(); } });
+    connect(m_menuItems[CollapseCurrentLevel], &QAction::triggered, [=]{ if(m_editor) { m_editor->foldCurrentLevel(); } });
+    connect(m_menuItems[UncollapseCurrentLevel], &QAction::triggered, [=]{ if(m_editor) { m_editor->unfoldCurrentLevel(); } });
     //Hide panels at default.
     m_mapDockWidget->close();
     m_folderDockWidget->close();
+    m_monitorDockWidget->close();
 }
 
 QAction *KNViewMenu::menuItem(int index)
@@ -163,8 +181,10 @@ QAction *KNViewMenu::menuItem(int index)
 
 void KNViewMenu::setEditor(KNTextEditor *editor)
 {
-    //Set the document to map.
-    //    m_docMap->setDocument(editor ? editor->document() : nullptr);
+    //Save the editor for the fold actions.
+    m_editor = editor;
+    //Set the editor to map.
+    m_docMap->setEditor(editor);
 }
 
 void KNViewMenu::setAndShowFolder(const QString &folderPath)
@@ -199,6 +219,7 @@ void KNViewMenu::retranslate()
     m_menuItems[TextDirectionRTL]->setText(tr("Text Direction RTL"));
     m_menuItems[TextDirectionLTR]->setText(tr("Text Direction LTR"));
     m_menuItems[Monitoring]->setText(tr("Monitoring (tail -f)"));
+    m_menuItems[FrameMonitor]->setText(tr("Frame Monitor"));
     m_menuItems[ShowWhiteSpace]->setText(tr("Show White Space and TAB"));
     m_menuItems[ShowEOF]->setText(tr("Show End of Line"));
     m_menuItems[ShowAllChars]->setText(tr("Show All Characters"));
@@ -227,6 +248,7 @@ void KNViewMenu::retranslate()
     //Configure the dock widget.
     m_mapDockWidget->setWindowTitle(tr("Document Map"));
     m_folderDockWidget->setWindowTitle(tr("Folders"));
+    m_monitorDockWidget->setWindowTitle(tr("Frame Monitor"));
 }
 
 void KNViewMenu::onAlwaysOnTopToggle(bool checked)
@@ -19,6 +19,7 @@ class QDockWidget;
 class KNDocumentMap;
 class KNTextEditor;
 class KNFolderPanel;
+class KNFrameMonitor;
 /*!
  * \brief The KNViewMenu class provides the view menu of the application.
  */
@@ -42,6 +43,7 @@ public:
         TextDirectionRTL,
         TextDirectionLTR,
         Monitoring,
+        FrameMonitor,
         ShowWhiteSpace,
         ShowEOF,
         ShowAllChars,
@@ -149,9 +151,11 @@ private:
 
     QAction *m_menuItems[ViewMenuItemCount];
     QMenu *m_subMenus[ViewSubMenuCount];
-    QDockWidget *m_mapDockWidget, *m_folderDockWidget;
+    QDockWidget *m_mapDockWidget, *m_folderDockWidget, *m_monitorDockWidget;
     KNDocumentMap *m_docMap;
     KNFolderPanel *m_folderPanel;
+    KNFrameMonitor *m_frameMonitor;
+    KNTextEditor *m_editor;
 };
 
 #endif // KNVIEWMENU_H
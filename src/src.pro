@@ -76,6 +76,9 @@ i18n: {
     QMAKE_EXTRA_COMPILERS += MAKE_QM_FILES
 }
 
+# Syntax compiler.
+include(syntax.pri)
+
 # Add sdk directory to include path.
 INCLUDEPATH += \
     sdk \
@@ -85,29 +88,39 @@ RESOURCES += \
 
 HEADERS += \
     sdk/knactionedit.h \
+    sdk/kncaseconverter.h \
     sdk/kncharpanel.h \
     sdk/knclipboardhistory.h \
     sdk/kncodecdialog.h \
     sdk/kncodecmenu.h \
+    sdk/kncodefolding.h \
     sdk/kncodesyntaxhighlighter.h \
     sdk/knconfigure.h \
     sdk/knconfiguremanager.h \
+    sdk/kndelimitedtext.h \
     sdk/kndocumentlayout.h \
     sdk/kndocumentmap.h \
     sdk/kneditmenu.h \
     sdk/knfilemanager.h \
+    sdk/knfiletransform.h \
     sdk/knfindengine.h \
     sdk/knfindprogress.h \
     sdk/knfindwindow.h \
     sdk/knfolderpanel.h \
+    sdk/knframemonitor.h \
+    sdk/knframeprofiler.h \
     sdk/knglobal.h \
     sdk/kngotowindow.h \
     sdk/knhelpmenu.h \
+    sdk/knhighlightcache.h \
     sdk/kniconprovider.h \
     sdk/knlanguagemodel.h \
+    sdk/knlinededuplicator.h \
     sdk/knlineedit.h \
+    sdk/knlinesorter.h \
     sdk/knlocalpeer.h \
     sdk/knlockedfile.h \
+    sdk/knmacromenu.h \
     sdk/knmainwindow.h \
     sdk/knrecentfilerecorder.h \
     sdk/knrundialog.h \
@@ -120,6 +133,7 @@ HEADERS += \
     sdk/knsingletonapplication.h \
     sdk/knstatusbar.h \
     sdk/knstatuslabel.h \
+    sdk/knsyntaxdefinition.h \
     sdk/knsyntaxhighlighter.h \
     sdk/kntabbar.h \
     sdk/kntabmodel.h \
@@ -127,7 +141,10 @@ HEADERS += \
     sdk/kntextblockdata.h \
     sdk/kntexteditor.h \
     sdk/kntexteditorpanel.h \
+    sdk/kntextmarks.h \
     sdk/kntextsearcher.h \
+    sdk/kntexttransform.h \
+    sdk/kntilecache.h \
     sdk/kntoolhash.h \
     sdk/kntoolhashfile.h \
     sdk/kntoolhashinput.h \
@@ -142,29 +159,39 @@ HEADERS += \
 SOURCES += \
     main.cpp \
     sdk/knactionedit.cpp \
+    sdk/kncaseconverter.cpp \
     sdk/kncharpanel.cpp \
     sdk/knclipboardhistory.cpp \
     sdk/kncodecdialog.cpp \
     sdk/kncodecmenu.cpp \
+    sdk/kncodefolding.cpp \
     sdk/kncodesyntaxhighlighter.cpp \
     sdk/knconfigure.cpp \
     sdk/knconfiguremanager.cpp \
+    sdk/kndelimitedtext.cpp \
     sdk/kndocumentlayout.cpp \
     sdk/kndocumentmap.cpp \
     sdk/kneditmenu.cpp \
     sdk/knfilemanager.cpp \
+    sdk/knfiletransform.cpp \
     sdk/knfindengine.cpp \
     sdk/knfindprogress.cpp \
     sdk/knfindwindow.cpp \
     sdk/knfolderpanel.cpp \
+    sdk/knframemonitor.cpp \
+    sdk/knframeprofiler.cpp \
     sdk/knglobal.cpp \
     sdk/kngotowindow.cpp \
     sdk/knhelpmenu.cpp \
+    sdk/knhighlightcache.cpp \
     sdk/kniconprovider.cpp \
     sdk/knlanguagemodel.cpp \
+    sdk/knlinededuplicator.cpp \
     sdk/knlineedit.cpp \
+    sdk/knlinesorter.cpp \
     sdk/knlocalpeer.cpp \
     sdk/knlockedfile.cpp \
+    sdk/knmacromenu.cpp \
     sdk/knmainwindow.cpp \
     sdk/knrecentfilerecorder.cpp \
     sdk/knrundialog.cpp \
@@ -177,13 +204,17 @@ SOURCES += \
     sdk/knsingletonapplication.cpp \
     sdk/knstatusbar.cpp \
     sdk/knstatuslabel.cpp \
+    sdk/knsyntaxdefinition.cpp \
     sdk/knsyntaxhighlighter.cpp \
     sdk/kntabbar.cpp \
     sdk/kntabmodel.cpp \
     sdk/kntabswitcher.cpp \
     sdk/kntexteditor.cpp \
     sdk/kntexteditorpanel.cpp \
+    sdk/kntextmarks.cpp \
     sdk/kntextsearcher.cpp \
+    sdk/kntexttransform.cpp \
+    sdk/kntilecache.cpp \
     sdk/kntoolhash.cpp \
     sdk/kntoolhashfile.cpp \
     sdk/kntoolhashinput.cpp \
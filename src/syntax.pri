@@ -0,0 +1,32 @@
+# Copyright (C) Kreogist Dev Team
+#
+# You can redistribute this software and/or modify it under the
+# terms of the HARERU Software License; either version 1 of the
+# License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# license file for more details.
+
+# The Kate syntax files are compiled into binary definitions at build time,
+# each file generates a source which registers its definition at startup. The
+# projects which use the highlighters include this file.
+SYNTAX_FILES += \
+    $$PWD/resource/syntax/cpp.xml \
+    $$PWD/resource/syntax/doxygen.xml \
+    $$PWD/resource/syntax/gcc.xml \
+    $$PWD/resource/syntax/isocpp.xml
+
+# The including projects are built beside the tools directory.
+SYNTAX_COMPILER = $$OUT_PWD/../tools/syntaxcompiler/syntaxcompiler
+win32: SYNTAX_COMPILER = $${SYNTAX_COMPILER}.exe
+MAKE_SYNTAX_FILES.input = SYNTAX_FILES
+MAKE_SYNTAX_FILES.output = ${QMAKE_FILE_BASE}_syntax.cpp
+MAKE_SYNTAX_FILES.commands = $$shell_path($$SYNTAX_COMPILER) \
+                                  ${QMAKE_FILE_NAME} ${QMAKE_FILE_OUT}
+# The included languages are compiled into the definition, so any change of
+# the syntax files rebuilds all the definitions.
+MAKE_SYNTAX_FILES.depends = $$SYNTAX_COMPILER $$SYNTAX_FILES
+MAKE_SYNTAX_FILES.variable_out = SOURCES
+QMAKE_EXTRA_COMPILERS += MAKE_SYNTAX_FILES
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) Kreogist Dev Team
+ *
+ * You can redistribute this software and/or modify it under the
+ * terms of the HARERU Software License; either version 1 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * license file for more details.
+ */
+#include <cstdio>
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QXmlStreamReader>
+
+#include "knsyntaxdefinition.h"
+
+//The number of bytes in one line of the generated source.
+#define BYTES_PER_LINE  (16)
+
+static QString languageName(const QString &xmlPath)
+{
+    //Only read the attributes of the language element.
+    QFile xmlFile(xmlPath);
+    if(!xmlFile.open(QIODevice::ReadOnly))
+    {
+        return QString();
+    }
+    QXmlStreamReader reader(&xmlFile);
+    while(!reader.atEnd())
+    {
+        reader.readNext();
+        if(reader.isStartElement() &&
+                reader.name() == QLatin1String("language"))
+        {
+            return reader.attributes().value("name").toString();
+        }
+    }
+    return QString();
+}
+
+static bool writeSource(const QString &sourcePath, const QString &xmlName,
+                        const QByteArray &data)
+{
+    QFile sourceFile(sourcePath);
+    if(!sourceFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        return false;
+    }
+    QByteArray source;
+    source.append("//Generated from " + xmlName.toUtf8() +
+                  " by the syntax compiler, do not edit.\n"
+                  "#include \"knsyntaxdefinition.h\"\n\n"
+                  "static const char syntaxData[] = {");
+    for(int i=0; i<data.size(); ++i)
+    {
+        source.append(i % BYTES_PER_LINE == 0 ? "\n    " : " ");
+        source.append("'\\x" +
+                      QByteArray::number(static_cast<uchar>(data.at(i)), 16) +
+                      "',");
+    }
+    source.append("\n};\n\n"
+                  "static const KNSyntaxRegister syntaxRegister(\n"
+                  "        syntaxData, static_cast<int>(sizeof(syntaxData)));\n");
+    bool result = sourceFile.write(source) == source.size();
+    sourceFile.close();
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    const QStringList arguments = app.arguments();
+    if(arguments.size() != 3)
+    {
+        fprintf(stderr, "Usage: syntaxcompiler <syntax.xml> <output.cpp>\n");
+        return 1;
+    }
+    //Map all the languages beside the syntax file, they could be included.
+    QFileInfo xmlInfo(arguments.at(1));
+    QDir syntaxDir = xmlInfo.absoluteDir();
+    QHash<QString, QString> namePathMap;
+    QString syntaxName;
+    const auto fileList = syntaxDir.entryInfoList(QStringList() << "*.xml",
+                                                  QDir::Files);
+    for(const auto &fileInfo : fileList)
+    {
+        QString name = languageName(fileInfo.absoluteFilePath());
+        if(name.isEmpty())
+        {
+            continue;
+        }
+        namePathMap.insert(name, fileInfo.absoluteFilePath());
+        if(fileInfo.absoluteFilePath() == xmlInfo.absoluteFilePath())
+        {
+            syntaxName = name;
+        }
+    }
+    //Compile the syntax and save it as a source file.
+    KNSyntaxDefinition definition;
+    if(syntaxName.isEmpty() || !definition.load(syntaxName, namePathMap))
+    {
+        fprintf(stderr, "syntaxcompiler: failed to compile %s\n",
+                qPrintable(arguments.at(1)));
+        return 1;
+    }
+    if(!writeSource(arguments.at(2), xmlInfo.fileName(), definition.toBinary()))
+    {
+        fprintf(stderr, "syntaxcompiler: failed to write %s\n",
+                qPrintable(arguments.at(2)));
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,35 @@
+# Copyright (C) Kreogist Dev Team
+#
+# You can redistribute this software and/or modify it under the
+# terms of the HARERU Software License; either version 1 of the
+# License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# license file for more details.
+
+# The syntax compiler runs on the build host, it compiles the Kate syntax files
+# into the binary definitions which are linked into memo.
+TEMPLATE = app
+TARGET = syntaxcompiler
+
+QT = \
+    core \
+    gui
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+# Keep the tool at a fixed path for the extra compiler of memo.
+DESTDIR = $$OUT_PWD
+
+INCLUDEPATH += \
+    ../../src/sdk
+
+HEADERS += \
+    ../../src/sdk/knsyntaxdefinition.h
+
+SOURCES += \
+    main.cpp \
+    ../../src/sdk/knsyntaxdefinition.cpp